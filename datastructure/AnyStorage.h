@@ -3,6 +3,7 @@
 #ifndef A_NYSTORAGE_H
 #define A_NYSTORAGE_H
 
+#include <cstddef>
 #include <memory>
 #include <type_traits>
 #include <iostream>
@@ -1,13 +1,386 @@
 #pragma once
-#include <iostream>
+#include <Parking.hpp>
+#include <SPSCQueue.hpp>
+#include <sys/uio.h>
+#include <unistd.h>
 
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Lowest level that is compiled in; calls below it (see DEBUGPRINT_LOG) are stripped entirely.
+// 0 = Trace, 1 = Debug, 2 = Info, 3 = Warn, 4 = Error, 5 = Off.
+#ifndef DEBUGPRINT_LEVEL
+#define DEBUGPRINT_LEVEL 1
+#endif
+
+enum class LogLevel : uint8_t { Trace, Debug, Info, Warn, Error, Off };
+
+namespace datastructure {
+
+// One log line in transit: the formatter that knows the argument types (and so acts as the
+// format id) plus the arguments' raw bytes. Strings are copied in length-prefixed; arguments
+// that are neither arithmetic nor strings are streamed to a string on the calling thread.
+// Whatever does not fit into the payload is cut off.
+struct LogRecord {
+    static constexpr size_t PayloadSize = 240;
+    using Formatter = void (*) (const std::byte*, size_t, std::ostream&);
+
+    Formatter format = nullptr;
+    uint16_t size = 0;
+    std::array<std::byte, PayloadSize> payload;
+};
+
+template <class T>
+concept LogStringArg = std::is_convertible_v<const T&, std::string_view>;
+
+template <class T>
+concept LogTrivialArg = !LogStringArg<T> && (std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+                                             std::is_pointer_v<T> || std::is_null_pointer_v<T>);
+
+class LogRecordWriter {
+    public:
+    explicit LogRecordWriter (LogRecord& record) : d_record (record) {
+    }
+
+    template <class T>
+    void put (const T& value) {
+        if constexpr (LogStringArg<T>) {
+            putString (std::string_view (value));
+        } else if constexpr (LogTrivialArg<T>) {
+            putBytes (&value, sizeof (T));
+        } else {
+            std::ostringstream os;
+            os << value;
+            putString (os.str ());
+        }
+    }
+
+    private:
+    void putBytes (const void* data, size_t bytes) {
+        if (d_record.size + bytes > LogRecord::PayloadSize) {
+            d_record.size = LogRecord::PayloadSize;
+            return;
+        }
+        std::memcpy (d_record.payload.data () + d_record.size, data, bytes);
+        d_record.size += static_cast<uint16_t> (bytes);
+    }
+
+    void putString (std::string_view text) {
+        const size_t room = LogRecord::PayloadSize - d_record.size;
+        if (room < sizeof (uint16_t)) {
+            d_record.size = LogRecord::PayloadSize;
+            return;
+        }
+        const auto length =
+            static_cast<uint16_t> (std::min (text.size (), room - sizeof (uint16_t)));
+        putBytes (&length, sizeof (length));
+        putBytes (text.data (), length);
+    }
+
+    LogRecord& d_record;
+};
+
+class LogRecordReader {
+    public:
+    LogRecordReader (const std::byte* data, size_t size) : d_data (data), d_size (size) {
+    }
+
+    // Streams the next argument, read back as `T`. Returns false once the payload is exhausted.
+    template <class T>
+    bool get (std::ostream& os) {
+        if constexpr (LogTrivialArg<T>) {
+            T value;
+            if (!getBytes (&value, sizeof (T))) {
+                return false;
+            }
+            os << value;
+        } else {
+            uint16_t length = 0;
+            if (!getBytes (&length, sizeof (length)) || d_offset + length > d_size) {
+                return false;
+            }
+            os << std::string_view (reinterpret_cast<const char*> (d_data + d_offset), length);
+            d_offset += length;
+        }
+        return true;
+    }
+
+    private:
+    bool getBytes (void* out, size_t bytes) {
+        if (d_offset + bytes > d_size) {
+            return false;
+        }
+        std::memcpy (out, d_data + d_offset, bytes);
+        d_offset += bytes;
+        return true;
+    }
+
+    const std::byte* d_data;
+    size_t d_size;
+    size_t d_offset = 0;
+};
+
+template <class... Args>
+void formatLogRecord (const std::byte* data, size_t size, std::ostream& os) {
+    LogRecordReader reader (data, size);
+    (reader.template get<Args> (os) && ...);
+    os << '\n';
+}
+
+// Backend of DebugPrint. Every logging thread owns an SPSCQueue of LogRecords; one backend
+// thread drains all of them, formats the records and hands the lines to writev (2) in batches.
+// A thread's queue is retired when the thread exits and freed once the backend has drained it.
+class AsyncLogger {
+    public:
+    static constexpr int64_t QueueCapacity = 1024;
+    static constexpr auto IdlePoll = std::chrono::milliseconds (1);
+
+    using Queue = inplace::SPSCQueue<LogRecord, QueueCapacity, inplace::SPSCMode::CachedCursor>;
+
+    static AsyncLogger& instance () {
+        static AsyncLogger logger;
+        return logger;
+    }
+
+    AsyncLogger (AsyncLogger const&) = delete;
+
+    AsyncLogger& operator= (AsyncLogger const&) = delete;
+
+    ~AsyncLogger () {
+        d_stop.store (true, std::memory_order_release);
+        d_wakeup.notifyAll ();
+        d_backend.join ();
+        drain ();
+    }
+
+    // Encodes the arguments straight into the calling thread's queue. Never drops: when the
+    // queue is full the caller nudges the backend and yields until a slot frees up.
+    template <class... Args>
+    void log (const Args&... args) {
+        Queue& queue = local ();
+        auto slot = queue.tryClaim ();
+        while (!slot) {
+            d_wakeup.notify ();
+            std::this_thread::yield ();
+            slot = queue.tryClaim ();
+        }
+        // Default-initialised: only the header is set, the payload is written by the encoder.
+        LogRecord& record = *::new (slot.ptr ()) LogRecord;
+        record.format = &formatLogRecord<std::decay_t<Args>...>;
+        LogRecordWriter writer (record);
+        (writer.put (args), ...);
+        slot.commit ();
+    }
+
+    // Writes everything logged so far (by any thread) before returning.
+    void flush () {
+        drain ();
+    }
+
+    // Queues currently held: one per live logging thread, plus those of exited threads that the
+    // backend has not drained yet.
+    size_t queueCount () {
+        std::lock_guard lock (d_mutex);
+        return d_queues.size ();
+    }
+
+    void setOutput (int fd) {
+        std::lock_guard lock (d_mutex);
+        drainLocked ();
+        d_fd = fd;
+    }
+
+    private:
+    struct ThreadQueue {
+        Queue queue;
+        // Set by the owning thread on exit, after its last record.
+        std::atomic_bool retired = false;
+    };
+
+    // Lives in thread-local storage and retires the thread's queue when the thread exits. Shares
+    // the queue with d_queues, so a thread outliving the logger does not touch freed memory.
+    class QueueOwner {
+        public:
+        explicit QueueOwner (std::shared_ptr<ThreadQueue> queue) : d_queue (std::move (queue)) {
+        }
+
+        ~QueueOwner () {
+            d_queue->retired.store (true, std::memory_order_release);
+        }
+
+        QueueOwner (QueueOwner const&) = delete;
+
+        QueueOwner& operator= (QueueOwner const&) = delete;
+
+        Queue& queue () {
+            return d_queue->queue;
+        }
+
+        private:
+        std::shared_ptr<ThreadQueue> d_queue;
+    };
+
+    AsyncLogger () : d_backend ([this] { run (); }) {
+    }
+
+    Queue& local () {
+        thread_local QueueOwner owner (registerThread ());
+        return owner.queue ();
+    }
+
+    std::shared_ptr<ThreadQueue> registerThread () {
+        std::lock_guard lock (d_mutex);
+        d_queues.push_back (std::make_shared<ThreadQueue> ());
+        return d_queues.back ();
+    }
+
+    void run () {
+        while (!d_stop.load (std::memory_order_acquire)) {
+            if (drain () != 0) {
+                continue;
+            }
+            const uint32_t epoch = d_wakeup.prepare ();
+            if (d_stop.load (std::memory_order_acquire)) {
+                d_wakeup.cancel ();
+                break;
+            }
+            d_wakeup.park (epoch, inplace::Parker::Clock::now () + IdlePoll);
+        }
+    }
+
+    // The queues' single consumer is whoever holds d_mutex: the backend or a flushing thread.
+    size_t drain () {
+        std::lock_guard lock (d_mutex);
+        return drainLocked ();
+    }
+
+    size_t drainLocked () {
+        size_t total = 0;
+        auto formatAll = [this] (std::span<LogRecord> records) {
+            for (const auto& record : records) {
+                format (record);
+            }
+        };
+        for (auto it = d_queues.begin (); it != d_queues.end ();) {
+            // Read before draining: once retired, the owner has published its last record.
+            const bool retired = (*it)->retired.load (std::memory_order_acquire);
+            while (const size_t count = (*it)->queue.dequeueBulk (QueueCapacity, formatAll)) {
+                total += count;
+            }
+            it = retired ? d_queues.erase (it) : it + 1;
+        }
+        writeBatch ();
+        return total;
+    }
+
+    void format (const LogRecord& record) {
+        if (d_used == d_lines.size ()) {
+            d_lines.emplace_back ();
+        }
+        d_line.str ({});
+        record.format (record.payload.data (), record.size, d_line);
+        d_lines[d_used++] = d_line.str ();
+        if (d_used == IOV_MAX) {
+            writeBatch ();
+        }
+    }
+
+    void writeBatch () {
+        auto& iov = d_iov;
+        iov.resize (d_used);
+        for (size_t i = 0; i < d_used; i++) {
+            iov[i] = iovec{ d_lines[i].data (), d_lines[i].size () };
+        }
+        size_t first = 0;
+        while (first < iov.size ()) {
+            const ssize_t written =
+                ::writev (d_fd, &iov[first], static_cast<int> (iov.size () - first));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            // Skip what was written; a partially written line is resumed from its remainder.
+            auto left = static_cast<size_t> (written);
+            while (first < iov.size () && left >= iov[first].iov_len) {
+                left -= iov[first].iov_len;
+                first++;
+            }
+            if (first < iov.size ()) {
+                iov[first].iov_base = static_cast<char*> (iov[first].iov_base) + left;
+                iov[first].iov_len -= left;
+            }
+        }
+        d_used = 0;
+    }
+
+    std::mutex d_mutex;
+    std::vector<std::shared_ptr<ThreadQueue>> d_queues;
+    std::vector<std::string> d_lines;
+    std::vector<iovec> d_iov;
+    size_t d_used = 0;
+    std::ostringstream d_line;
+    int d_fd = STDOUT_FILENO;
+    std::atomic_bool d_stop = false;
+    inplace::Parker d_wakeup;
+    std::thread d_backend;
+};
+}  // namespace datastructure
+
+// Front end: formats nothing on the calling thread, see datastructure::AsyncLogger.
 class DebugPrint final {
    public:
     DebugPrint () = delete;
 
+    static constexpr LogLevel CompiledLevel = static_cast<LogLevel> (DEBUGPRINT_LEVEL);
+
+    static constexpr bool enabled (LogLevel level) {
+        return level != LogLevel::Off && level >= CompiledLevel;
+    }
+
+    template <LogLevel Level = LogLevel::Debug, class... Args>
+    static void log (const Args&... args) {
+        if constexpr (enabled (Level)) {
+            datastructure::AsyncLogger::instance ().log (args...);
+        }
+    }
+
     template <class... Args>
-    static void printLine (Args... args) {
-        ([] (const auto& x) { std::cout << x; }(args), ...);
-        std::cout << std::endl;
+    static void printLine (const Args&... args) {
+        log<LogLevel::Debug> (args...);
     }
-};
\ No newline at end of file
+
+    static void flush () {
+        datastructure::AsyncLogger::instance ().flush ();
+    }
+
+    // Redirects output (stdout by default) after writing out what is pending.
+    static void setOutput (int fd) {
+        datastructure::AsyncLogger::instance ().setOutput (fd);
+    }
+};
+
+// Like DebugPrint::log<level> (...), but the arguments are not even evaluated when `level` is
+// compiled out.
+#define DEBUGPRINT_LOG(level, ...)                       \
+    do {                                                 \
+        if constexpr (DebugPrint::enabled (level)) {     \
+            DebugPrint::log<level> (__VA_ARGS__);        \
+        }                                                \
+    } while (0)
@@ -7,6 +7,7 @@
 #include <array>
 #include <bitset>
 #include <cmath>
+#include <functional>
 #include <concepts>
 #include <iostream>
 #include <memory>
@@ -14,7 +15,8 @@
 #include <tuple>
 #include <type_traits>
 
-#include "DebugPrint.h"
+#include <ObjectPool.hpp>
+#include <Tracing.hpp>
 
 namespace datastructure {
 
@@ -57,6 +59,16 @@ class BaseFunctionManager {
                                     (sizeof (Functor) <= MAX_SIZE) &&
                                     (alignof (Functor) <= MAX_ALIGN);
 
+    // Functors that are not stored locally come from a pool shared by every MyFunction holding
+    // that functor type, so creating and copying them does not go through malloc. Past the pool's
+    // capacity they fall back to new, and the slot remembers which.
+    using HeapPool = inplace::ObjectPool<Functor, 64, 64>;
+
+    struct HeapSlot {
+        Functor* object;
+        bool pooled;
+    };
+
    public:
     static void manageStorage (SmallBufferOptimizationStorage<Size>& destination,
                                SmallBufferOptimizationStorage<Size>& source,
@@ -77,14 +89,11 @@ class BaseFunctionManager {
     }
 
     static void create (SmallBufferOptimizationStorage<Size>& destination, Functor&& source) {
-        DebugPrint::printLine (
-            "Create storage function, islocal=", isLocal, ", size=", sizeof (Functor),
-            ", sizeof buffer=", sizeof (SmallBufferOptimizationStorage<Size>),
-            ", align=", alignof (Functor), ", copyable=", std::is_trivially_copyable_v<Functor>);
+        INPLACE_TRACE_INSTANT ("MyFunction.createStorage", sizeof (Functor), isLocal);
         if constexpr (isLocal) {
             new (destination.template asPtr<Functor> ()) Functor (std::forward<Functor> (source));
         } else {
-            *destination.template asPtr<Functor*> () = new Functor (std::forward<Functor> (source));
+            *destination.template asPtr<HeapSlot> () = allocate (std::forward<Functor> (source));
         }
     }
 
@@ -98,39 +107,54 @@ class BaseFunctionManager {
         if constexpr (isLocal) {
             return source.template asPtr<Functor> ();
         } else {
-            return *source.template asPtr<Functor*> ();
+            return source.template asPtr<HeapSlot> ()->object;
+        }
+    }
+
+    template <class... A>
+    static HeapSlot allocate (A&&... args) {
+        if (Functor* object = HeapPool::shared ().create (std::forward<A> (args)...)) {
+            return { object, true };
         }
+        return { new Functor (std::forward<A> (args)...), false };
     }
+
     static void clone (SmallBufferOptimizationStorage<Size>& dest,
                        const SmallBufferOptimizationStorage<Size>& source) {
-        DebugPrint::printLine ("Clone storage function, islocal=", isLocal);
+        INPLACE_TRACE_INSTANT ("MyFunction.cloneStorage", sizeof (Functor), isLocal);
         if constexpr (isLocal) {
             new (dest.template asPtr<Functor> ()) Functor (*source.template asPtr<Functor> ());
         } else {
-            *dest.template asPtr<Functor*> () = new Functor (**source.template asPtr<Functor*> ());
+            const Functor& original = *source.template asPtr<HeapSlot> ()->object;
+            *dest.template asPtr<HeapSlot> () = allocate (original);
         }
     }
 
     static void move (SmallBufferOptimizationStorage<Size>& dest,
                       SmallBufferOptimizationStorage<Size>& source) {
-        DebugPrint::printLine ("Move storage function, islocal=", isLocal);
+        INPLACE_TRACE_INSTANT ("MyFunction.moveStorage", sizeof (Functor), isLocal);
         // Proper care must be taken to ensure that delete is not called on source in case of local
         // storage.
         if constexpr (isLocal) {
             new (dest.template asPtr<Functor> ())
                 Functor (std::move (*source.template asPtr<Functor> ()));
         } else {
-            *dest.template asPtr<Functor*> () = *source.template asPtr<Functor*> ();
-            *source.template asPtr<Functor*> () = nullptr;
+            *dest.template asPtr<HeapSlot> () = *source.template asPtr<HeapSlot> ();
+            *source.template asPtr<HeapSlot> () = { nullptr, false };
         }
     }
 
     static void destroy (SmallBufferOptimizationStorage<Size>& dest) {
-        DebugPrint::printLine ("Destroy storage function, islocal=", isLocal);
+        INPLACE_TRACE_INSTANT ("MyFunction.destroyStorage", sizeof (Functor), isLocal);
         if constexpr (isLocal) {
             dest.template asPtr<Functor> ()->~Functor ();
         } else {
-            delete *dest.template asPtr<Functor*> ();
+            const HeapSlot slot = *dest.template asPtr<HeapSlot> ();
+            if (slot.pooled) {
+                HeapPool::shared ().destroy (slot.object);
+            } else {
+                delete slot.object;
+            }
         }
     }
 };
@@ -163,7 +187,7 @@ class MyFunction<ReturnType (Args...)> {
         Handler<F>::create (d_data, std::forward<F> (f));
         d_invoker = Handler<F>::template invoke<ReturnType, Args...>;
         d_manager = Handler<F>::manageStorage;
-        DebugPrint::printLine ("MyFunction()");
+        INPLACE_TRACE_INSTANT ("MyFunction.construct");
     }
 
     explicit MyFunction (nullptr_t) {}
@@ -178,53 +202,74 @@ class MyFunction<ReturnType (Args...)> {
     }
 
     ~MyFunction () {
-        DebugPrint::printLine ("~MyFunction()");
+        INPLACE_TRACE_INSTANT ("MyFunction.destruct", d_manager != nullptr);
         if (d_manager) {
-            DebugPrint::printLine ("Destroyed");
             std::invoke (d_manager, d_data, d_data, ManageStorageEnum::DeleteStorage);
         }
     }
 
     MyFunction (const MyFunction& rhs) {
-        DebugPrint::printLine ("MyFunction (const MyFunction& rhs)");
+        INPLACE_TRACE_INSTANT ("MyFunction.copyConstruct");
         d_invoker = rhs.d_invoker;
         d_manager = rhs.d_manager;
-        std::invoke (d_manager, d_data, rhs.d_data, ManageStorageEnum::CloneStorage);
+        if (d_manager) {
+            std::invoke (d_manager, d_data, rhs.d_data, ManageStorageEnum::CloneStorage);
+        }
     }
 
     MyFunction (MyFunction&& rhs) noexcept {
-        DebugPrint::printLine ("MyFunction (MyFunction&& rhs) ");
+        INPLACE_TRACE_INSTANT ("MyFunction.moveConstruct");
         d_invoker = rhs.d_invoker;
         d_manager = rhs.d_manager;
 
-        std::invoke (d_manager, d_data, rhs.d_data, ManageStorageEnum::MoveStorage);
+        if (d_manager) {
+            std::invoke (d_manager, d_data, rhs.d_data, ManageStorageEnum::MoveStorage);
+        }
         rhs.d_invoker = nullptr;
         rhs.d_manager = nullptr;
     }
 
     MyFunction& operator= (const MyFunction& rhs) {
-        DebugPrint::printLine ("MyFunction& operator= (const MyFunction& rhs) ");
+        INPLACE_TRACE_INSTANT ("MyFunction.copyAssign");
         if (this != &rhs) {
-            std::invoke (d_manager, d_data, rhs.d_data, ManageStorageEnum::DeleteStorage);
+            reset ();
             d_invoker = rhs.d_invoker;
             d_manager = rhs.d_manager;
-            std::invoke (d_manager, d_data, rhs.d_data, ManageStorageEnum::CloneStorage);
+            if (d_manager) {
+                std::invoke (d_manager, d_data, rhs.d_data, ManageStorageEnum::CloneStorage);
+            }
         }
         return *this;
     }
 
     MyFunction& operator= (MyFunction&& rhs) noexcept {
-        DebugPrint::printLine ("MyFunction& operator= (MyFunction&& rhs)");
+        INPLACE_TRACE_INSTANT ("MyFunction.moveAssign");
         if (this != &rhs) {
-            std::invoke (d_manager, d_data, rhs.d_data, ManageStorageEnum::DeleteStorage);
+            reset ();
             d_invoker = rhs.d_invoker;
             d_manager = rhs.d_manager;
             rhs.d_invoker = nullptr;
             rhs.d_manager = nullptr;
-            std::invoke (d_manager, d_data, rhs.d_data, ManageStorageEnum::MoveStorage);
+            if (d_manager) {
+                std::invoke (d_manager, d_data, rhs.d_data, ManageStorageEnum::MoveStorage);
+            }
         }
         return *this;
     }
+
+    explicit operator bool () const {
+        return d_invoker != nullptr;
+    }
+
+   private:
+    // Destroys the stored callable, leaving an empty function.
+    void reset () {
+        if (d_manager) {
+            std::invoke (d_manager, d_data, d_data, ManageStorageEnum::DeleteStorage);
+        }
+        d_invoker = nullptr;
+        d_manager = nullptr;
+    }
 };
 
 // Deduction logic for function pointer.
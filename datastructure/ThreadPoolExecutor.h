@@ -0,0 +1,332 @@
+#ifndef THREADPOOLEXECUTOR_H
+#define THREADPOOLEXECUTOR_H
+
+#include <MyFunction.h>
+#include <Parking.hpp>
+#include <SequencedMPMCQueue.hpp>
+#include <Tracing.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <ranges>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace datastructure {
+
+struct ThreadPoolOptions {
+    size_t workers = std::max (1u, std::thread::hardware_concurrency ());
+    // Worker i is pinned to cpus[i % cpus.size ()]; empty leaves the workers to the scheduler.
+    std::vector<int> cpus;
+    // Rounds over all queues an idle worker makes before it parks.
+    int idleRounds = 64;
+};
+
+struct WorkerStats {
+    // Tasks this worker ran, including ones it stole and ones it ran inline on a full queue.
+    uint64_t executed = 0;
+    uint64_t stolen = 0;
+    // Tasks placed in this worker's queue.
+    uint64_t queued = 0;
+    uint64_t parks = 0;
+    // post ()ed tasks that ended with an exception.
+    uint64_t failed = 0;
+};
+
+// Fixed set of worker threads running MyFunction tasks. Every worker owns a bounded queue; tasks
+// posted from a worker go to its own queue, tasks from other threads are spread round robin, and
+// a worker that runs dry steals from the others before it parks.
+//
+// Tasks are stored in the queues as MyFunctions. A MyFunction keeps a callable in its small
+// buffer only if the callable is trivially copyable and fits; post () of such a callable does
+// not allocate. Any other callable is copied into MyFunction's per-type ObjectPool, or onto the
+// heap once that pool is exhausted. submit () and bulkSubmit () also allocate a shared
+// std::packaged_task per callable. Callables must be copy constructible (a MyFunction
+// requirement).
+class ThreadPoolExecutor {
+   public:
+    using Task = MyFunction<void ()>;
+    static constexpr int64_t LocalQueueCapacity = 1024;
+
+    explicit ThreadPoolExecutor (ThreadPoolOptions options = {}) : d_options (std::move (options)) {
+        if (d_options.workers == 0) {
+            throw std::invalid_argument ("ThreadPoolExecutor needs at least one worker");
+        }
+        for (size_t i = 0; i < d_options.workers; i++) {
+            d_workers.push_back (std::make_unique<Worker> ());
+        }
+        // Workers already running when a later spawn or the pinning fails are stopped and joined.
+        try {
+            for (size_t i = 0; i < d_workers.size (); i++) {
+                d_workers[i]->thread = std::thread ([this, i] { run (i); });
+            }
+            pinWorkers ();
+        } catch (...) {
+            shutdown ();
+            throw;
+        }
+    }
+
+    ~ThreadPoolExecutor () {
+        shutdown ();
+    }
+
+    ThreadPoolExecutor (ThreadPoolExecutor const&) = delete;
+
+    ThreadPoolExecutor& operator= (ThreadPoolExecutor const&) = delete;
+
+    // Runs `f` on some worker; nothing is reported back.
+    template <std::invocable F>
+    void post (F&& f) {
+        schedule (Task (std::decay_t<F> (std::forward<F> (f))), nextQueue ());
+        d_workAvailable.notify ();
+    }
+
+    // Runs `f` on some worker; its result or exception is delivered through the future.
+    template <std::invocable F>
+    auto submit (F&& f) -> std::future<std::invoke_result_t<std::decay_t<F>&>> {
+        auto future = schedulePackaged (std::forward<F> (f));
+        d_workAvailable.notify ();
+        return future;
+    }
+
+    // submit ()s every callable of `range`, waking the workers once for the whole batch.
+    template <std::ranges::input_range Range>
+        requires std::invocable<std::ranges::range_reference_t<Range>>
+    auto bulkSubmit (Range&& range) {
+        using F = std::remove_cvref_t<std::ranges::range_reference_t<Range>>;
+        std::vector<std::future<std::invoke_result_t<F&>>> futures;
+        if constexpr (std::ranges::sized_range<Range>) {
+            futures.reserve (std::ranges::size (range));
+        }
+        for (auto&& f : range) {
+            futures.push_back (schedulePackaged (F (f)));
+        }
+        d_workAvailable.notifyAll ();
+        return futures;
+    }
+
+    // Stops accepting tasks from outside the pool, runs everything already queued (and whatever
+    // those tasks post in turn), then joins the workers. Idempotent.
+    void shutdown () {
+        d_stopping.store (true, std::memory_order_seq_cst);
+        d_workAvailable.notifyAll ();
+        for (auto& worker : d_workers) {
+            if (worker->thread.joinable ()) {
+                worker->thread.join ();
+            }
+        }
+    }
+
+    size_t workerCount () const {
+        return d_workers.size ();
+    }
+
+    std::vector<WorkerStats> stats () const {
+        std::vector<WorkerStats> result;
+        for (const auto& worker : d_workers) {
+            const auto& c = worker->counters;
+            result.push_back (WorkerStats{ c.executed.load (std::memory_order_relaxed),
+                                           c.stolen.load (std::memory_order_relaxed),
+                                           c.queued.load (std::memory_order_relaxed),
+                                           c.parks.load (std::memory_order_relaxed),
+                                           c.failed.load (std::memory_order_relaxed) });
+        }
+        return result;
+    }
+
+    // Index of the worker of this pool that the caller runs on, -1 for any other thread.
+    int currentWorker () const {
+        const auto& self = currentThread ();
+        return self.pool == this ? static_cast<int> (self.index) : -1;
+    }
+
+   private:
+    using LocalQueue = inplace::SequencedMPMCQueue<Task, LocalQueueCapacity>;
+
+    struct alignas (inplace::CACHE_LINE_SIZE) Counters {
+        std::atomic<uint64_t> executed = 0;
+        std::atomic<uint64_t> stolen = 0;
+        std::atomic<uint64_t> queued = 0;
+        std::atomic<uint64_t> parks = 0;
+        std::atomic<uint64_t> failed = 0;
+    };
+
+    struct Worker {
+        LocalQueue queue;
+        Counters counters;
+        std::thread thread;
+    };
+
+    struct ThreadIdentity {
+        const ThreadPoolExecutor* pool = nullptr;
+        size_t index = 0;
+    };
+
+    static ThreadIdentity& currentThread () {
+        thread_local ThreadIdentity identity;
+        return identity;
+    }
+
+    template <class F>
+    auto schedulePackaged (F&& f) -> std::future<std::invoke_result_t<std::decay_t<F>&>> {
+        using Result = std::invoke_result_t<std::decay_t<F>&>;
+        auto packaged = std::make_shared<std::packaged_task<Result ()>> (std::forward<F> (f));
+        auto future = packaged->get_future ();
+        schedule (Task ([packaged] { (*packaged) (); }), nextQueue ());
+        return future;
+    }
+
+    // Workers feed their own queue, everybody else takes turns.
+    size_t nextQueue () {
+        const int self = currentWorker ();
+        if (self >= 0) {
+            return static_cast<size_t> (self);
+        }
+        return d_nextQueue.fetch_add (1, std::memory_order_relaxed) % d_workers.size ();
+    }
+
+    void schedule (Task&& task, size_t home) {
+        const int self = currentWorker ();
+        // Announce the task before checking for shutdown; a draining worker checks the other way
+        // round, so either the task is refused here or the workers wait for it.
+        d_pending.fetch_add (1, std::memory_order_seq_cst);
+        if (self < 0 && d_stopping.load (std::memory_order_seq_cst)) {
+            finished ();
+            throw std::runtime_error ("ThreadPoolExecutor is shut down");
+        }
+        while (true) {
+            for (size_t i = 0; i < d_workers.size (); i++) {
+                Worker& worker = *d_workers[(home + i) % d_workers.size ()];
+                if (worker.queue.enqueue (std::move (task))) {
+                    worker.counters.queued.fetch_add (1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+            if (self >= 0) {
+                // Every queue is full; a worker must not wait for itself to make room.
+                INPLACE_TRACE_INSTANT ("executor.runInline", self);
+                execute (*d_workers[self], task);
+                return;
+            }
+            d_workAvailable.notifyAll ();
+            std::this_thread::yield ();
+        }
+    }
+
+    void run (size_t self) {
+        currentThread () = ThreadIdentity{ this, self };
+        Worker& worker = *d_workers[self];
+        Task task;
+        int idle = 0;
+        while (true) {
+            if (take (self, task)) {
+                execute (worker, task);
+                idle = 0;
+                continue;
+            }
+            if (++idle < d_options.idleRounds) {
+                std::this_thread::yield ();
+                continue;
+            }
+            const uint32_t epoch = d_workAvailable.prepare ();
+            if (d_stopping.load (std::memory_order_seq_cst) &&
+                d_pending.load (std::memory_order_seq_cst) == 0) {
+                d_workAvailable.cancel ();
+                break;
+            }
+            if (hasQueuedTasks ()) {
+                d_workAvailable.cancel ();
+                continue;
+            }
+            worker.counters.parks.fetch_add (1, std::memory_order_relaxed);
+            INPLACE_TRACE_BEGIN ("executor.park", self);
+            d_workAvailable.park (epoch, inplace::Parker::Clock::time_point::max ());
+            INPLACE_TRACE_END ("executor.park");
+            idle = 0;
+        }
+        currentThread () = ThreadIdentity{};
+    }
+
+    // Own queue first, then the others starting with the next worker.
+    bool take (size_t self, Task& task) {
+        if (d_workers[self]->queue.tryDequeue (task)) {
+            return true;
+        }
+        for (size_t i = 1; i < d_workers.size (); i++) {
+            if (d_workers[(self + i) % d_workers.size ()]->queue.tryDequeue (task)) {
+                d_workers[self]->counters.stolen.fetch_add (1, std::memory_order_relaxed);
+                INPLACE_TRACE_INSTANT ("executor.steal", self, (self + i) % d_workers.size ());
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool hasQueuedTasks () const {
+        return std::ranges::any_of (d_workers, [] (const auto& w) { return !w->queue.empty (); });
+    }
+
+    void execute (Worker& worker, Task& task) {
+        INPLACE_TRACE_BEGIN ("executor.task");
+        try {
+            task ();
+        } catch (...) {
+            // submit () tasks catch inside the packaged_task; only post () tasks end up here.
+            worker.counters.failed.fetch_add (1, std::memory_order_relaxed);
+        }
+        INPLACE_TRACE_END ("executor.task");
+        // Release captured state now rather than when the slot is next reused.
+        task = Task ();
+        worker.counters.executed.fetch_add (1, std::memory_order_relaxed);
+        finished ();
+    }
+
+    void finished () {
+        if (d_pending.fetch_sub (1, std::memory_order_seq_cst) == 1 &&
+            d_stopping.load (std::memory_order_seq_cst)) {
+            d_workAvailable.notifyAll ();
+        }
+    }
+
+    void pinWorkers () {
+        if (d_options.cpus.empty ()) {
+            return;
+        }
+#if defined(__linux__)
+        for (size_t i = 0; i < d_workers.size (); i++) {
+            cpu_set_t set;
+            CPU_ZERO (&set);
+            CPU_SET (d_options.cpus[i % d_options.cpus.size ()], &set);
+            const int error =
+                pthread_setaffinity_np (d_workers[i]->thread.native_handle (), sizeof (set), &set);
+            if (error != 0) {
+                throw std::system_error (error, std::generic_category (), "pthread_setaffinity_np");
+            }
+        }
+#endif
+    }
+
+    ThreadPoolOptions d_options;
+    std::vector<std::unique_ptr<Worker>> d_workers;
+    alignas (inplace::CACHE_LINE_SIZE) std::atomic<uint64_t> d_pending = 0;
+    std::atomic<size_t> d_nextQueue = 0;
+    std::atomic_bool d_stopping = false;
+    inplace::Parker d_workAvailable;
+};
+}  // namespace datastructure
+
+#endif  // THREADPOOLEXECUTOR_H
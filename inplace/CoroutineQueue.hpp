@@ -0,0 +1,370 @@
+#ifndef COROUTINEQUEUE_HPP
+#define COROUTINEQUEUE_HPP
+
+#include <atomic>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <InplaceCommon.hpp>
+#include <Tracing.hpp>
+
+namespace inplace {
+
+// Anything that can run a callable later, e.g. datastructure::ThreadPoolExecutor.
+template <class E>
+concept CoroutineExecutor = requires (E& executor) { executor.post ([] {}); };
+
+// Resumes on the thread that made progress, inside its push/pop call.
+struct InlineExecutor {
+    template <std::invocable F>
+    void post (F&& f) {
+        std::invoke (std::forward<F> (f));
+    }
+};
+
+// Collects posted work until the owning thread runs it; a single thread driving runOne () can
+// multiplex any number of suspended coroutines. post () may be called from any thread.
+class RunLoopExecutor {
+    public:
+    template <std::invocable F>
+    void post (F&& f) {
+        std::lock_guard lock (d_mutex);
+        d_work.emplace_back (std::forward<F> (f));
+    }
+
+    // Runs the oldest posted callable; false when there was none.
+    bool runOne () {
+        std::function<void ()> work;
+        {
+            std::lock_guard lock (d_mutex);
+            if (d_work.empty ()) {
+                return false;
+            }
+            work = std::move (d_work.front ());
+            d_work.pop_front ();
+        }
+        work ();
+        return true;
+    }
+
+    // Runs posted callables, including ones posted meanwhile, until none is left.
+    size_t drain () {
+        size_t count = 0;
+        while (runOne ()) {
+            count++;
+        }
+        return count;
+    }
+
+    private:
+    std::mutex d_mutex;
+    std::deque<std::function<void ()>> d_work;
+};
+
+// Coroutine return type for fire-and-forget coroutines: runs eagerly, frees itself at the end.
+struct DetachedCoroutine {
+    struct promise_type {
+        DetachedCoroutine get_return_object () {
+            return {};
+        }
+
+        std::suspend_never initial_suspend () noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend () noexcept {
+            return {};
+        }
+
+        void return_void () {
+        }
+
+        void unhandled_exception () {
+            std::terminate ();
+        }
+    };
+};
+
+// Wraps an inplace queue (SPSCQueue, MPMCQueue or SequencedMPMCQueue) so that coroutines can
+// `co_await q.pop ()` and `co_await q.push (x)` instead of polling. A coroutine that finds the
+// queue empty (full) links its awaiter, which lives in the coroutine frame, into an intrusive
+// list; every successful push (pop) takes one waiter off the opposite list and posts its retry to
+// the executor, which resumes the coroutine once the retry succeeds.
+//
+// All access must go through the wrapper (tryPush/tryPop for non-suspending calls), otherwise
+// waiters are not woken. The queue's own producer/consumer limits still apply: an SPSCQueue takes
+// one producing and one consuming coroutine at a time. A suspended coroutine must not be
+// destroyed.
+template <class Queue, CoroutineExecutor Executor>
+class CoroutineQueue {
+    public:
+    using value_type = typename Queue::value_type;
+
+    private:
+    using T = value_type;
+
+    // Who owns the next attempt of a waiter. Suspending: the coroutine's own suspend (); a waker
+    // that takes it off the list then only flags it Notified, and suspend () re-checks. Parked:
+    // nobody, until a waker moves it to Woken and posts the retry. So attempt () never runs on two
+    // threads at once, and a waker never touches a waiter it does not resume.
+    enum class WaiterState { Suspending, Notified, Parked, Woken };
+
+    struct Waiter {
+        Waiter* prev = nullptr;
+        Waiter* next = nullptr;
+        bool linked = false;
+        // Changes under the list's mutex.
+        WaiterState state = WaiterState::Suspending;
+        std::coroutine_handle<> handle;
+        // Tries to complete the operation; true once the coroutine may resume.
+        bool (*attempt) (Waiter&) = nullptr;
+    };
+
+    // Waiters of one side, oldest first. The count lets the wake path skip the lock when nobody
+    // waits.
+    class WaiterList {
+        public:
+        void append (Waiter& waiter) {
+            std::lock_guard lock (d_mutex);
+            waiter.prev = d_tail;
+            waiter.next = nullptr;
+            (d_tail ? d_tail->next : d_head) = &waiter;
+            d_tail = &waiter;
+            waiter.linked = true;
+            waiter.state = WaiterState::Suspending;
+            d_count.fetch_add (1, std::memory_order_relaxed);
+        }
+
+        // Suspending -> Parked; false if a waker took the waiter off the list first.
+        bool park (Waiter& waiter) {
+            std::lock_guard lock (d_mutex);
+            if (waiter.state == WaiterState::Notified) {
+                return false;
+            }
+            waiter.state = WaiterState::Parked;
+            return true;
+        }
+
+        // False if a waker unlinked the waiter first.
+        bool remove (Waiter& waiter) {
+            std::lock_guard lock (d_mutex);
+            if (!waiter.linked) {
+                return false;
+            }
+            unlink (waiter);
+            return true;
+        }
+
+        // Takes the oldest waiter off the list; returns it only if it was parked, so that the
+        // caller now owns its retry. A waiter still suspending is flagged instead.
+        Waiter* popFront () {
+            if (d_count.load (std::memory_order_relaxed) == 0) {
+                return nullptr;
+            }
+            std::lock_guard lock (d_mutex);
+            Waiter* waiter = d_head;
+            if (waiter == nullptr) {
+                return nullptr;
+            }
+            unlink (*waiter);
+            if (waiter->state == WaiterState::Suspending) {
+                waiter->state = WaiterState::Notified;
+                return nullptr;
+            }
+            waiter->state = WaiterState::Woken;
+            return waiter;
+        }
+
+        size_t size () const {
+            return d_count.load (std::memory_order_relaxed);
+        }
+
+        private:
+        void unlink (Waiter& waiter) {
+            (waiter.prev ? waiter.prev->next : d_head) = waiter.next;
+            (waiter.next ? waiter.next->prev : d_tail) = waiter.prev;
+            waiter.linked = false;
+            d_count.fetch_sub (1, std::memory_order_relaxed);
+        }
+
+        std::mutex d_mutex;
+        Waiter* d_head = nullptr;
+        Waiter* d_tail = nullptr;
+        std::atomic<size_t> d_count = 0;
+    };
+
+    public:
+    class PopAwaiter : Waiter {
+        public:
+        explicit PopAwaiter (CoroutineQueue& queue) : d_queue (queue) {
+            this->attempt = [] (Waiter& waiter) {
+                auto& self = static_cast<PopAwaiter&> (waiter);
+                if (!self.d_value) {
+                    self.d_value = self.d_queue.tryPop ();
+                }
+                return self.d_value.has_value ();
+            };
+        }
+
+        PopAwaiter (PopAwaiter const&) = delete;
+
+        PopAwaiter& operator= (PopAwaiter const&) = delete;
+
+        bool await_ready () {
+            return this->attempt (*this);
+        }
+
+        bool await_suspend (std::coroutine_handle<> handle) {
+            this->handle = handle;
+            return d_queue.suspend (d_queue.d_consumers, *this);
+        }
+
+        T await_resume () {
+            return std::move (*d_value);
+        }
+
+        private:
+        CoroutineQueue& d_queue;
+        std::optional<T> d_value;
+    };
+
+    class PushAwaiter : Waiter {
+        public:
+        PushAwaiter (CoroutineQueue& queue, T&& value) : d_queue (queue), d_value (std::move (value)) {
+            this->attempt = [] (Waiter& waiter) {
+                auto& self = static_cast<PushAwaiter&> (waiter);
+                if (!self.d_pushed) {
+                    self.d_pushed = self.d_queue.tryPush (std::move (self.d_value));
+                }
+                return self.d_pushed;
+            };
+        }
+
+        PushAwaiter (PushAwaiter const&) = delete;
+
+        PushAwaiter& operator= (PushAwaiter const&) = delete;
+
+        bool await_ready () {
+            return this->attempt (*this);
+        }
+
+        bool await_suspend (std::coroutine_handle<> handle) {
+            this->handle = handle;
+            return d_queue.suspend (d_queue.d_producers, *this);
+        }
+
+        void await_resume () {
+        }
+
+        private:
+        CoroutineQueue& d_queue;
+        T d_value;
+        bool d_pushed = false;
+    };
+
+    template <class... QueueArgs>
+    explicit CoroutineQueue (Executor& executor, QueueArgs&&... args)
+        : d_queue (std::forward<QueueArgs> (args)...), d_executor (executor) {
+    }
+
+    CoroutineQueue (CoroutineQueue const&) = delete;
+
+    CoroutineQueue& operator= (CoroutineQueue const&) = delete;
+
+    // `co_await q.pop ()` yields the next element, suspending while the queue is empty.
+    [[nodiscard]] PopAwaiter pop () {
+        return PopAwaiter (*this);
+    }
+
+    // `co_await q.push (x)` suspends while the queue is full.
+    [[nodiscard]] PushAwaiter push (T value) {
+        return PushAwaiter (*this, std::move (value));
+    }
+
+    // Non-suspending variants; they wake waiters like the awaitables do. The value is only moved
+    // from when tryPush succeeds.
+    bool tryPush (T&& value) {
+        if (!d_queue.enqueue (std::move (value))) {
+            return false;
+        }
+        wakeOne (d_consumers);
+        return true;
+    }
+
+    bool tryPush (const T& value) {
+        T copy (value);
+        return tryPush (std::move (copy));
+    }
+
+    std::optional<T> tryPop () {
+        std::optional<T> value = d_queue.tryDequeue ();
+        if (value) {
+            wakeOne (d_producers);
+        }
+        return value;
+    }
+
+    Queue& queue () {
+        return d_queue;
+    }
+
+    size_t suspendedConsumers () const {
+        return d_consumers.size ();
+    }
+
+    size_t suspendedProducers () const {
+        return d_producers.size ();
+    }
+
+    private:
+    // Parks `waiter` unless its operation succeeds on the re-check; returns whether the coroutine
+    // stays suspended. Linking before re-checking pairs with the fence in wakeOne (): either the
+    // re-check sees the other side's progress or the other side sees the waiter.
+    bool suspend (WaiterList& list, Waiter& waiter) {
+        while (true) {
+            list.append (waiter);
+            std::atomic_thread_fence (std::memory_order_seq_cst);
+            if (waiter.attempt (waiter)) {
+                // Done after all. A waker that took us off the list meanwhile only flagged us, so
+                // the resumption is ours either way.
+                list.remove (waiter);
+                return false;
+            }
+            if (list.park (waiter)) {
+                INPLACE_TRACE_INSTANT ("coqueue.suspend", list.size ());
+                return true;
+            }
+            // A waker saw progress while we were suspending: check again.
+        }
+    }
+
+    void wakeOne (WaiterList& list) {
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        Waiter* waiter = list.popFront ();
+        if (waiter == nullptr) {
+            return;
+        }
+        INPLACE_TRACE_INSTANT ("coqueue.wake", list.size ());
+        d_executor.post ([this, waiter, &list] { retry (list, *waiter); });
+    }
+
+    void retry (WaiterList& list, Waiter& waiter) {
+        if (waiter.attempt (waiter) || !suspend (list, waiter)) {
+            waiter.handle.resume ();
+        }
+    }
+
+    Queue d_queue;
+    Executor& d_executor;
+    WaiterList d_consumers;
+    WaiterList d_producers;
+};
+}  // namespace inplace
+
+#endif  // COROUTINEQUEUE_HPP
@@ -0,0 +1,445 @@
+#ifndef EPOCHRECLAMATION_HPP
+#define EPOCHRECLAMATION_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <InplaceCommon.hpp>
+
+namespace inplace {
+
+// Epoch-based memory reclamation for lock-free containers, with hazard pointers as a fallback
+// for readers that hold on to nodes for a long time.
+//
+// A thread pin ()s the domain for as long as it may dereference shared nodes; once a node is
+// unlinked, the thread that unlinked it retire ()s it with a deleter. A global epoch advances
+// whenever every pinned thread has seen the current one, and a node retired at epoch e is freed
+// once the epoch reaches e + 2: by then every thread that could have reached the node has
+// unpinned. Retired nodes collect in a per-thread list and are freed in batches, every
+// CollectInterval retirements or on collect ().
+//
+// A pinned thread that stalls holds back every retirement in the domain. A long-running reader
+// can instead stay unpinned and protect () the few nodes it holds with hazard pointers: nodes are
+// never freed while a hazard pointer refers to them, whatever the epoch. Hazard slots are only
+// scanned while some hazard pointer is live.
+//
+// Each thread gets a record per domain on first use. When the thread exits, its record is
+// recycled and its pending retirements are handed to whichever thread collects next. Destroying
+// the domain frees everything still retired; by then no thread may be pinned or hold a hazard
+// pointer. Deleters must not call back into the domain.
+class EpochDomain {
+    public:
+    using Deleter = void (*) (void*);
+
+    static constexpr size_t HazardSlots = 4;
+    static constexpr size_t CollectInterval = 64;
+
+    private:
+    struct Retired {
+        void* ptr;
+        Deleter deleter;
+        uint64_t epoch;
+    };
+
+    struct alignas (CACHE_LINE_SIZE) Record {
+        // (epoch << 1) | 1 while pinned, 0 otherwise.
+        std::atomic<uint64_t> state = 0;
+        std::atomic<void*> hazards[HazardSlots] = {};
+        std::atomic<bool> inUse = false;
+        // Set before the record is published, never changed after.
+        Record* next = nullptr;
+        // Owner thread only.
+        uint32_t nesting = 0;
+        uint32_t hazardMask = 0;
+        size_t sinceCollect = 0;
+        std::vector<Retired> retired;
+    };
+
+    // The records the calling thread holds, across domains. Domains are told apart by id rather
+    // than address, so a record of a destroyed domain is never mistaken for a live one. Entries of
+    // destroyed domains are dropped the next time the thread first uses a domain.
+    struct ThreadRecords {
+        ~ThreadRecords () {
+            std::lock_guard lock (registryMutex ());
+            for (auto [id, record] : entries) {
+                auto it = registry ().find (id);
+                if (it != registry ().end ()) {
+                    it->second->release (*record);
+                }
+            }
+        }
+
+        uint64_t lastId = 0;
+        Record* last = nullptr;
+        std::vector<std::pair<uint64_t, Record*>> entries;
+    };
+
+    public:
+    // Keeps the domain pinned; guards nest.
+    class Guard {
+        public:
+        Guard (Guard&& other) noexcept : d_record (std::exchange (other.d_record, nullptr)) {
+        }
+
+        Guard (Guard const&) = delete;
+
+        Guard& operator= (Guard const&) = delete;
+
+        Guard& operator= (Guard&&) = delete;
+
+        ~Guard () {
+            if (d_record != nullptr && --d_record->nesting == 0) {
+                d_record->state.store (0, std::memory_order_release);
+            }
+        }
+
+        private:
+        friend class EpochDomain;
+
+        explicit Guard (Record& record) : d_record (&record) {
+        }
+
+        Record* d_record;
+    };
+
+    // One hazard slot of the calling thread; use it on that thread only.
+    class HazardPointer {
+        public:
+        HazardPointer (HazardPointer&& other) noexcept
+            : d_domain (std::exchange (other.d_domain, nullptr)), d_record (other.d_record),
+              d_index (other.d_index) {
+        }
+
+        HazardPointer (HazardPointer const&) = delete;
+
+        HazardPointer& operator= (HazardPointer const&) = delete;
+
+        HazardPointer& operator= (HazardPointer&&) = delete;
+
+        ~HazardPointer () {
+            if (d_domain != nullptr) {
+                reset ();
+                d_record->hazardMask &= ~(uint32_t{ 1 } << d_index);
+                d_domain->d_hazardsInUse.fetch_sub (1, std::memory_order_release);
+            }
+        }
+
+        // Loads `source` and protects what it points to: the node stays allocated until reset ()
+        // or until another protect () moves the slot on, even if it is unlinked and retired.
+        template <class T>
+        T* protect (const std::atomic<T*>& source) {
+            T* ptr = source.load (std::memory_order_relaxed);
+            while (true) {
+                slot ().store (ptr, std::memory_order_seq_cst);
+                // Still linked after publishing: any later retirement sees the hazard.
+                T* current = source.load (std::memory_order_seq_cst);
+                if (current == ptr) {
+                    return ptr;
+                }
+                ptr = current;
+            }
+        }
+
+        void reset () {
+            slot ().store (nullptr, std::memory_order_release);
+        }
+
+        private:
+        friend class EpochDomain;
+
+        HazardPointer (EpochDomain& domain, Record& record, unsigned index)
+            : d_domain (&domain), d_record (&record), d_index (index) {
+        }
+
+        std::atomic<void*>& slot () {
+            return d_record->hazards[d_index];
+        }
+
+        EpochDomain* d_domain;
+        Record* d_record;
+        unsigned d_index;
+    };
+
+    EpochDomain () : d_id (nextId ().fetch_add (1, std::memory_order_relaxed)) {
+        std::lock_guard lock (registryMutex ());
+        registry ().emplace (d_id, this);
+    }
+
+    ~EpochDomain () {
+        {
+            std::lock_guard lock (registryMutex ());
+            registry ().erase (d_id);
+        }
+        Record* record = d_records.load (std::memory_order_acquire);
+        while (record != nullptr) {
+            freeAll (record->retired);
+            delete std::exchange (record, record->next);
+        }
+        freeAll (d_orphans);
+    }
+
+    EpochDomain (EpochDomain const&) = delete;
+
+    EpochDomain& operator= (EpochDomain const&) = delete;
+
+    // Shared by everything that does not need a domain of its own.
+    static EpochDomain& global () {
+        static EpochDomain domain;
+        return domain;
+    }
+
+    [[nodiscard]] Guard pin () {
+        Record& record = threadRecord ();
+        if (record.nesting++ == 0) {
+            record.state.store ((d_epoch.load (std::memory_order_seq_cst) << 1) | 1,
+                                std::memory_order_seq_cst);
+            // Loads of shared nodes must not move above the announcement.
+            std::atomic_thread_fence (std::memory_order_seq_cst);
+        }
+        return Guard (record);
+    }
+
+    // Hands over `ptr`, already unlinked, to be passed to `deleter` once no thread can reach it.
+    void retire (void* ptr, Deleter deleter) {
+        Record& record = threadRecord ();
+        const uint64_t epoch = d_epoch.load (std::memory_order_seq_cst);
+        record.retired.push_back (Retired{ ptr, deleter, epoch });
+        d_retiredCount.fetch_add (1, std::memory_order_relaxed);
+        if (++record.sinceCollect >= CollectInterval) {
+            collect (record);
+        }
+    }
+
+    template <class T>
+    void retire (T* ptr) {
+        retire (ptr, [] (void* p) { delete static_cast<T*> (p); });
+    }
+
+    // Throws std::length_error if the calling thread already holds HazardSlots of them.
+    [[nodiscard]] HazardPointer hazardPointer () {
+        Record& record = threadRecord ();
+        for (unsigned index = 0; index < HazardSlots; index++) {
+            if ((record.hazardMask & (uint32_t{ 1 } << index)) == 0) {
+                record.hazardMask |= uint32_t{ 1 } << index;
+                d_hazardsInUse.fetch_add (1, std::memory_order_seq_cst);
+                return HazardPointer (*this, record, index);
+            }
+        }
+        throw std::length_error ("EpochDomain: out of hazard pointers");
+    }
+
+    // Tries to advance the epoch and frees what the calling thread (and exited threads) retired
+    // and nobody can reach any more. Called from a quiescent point, a few rounds free everything
+    // that is not protected by a hazard pointer.
+    void collect () {
+        collect (threadRecord ());
+    }
+
+    uint64_t epoch () const {
+        return d_epoch.load (std::memory_order_acquire);
+    }
+
+    uint64_t retiredCount () const {
+        return d_retiredCount.load (std::memory_order_relaxed);
+    }
+
+    uint64_t reclaimedCount () const {
+        return d_reclaimedCount.load (std::memory_order_relaxed);
+    }
+
+    // Records the calling thread keeps, across domains. Includes those of domains destroyed since
+    // the thread last used a domain for the first time.
+    static size_t threadRecordCount () {
+        return threadRecords ().entries.size ();
+    }
+
+    // Retired and not yet freed.
+    uint64_t pendingCount () const {
+        return retiredCount () - reclaimedCount ();
+    }
+
+    private:
+    static std::atomic<uint64_t>& nextId () {
+        static std::atomic<uint64_t> id = 1;
+        return id;
+    }
+
+    static std::mutex& registryMutex () {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::unordered_map<uint64_t, EpochDomain*>& registry () {
+        static std::unordered_map<uint64_t, EpochDomain*> domains;
+        return domains;
+    }
+
+    static ThreadRecords& threadRecords () {
+        thread_local ThreadRecords records;
+        return records;
+    }
+
+    Record& threadRecord () {
+        ThreadRecords& records = threadRecords ();
+        if (records.lastId == d_id) {
+            return *records.last;
+        }
+        auto it = std::find_if (records.entries.begin (), records.entries.end (),
+                                [this] (const auto& entry) { return entry.first == d_id; });
+        Record* record = nullptr;
+        if (it != records.entries.end ()) {
+            record = it->second;
+        } else {
+            pruneDestroyed (records);
+            record = acquireRecord ();
+            records.entries.emplace_back (d_id, record);
+        }
+        records.lastId = d_id;
+        records.last = record;
+        return *record;
+    }
+
+    // Drops the entries of domains that no longer exist, so that a thread that outlives many
+    // domains does not keep (and search) one entry per domain it ever used.
+    static void pruneDestroyed (ThreadRecords& records) {
+        std::lock_guard lock (registryMutex ());
+        std::erase_if (records.entries, [] (const auto& entry) {
+            return !registry ().contains (entry.first);
+        });
+    }
+
+    // A record left behind by an exited thread, or a new one.
+    Record* acquireRecord () {
+        for (Record* record = d_records.load (std::memory_order_acquire); record != nullptr;
+             record = record->next) {
+            bool free = false;
+            if (!record->inUse.load (std::memory_order_relaxed) &&
+                record->inUse.compare_exchange_strong (free, true, std::memory_order_acquire)) {
+                return record;
+            }
+        }
+        Record* record = new Record ();
+        record->inUse.store (true, std::memory_order_relaxed);
+        record->next = d_records.load (std::memory_order_relaxed);
+        while (!d_records.compare_exchange_weak (record->next, record, std::memory_order_release,
+                                                 std::memory_order_relaxed)) {
+        }
+        return record;
+    }
+
+    // The owner thread is exiting.
+    void release (Record& record) {
+        if (!record.retired.empty ()) {
+            std::lock_guard lock (d_orphanMutex);
+            // Both lists are ordered by epoch; keep the merged one ordered for reclaim ().
+            const size_t middle = d_orphans.size ();
+            d_orphans.insert (d_orphans.end (), record.retired.begin (), record.retired.end ());
+            std::inplace_merge (d_orphans.begin (),
+                                d_orphans.begin () + static_cast<ptrdiff_t> (middle),
+                                d_orphans.end (), [] (const Retired& a, const Retired& b) {
+                                    return a.epoch < b.epoch;
+                                });
+        }
+        record.retired.clear ();
+        record.nesting = 0;
+        record.hazardMask = 0;
+        record.sinceCollect = 0;
+        record.state.store (0, std::memory_order_release);
+        record.inUse.store (false, std::memory_order_release);
+    }
+
+    // The epoch moves on once every pinned thread has announced the current one.
+    void tryAdvance () {
+        uint64_t epoch = d_epoch.load (std::memory_order_seq_cst);
+        for (Record* record = d_records.load (std::memory_order_acquire); record != nullptr;
+             record = record->next) {
+            const uint64_t state = record->state.load (std::memory_order_seq_cst);
+            if ((state & 1) != 0 && (state >> 1) != epoch) {
+                return;
+            }
+        }
+        d_epoch.compare_exchange_strong (epoch, epoch + 1, std::memory_order_seq_cst);
+    }
+
+    void collect (Record& record) {
+        record.sinceCollect = 0;
+        tryAdvance ();
+        const uint64_t epoch = d_epoch.load (std::memory_order_acquire);
+        reclaim (record.retired, epoch);
+        if (d_orphanMutex.try_lock ()) {
+            reclaim (d_orphans, epoch);
+            d_orphanMutex.unlock ();
+        }
+    }
+
+    // Frees the entries of `retired` old enough at `epoch` that no hazard pointer protects. Every
+    // list, the orphans included, is ordered by epoch, so the candidates are a prefix; protected
+    // ones stay at the front.
+    void reclaim (std::vector<Retired>& retired, uint64_t epoch) {
+        size_t eligible = 0;
+        while (eligible < retired.size () && retired[eligible].epoch + 2 <= epoch) {
+            eligible++;
+        }
+        if (eligible == 0) {
+            return;
+        }
+        const std::vector<void*> hazards = protectedPointers ();
+        size_t kept = 0;
+        for (size_t i = 0; i < eligible; i++) {
+            if (std::binary_search (hazards.begin (), hazards.end (), retired[i].ptr)) {
+                retired[kept++] = retired[i];
+            } else {
+                retired[i].deleter (retired[i].ptr);
+            }
+        }
+        retired.erase (retired.begin () + static_cast<ptrdiff_t> (kept),
+                       retired.begin () + static_cast<ptrdiff_t> (eligible));
+        d_reclaimedCount.fetch_add (eligible - kept, std::memory_order_relaxed);
+    }
+
+    // Sorted snapshot of the published hazard pointers.
+    std::vector<void*> protectedPointers () const {
+        std::vector<void*> hazards;
+        // Pairs with protect (): either its re-check sees the node unlinked, or the scan sees it.
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        if (d_hazardsInUse.load (std::memory_order_seq_cst) == 0) {
+            return hazards;
+        }
+        for (Record* record = d_records.load (std::memory_order_acquire); record != nullptr;
+             record = record->next) {
+            for (const auto& hazard : record->hazards) {
+                if (void* ptr = hazard.load (std::memory_order_seq_cst)) {
+                    hazards.push_back (ptr);
+                }
+            }
+        }
+        std::sort (hazards.begin (), hazards.end ());
+        return hazards;
+    }
+
+    void freeAll (std::vector<Retired>& retired) {
+        for (const Retired& entry : retired) {
+            entry.deleter (entry.ptr);
+        }
+        d_reclaimedCount.fetch_add (retired.size (), std::memory_order_relaxed);
+        retired.clear ();
+    }
+
+    const uint64_t d_id;
+    alignas (CACHE_LINE_SIZE) std::atomic<uint64_t> d_epoch = 0;
+    std::atomic<Record*> d_records = nullptr;
+    std::atomic<size_t> d_hazardsInUse = 0;
+    alignas (CACHE_LINE_SIZE) std::atomic<uint64_t> d_retiredCount = 0;
+    std::atomic<uint64_t> d_reclaimedCount = 0;
+    std::mutex d_orphanMutex;
+    std::vector<Retired> d_orphans;
+};
+}  // namespace inplace
+
+#endif  // EPOCHRECLAMATION_HPP
@@ -2,90 +2,399 @@
 
 #ifndef FIXEDLIST_H
 #define FIXEDLIST_H
-#include <type_traits>
+#include <array>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <new>
-#include <array>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <InplaceCommon.hpp>
+#include <SpinLock.hpp>
 
-namespace inplace{
+namespace inplace {
 template <class T>
 concept ListType = std::is_default_constructible_v<T> && !std::is_const_v<T>;
 
-template <ListType T>
-class ListNode{
-  public:
-    using ListNodePtr = ListNode*;
-    using ListNodeAtomicPtr = std::atomic<ListNode*>;
-    template<class... Args>
-    void construct(Args... args) {
-        new (&d_data) T(std::forward<Args>(args)...);
+// Lock policy of a FixedList used by one thread at a time.
+struct NoListLock {
+    void lock () {
     }
 
-    T* data() {
-        return std::launder (reinterpret_cast<T*>(d_data.get()));
+    void unlock () {
     }
+};
+
+// Node of a FixedList: storage for one T plus its links, all as indices into the list's node
+// array. prev, next and generation belong to the list and change under its lock; nextFree is the
+// free-list link.
+template <ListType T>
+class ListNode {
+    public:
+    static constexpr uint32_t NullIndex = std::numeric_limits<uint32_t>::max ();
 
-    ListNodeAtomicPtr& next() {
-        return d_next;
+    template <class... Args>
+    void construct (Args&&... args) {
+        ::new (static_cast<void*> (d_storage)) T (std::forward<Args> (args)...);
     }
 
-    ListNodeAtomicPtr& prev() {
-        return d_prev;
+    void destroy () {
+        std::destroy_at (data ());
     }
 
-  private:
-    typedef std::aligned_storage_t<sizeof(T), alignof(T)> Storage;
-    Storage d_data;
-    ListNodeAtomicPtr d_next{nullptr};
-    ListNodeAtomicPtr d_prev{nullptr};
+    T* data () {
+        return std::launder (reinterpret_cast<T*> (d_storage));
+    }
 
-};
+    uint32_t prev = NullIndex;
+    uint32_t next = NullIndex;
+    // Bumped when the node leaves the list, which invalidates every handle to it.
+    uint32_t generation = 0;
+    std::atomic<uint32_t> nextFree = NullIndex;
 
-template <class M>
-concept SubscribeAble = requires(M t){
-    {t.subscribe()} -> std::same_as<int>;
+    private:
+    alignas (T) std::byte d_storage[sizeof (T)];
 };
 
-
-template <ListType T, size_t N>
+// Doubly linked list over N preallocated nodes: no allocation after construction. Nodes come from
+// an internal lock-free free-list (a Treiber stack of indices, tagged against ABA), so claiming
+// and returning a node never blocks and the value is constructed and destroyed outside the lock.
+// Linking is a handful of index writes under `Lock`: NoListLock for single-threaded use, a spin
+// lock (ConcurrentFixedList) to make every operation safe from any number of threads.
+//
+// push_front/push_back/unlink/move_to_front/move_to_back are O(1). Insertion hands out a Handle
+// that stays valid until its node is unlinked or popped; a stale handle is detected and rejected,
+// even when its node has been reused. The building block for allocation-free LRU caches (move the
+// hit to the front, evict from the back) and price-level order queues (append, cancel anywhere).
+template <ListType T, size_t N, class Lock = NoListLock>
 class FixedList {
-    private:
     using Node = ListNode<T>;
-    using NodePtr = typename Node::template ListNodeAtomicPtr<T>;
-    using WriterHandle = int;
-public:
 
-    FixedList() {
-        for (int i = 0; i < N; i++) {
-            d_data[i].next ().store(std::addressof (d_data[(i + 1)%N]), std::memory_order_relaxed);
-            d_data[i].prev ().store(std::addressof (d_data[(i + N - 1)%N]), std::memory_order_relaxed);
+    static constexpr uint32_t Null = Node::NullIndex;
+
+    static_assert (N > 0 && N < Null);
+
+    public:
+    class Handle {
+        public:
+        Handle () = default;
+
+        bool operator== (const Handle&) const = default;
+
+        private:
+        friend class FixedList;
+
+        Handle (uint32_t index, uint32_t generation) : d_index (index), d_generation (generation) {
         }
-        d_headCommitted = std::addressof(d_data[0]);
-        d_tail = std::addressof(d_data[0]);
+
+        uint32_t d_index = Null;
+        uint32_t d_generation = 0;
+    };
+
+    FixedList () {
+        for (uint32_t i = 0; i < N; i++) {
+            d_nodes[i].nextFree.store (i + 1 < N ? i + 1 : Null, std::memory_order_relaxed);
+        }
+        d_free.store (0, std::memory_order_release);
     }
 
-    template <class ... Args>
-    void write(Args...args, WriterHandle handle) {
-        auto head = d_writers[handle].load(std::memory_order_relaxed);
+    ~FixedList () {
+        for (uint32_t index = d_head; index != Null; index = d_nodes[index].next) {
+            d_nodes[index].destroy ();
+        }
     }
 
-    template <SubscribeAble M>
-    int subscribeWriter(M writer) {
-        return d_writers.push_back(writer);
+    FixedList (FixedList const&) = delete;
+
+    FixedList& operator= (FixedList const&) = delete;
+
+    // Empty when the list is full.
+    template <class... Args>
+    std::optional<Handle> emplace_front (Args&&... args) {
+        return emplace (true, std::forward<Args> (args)...);
     }
 
+    template <class... Args>
+    std::optional<Handle> emplace_back (Args&&... args) {
+        return emplace (false, std::forward<Args> (args)...);
+    }
 
-private:
-    NodePtr d_headCommitted{nullptr};
-    NodePtr d_tail;
-    NodePtr d_tailCommitted{nullptr};
-    std::atomic_size_t d_size{0};
-    std::array<Node, N> d_data;
-    template <SubscribeAble M>
-    std::vector<M> d_writers;
-};
+    std::optional<Handle> push_front (const T& value) {
+        return emplace_front (value);
+    }
+
+    std::optional<Handle> push_front (T&& value) {
+        return emplace_front (std::move (value));
+    }
+
+    std::optional<Handle> push_back (const T& value) {
+        return emplace_back (value);
+    }
+
+    std::optional<Handle> push_back (T&& value) {
+        return emplace_back (std::move (value));
+    }
 
+    // Removes and destroys the element; false if the handle is stale.
+    bool unlink (Handle handle) {
+        {
+            std::lock_guard lock (d_lock);
+            if (!live (handle)) {
+                return false;
+            }
+            remove (handle.d_index);
+        }
+        recycle (handle.d_index);
+        return true;
+    }
 
-}
+    bool move_to_front (Handle handle) {
+        std::lock_guard lock (d_lock);
+        if (!live (handle)) {
+            return false;
+        }
+        if (d_head != handle.d_index) {
+            detach (handle.d_index);
+            linkFront (handle.d_index);
+        }
+        return true;
+    }
+
+    bool move_to_back (Handle handle) {
+        std::lock_guard lock (d_lock);
+        if (!live (handle)) {
+            return false;
+        }
+        if (d_tail != handle.d_index) {
+            detach (handle.d_index);
+            linkBack (handle.d_index);
+        }
+        return true;
+    }
+
+    // Removes the first element and passes it to `callable` (outside the lock) before destroying
+    // it; false if the list is empty.
+    template <std::invocable<T&> Callable>
+    bool pop_front (Callable&& callable) {
+        return pop (true, std::forward<Callable> (callable));
+    }
+
+    template <std::invocable<T&> Callable>
+    bool pop_back (Callable&& callable) {
+        return pop (false, std::forward<Callable> (callable));
+    }
+
+    // Calls `callable (T&)` on the element under the lock; false if the handle is stale.
+    template <std::invocable<T&> Callable>
+    bool visit (Handle handle, Callable&& callable) {
+        std::lock_guard lock (d_lock);
+        if (!live (handle)) {
+            return false;
+        }
+        std::invoke (std::forward<Callable> (callable), *d_nodes[handle.d_index].data ());
+        return true;
+    }
+
+    // Unsynchronized access, for single-threaded lists or when the caller knows nobody unlinks the
+    // element meanwhile; nullptr if the handle is stale.
+    T* get (Handle handle) {
+        return live (handle) ? d_nodes[handle.d_index].data () : nullptr;
+    }
+
+    std::optional<Handle> front () const {
+        std::lock_guard lock (d_lock);
+        return handleOf (d_head);
+    }
+
+    std::optional<Handle> back () const {
+        std::lock_guard lock (d_lock);
+        return handleOf (d_tail);
+    }
+
+    // Calls `callable (Handle, T&)` front to back, with the list locked throughout.
+    template <std::invocable<Handle, T&> Callable>
+    void for_each (Callable&& callable) {
+        std::lock_guard lock (d_lock);
+        for (uint32_t index = d_head; index != Null; index = d_nodes[index].next) {
+            Node& node = d_nodes[index];
+            std::invoke (callable, Handle (index, node.generation), *node.data ());
+        }
+    }
+
+    size_t size (std::memory_order m = std::memory_order_acquire) const {
+        return d_size.load (m);
+    }
+
+    bool empty (std::memory_order m = std::memory_order_acquire) const {
+        return size (m) == 0;
+    }
+
+    bool full (std::memory_order m = std::memory_order_acquire) const {
+        return size (m) == N;
+    }
+
+    static constexpr size_t capacity () {
+        return N;
+    }
+
+    private:
+    template <class... Args>
+    std::optional<Handle> emplace (bool atFront, Args&&... args) {
+        const uint32_t index = allocate ();
+        if (index == Null) {
+            return std::nullopt;
+        }
+        Node& node = d_nodes[index];
+        try {
+            node.construct (std::forward<Args> (args)...);
+        } catch (...) {
+            release (index);
+            throw;
+        }
+        std::lock_guard lock (d_lock);
+        if (atFront) {
+            linkFront (index);
+        } else {
+            linkBack (index);
+        }
+        d_size.fetch_add (1, std::memory_order_relaxed);
+        return Handle (index, node.generation);
+    }
+
+    template <class Callable>
+    bool pop (bool atFront, Callable&& callable) {
+        uint32_t index;
+        {
+            std::lock_guard lock (d_lock);
+            index = atFront ? d_head : d_tail;
+            if (index == Null) {
+                return false;
+            }
+            remove (index);
+        }
+        try {
+            std::invoke (std::forward<Callable> (callable), *d_nodes[index].data ());
+        } catch (...) {
+            recycle (index);
+            throw;
+        }
+        recycle (index);
+        return true;
+    }
+
+    // A handle is issued when its node is linked and the generation moves on when the node is
+    // removed, so a matching generation means the node is still in the list.
+    bool live (Handle handle) const {
+        return handle.d_index < N && d_nodes[handle.d_index].generation == handle.d_generation;
+    }
+
+    // Under the lock.
+    std::optional<Handle> handleOf (uint32_t index) const {
+        if (index == Null) {
+            return std::nullopt;
+        }
+        return Handle (index, d_nodes[index].generation);
+    }
+
+    // Under the lock: takes a linked node out of the list for good.
+    void remove (uint32_t index) {
+        detach (index);
+        d_nodes[index].generation++;
+        d_size.fetch_sub (1, std::memory_order_relaxed);
+    }
+
+    // Outside the lock: nothing can reach a removed node any more.
+    void recycle (uint32_t index) {
+        d_nodes[index].destroy ();
+        release (index);
+    }
+
+    void linkFront (uint32_t index) {
+        Node& node = d_nodes[index];
+        node.prev = Null;
+        node.next = d_head;
+        if (d_head != Null) {
+            d_nodes[d_head].prev = index;
+        } else {
+            d_tail = index;
+        }
+        d_head = index;
+    }
+
+    void linkBack (uint32_t index) {
+        Node& node = d_nodes[index];
+        node.next = Null;
+        node.prev = d_tail;
+        if (d_tail != Null) {
+            d_nodes[d_tail].next = index;
+        } else {
+            d_head = index;
+        }
+        d_tail = index;
+    }
+
+    void detach (uint32_t index) {
+        Node& node = d_nodes[index];
+        if (node.prev != Null) {
+            d_nodes[node.prev].next = node.next;
+        } else {
+            d_head = node.next;
+        }
+        if (node.next != Null) {
+            d_nodes[node.next].prev = node.prev;
+        } else {
+            d_tail = node.prev;
+        }
+        node.prev = Null;
+        node.next = Null;
+    }
+
+    // Free-list: the low half of d_free is the first free index, the high half a tag bumped on
+    // every change so that a pop which read a stale next index cannot succeed.
+    static uint64_t tagged (uint64_t head, uint32_t index) {
+        return (((head >> 32) + 1) << 32) | index;
+    }
+
+    uint32_t allocate () {
+        uint64_t head = d_free.load (std::memory_order_acquire);
+        while (true) {
+            const auto index = static_cast<uint32_t> (head);
+            if (index == Null) {
+                return Null;
+            }
+            const uint32_t next = d_nodes[index].nextFree.load (std::memory_order_relaxed);
+            if (d_free.compare_exchange_weak (head, tagged (head, next), std::memory_order_acquire,
+                                              std::memory_order_acquire)) {
+                return index;
+            }
+        }
+    }
+
+    void release (uint32_t index) {
+        uint64_t head = d_free.load (std::memory_order_relaxed);
+        do {
+            d_nodes[index].nextFree.store (static_cast<uint32_t> (head), std::memory_order_relaxed);
+        } while (!d_free.compare_exchange_weak (head, tagged (head, index),
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+    }
+
+    alignas (CACHE_LINE_SIZE) std::atomic<uint64_t> d_free = Null;
+    alignas (CACHE_LINE_SIZE) mutable Lock d_lock;
+    uint32_t d_head = Null;
+    uint32_t d_tail = Null;
+    std::atomic<size_t> d_size = 0;
+    alignas (CACHE_LINE_SIZE) std::array<Node, N> d_nodes;
+};
+
+// Every operation may be called from any thread.
+template <ListType T, size_t N>
+using ConcurrentFixedList = FixedList<T, N, TTASSpinLock<>>;
+}  // namespace inplace
 
-#endif //FIXEDLIST_H
+#endif  // FIXEDLIST_H
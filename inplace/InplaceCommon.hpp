@@ -3,14 +3,51 @@
 #ifndef INPLACECOMMON_HPP
 #define INPLACECOMMON_HPP
 
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <thread>
 #include <type_traits>
 
 namespace inplace
 {
-    constexpr const int CACHE_LINE_SIZE = 128;
+    // Alignment used to keep independently written data on separate cache lines. Define
+    // INPLACE_CACHE_LINE_SIZE (CMake: -DINPLACE_CACHE_LINE_SIZE=128) to override the compiler's
+    // std::hardware_destructive_interference_size, e.g. to cover adjacent-line prefetching or to
+    // keep the layout of queues shared between processes independent of -mtune.
+#if defined(INPLACE_CACHE_LINE_SIZE)
+    constexpr const int CACHE_LINE_SIZE = INPLACE_CACHE_LINE_SIZE;
+#elif defined(__cpp_lib_hardware_interference_size)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winterference-size"
+#endif
+    constexpr const int CACHE_LINE_SIZE = static_cast<int> (std::hardware_destructive_interference_size);
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#else
+    constexpr const int CACHE_LINE_SIZE = 64;
+#endif
+    static_assert ((CACHE_LINE_SIZE & (CACHE_LINE_SIZE - 1)) == 0, "cache line size must be a power of two");
+
+    // Capacity argument selecting a queue whose capacity is chosen at construction time.
+    constexpr const int64_t DYNAMIC_CAPACITY = 0;
 
     template <class T>
     concept InplaceType = std::is_default_constructible_v<T> && !std::is_const_v<T>;
+
+    // Cheap per-thread pseudo random numbers (xorshift64*) for randomized load balancing; not
+    // suitable for anything that needs good statistical quality.
+    inline uint64_t fastRandom ()
+    {
+        thread_local uint64_t state =
+            std::hash<std::thread::id> {}(std::this_thread::get_id ()) | 1;
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
 }
 
 #endif //INPLACECOMMON_HPP
@@ -16,6 +16,15 @@ namespace inplace{
             std::cout << std::endl;
         }
     };
+
+    // debug == false: printing compiles away.
+    template <>
+    class InplaceOstream<false>{
+        public:
+        template<class... Args>
+        static void print(Args&&...){
+        }
+    };
 };
 
 #endif //INPLACEOSTREAM_HPP
@@ -0,0 +1,240 @@
+#ifndef LATENCYHISTOGRAM_HPP
+#define LATENCYHISTOGRAM_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <type_traits>
+
+namespace inplace {
+
+// HDR-style log-linear histogram over the whole uint64_t range. Values below 2^SubBucketBits get
+// a bucket each; above that every power-of-two range is split into 2^(SubBucketBits - 1) equal
+// buckets, so a recorded value is known to within a relative error of 2^-(SubBucketBits - 1)
+// (under 1.6% for the default) at any magnitude. Percentiles report the highest value of the
+// bucket they fall in, clamped to the largest value recorded.
+//
+// Recording is a handful of integer operations and one counter increment. With Concurrent set the
+// counters are relaxed atomics and any number of threads may record (and read) at once, e.g. from
+// a queue's stats hooks; otherwise one thread records at a time. The unit is up to the caller;
+// the latency benchmarks record nanoseconds.
+template <unsigned SubBucketBits = 7, bool Concurrent = false>
+class LogLinearHistogram {
+    static_assert (SubBucketBits >= 2 && SubBucketBits < 32);
+
+    using Counter = std::conditional_t<Concurrent, std::atomic<uint64_t>, uint64_t>;
+
+    static constexpr uint64_t SubBucketCount = uint64_t{ 1 } << SubBucketBits;
+    static constexpr uint64_t HalfCount = SubBucketCount / 2;
+
+    public:
+    static constexpr size_t BucketCount = SubBucketCount + (64 - SubBucketBits) * HalfCount;
+
+    LogLinearHistogram () : d_counts (std::make_unique<Counter[]> (BucketCount)) {
+    }
+
+    LogLinearHistogram (LogLinearHistogram const&) = delete;
+
+    LogLinearHistogram& operator= (LogLinearHistogram const&) = delete;
+
+    LogLinearHistogram (LogLinearHistogram&&) noexcept = default;
+
+    LogLinearHistogram& operator= (LogLinearHistogram&&) noexcept = default;
+
+    static constexpr size_t bucketOf (uint64_t value) {
+        if (value < SubBucketCount) {
+            return static_cast<size_t> (value);
+        }
+        const unsigned shift = std::bit_width (value) - SubBucketBits;
+        return static_cast<size_t> (SubBucketCount + (shift - 1) * HalfCount +
+                                    ((value >> shift) - HalfCount));
+    }
+
+    static constexpr uint64_t lowestValueOf (size_t bucket) {
+        if (bucket < SubBucketCount) {
+            return bucket;
+        }
+        const uint64_t offset = bucket - SubBucketCount;
+        const unsigned shift = static_cast<unsigned> (offset / HalfCount) + 1;
+        return (HalfCount + offset % HalfCount) << shift;
+    }
+
+    static constexpr uint64_t highestValueOf (size_t bucket) {
+        if (bucket < SubBucketCount) {
+            return bucket;
+        }
+        const unsigned shift = static_cast<unsigned> ((bucket - SubBucketCount) / HalfCount) + 1;
+        return lowestValueOf (bucket) + ((uint64_t{ 1 } << shift) - 1);
+    }
+
+    void record (uint64_t value, uint64_t count = 1) {
+        add (d_counts[bucketOf (value)], count);
+        add (d_total, count);
+        add (d_sum, value * count);
+        lower (d_min, value);
+        raise (d_max, value);
+    }
+
+    // Adds every sample of `other`, e.g. to combine per-thread histograms.
+    template <bool OtherConcurrent>
+    void merge (const LogLinearHistogram<SubBucketBits, OtherConcurrent>& other) {
+        if (other.count () == 0) {
+            return;
+        }
+        for (size_t bucket = 0; bucket < BucketCount; bucket++) {
+            if (const uint64_t count = other.countAt (bucket)) {
+                add (d_counts[bucket], count);
+            }
+        }
+        add (d_total, other.count ());
+        add (d_sum, other.sum ());
+        lower (d_min, other.min ());
+        raise (d_max, other.max ());
+    }
+
+    // Not atomic with respect to concurrent recording.
+    void reset () {
+        for (size_t bucket = 0; bucket < BucketCount; bucket++) {
+            store (d_counts[bucket], 0);
+        }
+        store (d_total, 0);
+        store (d_sum, 0);
+        store (d_min, std::numeric_limits<uint64_t>::max ());
+        store (d_max, 0);
+    }
+
+    uint64_t count () const {
+        return load (d_total);
+    }
+
+    uint64_t countAt (size_t bucket) const {
+        return load (d_counts[bucket]);
+    }
+
+    uint64_t sum () const {
+        return load (d_sum);
+    }
+
+    // 0 while empty.
+    uint64_t min () const {
+        return count () == 0 ? 0 : load (d_min);
+    }
+
+    uint64_t max () const {
+        return load (d_max);
+    }
+
+    double mean () const {
+        const uint64_t total = count ();
+        return total == 0 ? 0.0 : static_cast<double> (sum ()) / static_cast<double> (total);
+    }
+
+    // Smallest bucket bound that at least `percentile` percent of the samples do not exceed;
+    // 0 while empty.
+    uint64_t valueAtPercentile (double percentile) const {
+        const uint64_t total = count ();
+        if (total == 0) {
+            return 0;
+        }
+        const double clamped = std::clamp (percentile, 0.0, 100.0);
+        const uint64_t target = std::max<uint64_t> (
+            1, static_cast<uint64_t> (std::ceil (clamped / 100.0 * static_cast<double> (total))));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < BucketCount; bucket++) {
+            seen += countAt (bucket);
+            if (seen >= target) {
+                return std::min (highestValueOf (bucket), max ());
+            }
+        }
+        return max ();
+    }
+
+    // Calls `f (lowest, highest, count)` for every non-empty bucket in increasing order.
+    template <class F>
+    void forEachBucket (F&& f) const {
+        for (size_t bucket = 0; bucket < BucketCount; bucket++) {
+            if (const uint64_t count = countAt (bucket)) {
+                f (lowestValueOf (bucket), highestValueOf (bucket), count);
+            }
+        }
+    }
+
+    // One row per non-empty bucket: its bounds, its count and the share of samples up to and
+    // including it.
+    void writeCsv (std::ostream& os) const {
+        const double total = static_cast<double> (count ());
+        uint64_t seen = 0;
+        os << "lowest,highest,count,cumulative_percentile\n";
+        forEachBucket ([&] (uint64_t lowest, uint64_t highest, uint64_t count) {
+            seen += count;
+            os << lowest << ',' << highest << ',' << count << ','
+               << 100.0 * static_cast<double> (seen) / total << '\n';
+        });
+    }
+
+    private:
+    static uint64_t load (const Counter& counter) {
+        if constexpr (Concurrent) {
+            return counter.load (std::memory_order_relaxed);
+        } else {
+            return counter;
+        }
+    }
+
+    static void store (Counter& counter, uint64_t value) {
+        if constexpr (Concurrent) {
+            counter.store (value, std::memory_order_relaxed);
+        } else {
+            counter = value;
+        }
+    }
+
+    static void add (Counter& counter, uint64_t value) {
+        if constexpr (Concurrent) {
+            counter.fetch_add (value, std::memory_order_relaxed);
+        } else {
+            counter += value;
+        }
+    }
+
+    static void lower (Counter& counter, uint64_t value) {
+        if constexpr (Concurrent) {
+            uint64_t current = counter.load (std::memory_order_relaxed);
+            while (value < current &&
+                   !counter.compare_exchange_weak (current, value, std::memory_order_relaxed)) {
+            }
+        } else {
+            counter = std::min (counter, value);
+        }
+    }
+
+    static void raise (Counter& counter, uint64_t value) {
+        if constexpr (Concurrent) {
+            uint64_t current = counter.load (std::memory_order_relaxed);
+            while (value > current &&
+                   !counter.compare_exchange_weak (current, value, std::memory_order_relaxed)) {
+            }
+        } else {
+            counter = std::max (counter, value);
+        }
+    }
+
+    std::unique_ptr<Counter[]> d_counts;
+    Counter d_total = 0;
+    Counter d_sum = 0;
+    Counter d_min = std::numeric_limits<uint64_t>::max ();
+    Counter d_max = 0;
+};
+
+// Shared by any number of recording threads.
+template <unsigned SubBucketBits = 7>
+using ConcurrentLogLinearHistogram = LogLinearHistogram<SubBucketBits, true>;
+}  // namespace inplace
+
+#endif  // LATENCYHISTOGRAM_HPP
@@ -8,16 +8,26 @@
 #include <tuple>
 #include <InplaceCommon.hpp>
 #include <memory>
+#include <optional>
 #include <stdalign.h>
 #include <type_traits>
 #include <functional>
+#include <algorithm>
+#include <ranges>
+#include <span>
 #include <SpinLock.hpp>
+#include <Parking.hpp>
+#include <SlotArray.hpp>
+#include <SlotHandle.hpp>
+#include <QueueStats.hpp>
+#include <Tracing.hpp>
+#include <chrono>
 
 #include "InplaceOstream.hpp"
 
 namespace inplace {
 template <class T>
-concept MPMCLockFreeType = std::is_default_constructible_v<T> && !std::is_const_v<T>;
+concept MPMCLockFreeType = std::is_nothrow_move_constructible_v<T> && !std::is_const_v<T>;
 
 struct MPMCNodeTraits {
     static constexpr int NULL_INDEX = -1;
@@ -36,6 +46,8 @@ class MPMCNode {
     static constexpr const int64_t WRITING = 2;
     static constexpr const int64_t READING = 3;
     static constexpr const int64_t WRITTEN = 4;
+    // Committed without an element: the producer abandoned its claim. Consumers step over it.
+    static constexpr const int64_t SKIPPED = 5;
 
     private:
     typedef std::aligned_storage_t<sizeof (T), alignof (T)> StorageType;
@@ -44,7 +56,7 @@ class MPMCNode {
 
     public:
     template <class... Args>
-    T* create (Args... args) {
+    T* create (Args&&... args) {
         return ::new (&d_data) T (std::forward<Args> (args)...);
     }
 
@@ -56,6 +68,10 @@ class MPMCNode {
         return *std::launder (reinterpret_cast<T*> (&d_data));
     }
 
+    void* storage () {
+        return &d_data;
+    }
+
     void resetFlag () {
         d_state.store (NEUTRAL, std::memory_order_release);
     }
@@ -70,11 +86,12 @@ class MPMCNode {
 
     std::string statusAsString () const {
         static const std::string names[] = {
+            "INVALID",
             "NEUTRAL",
             "WRITING",
             "READING",
             "WRITTEN",
-            "INVALID"
+            "SKIPPED"
         };
         return names[d_state.load (std::memory_order::acquire)];
     }
@@ -86,15 +103,49 @@ std::ostream& operator << (std::ostream& os, const MPMCNode<T>& node) {
     return os;
 }
 
-template <MPMCLockFreeType T, int64_t Capacity, bool debug = true, SpinLockWaitStrategy Strategy =
-                              WaitStrategy1>
+// `debug` prints full/empty rejections as they happen; `Stats` counts them (and more, see
+// QueueStats.hpp) without printing. Both default to off. `Layout` places the nodes (see
+// SlotArray.hpp): packed by default; PaddedSlots or SwizzledSlots keep threads working on
+// neighbouring indices off each other's cache lines. `BlockingPolicy` enables
+// enqueueWait/dequeueWait (see Parking.hpp); without it nothing on the enqueue/dequeue path looks
+// for parked threads.
+template <MPMCLockFreeType T, int64_t Capacity, bool debug = false, SpinLockWaitStrategy Strategy =
+                              WaitStrategy1, QueueStatsPolicy Stats = NoQueueStats,
+          SlotLayoutPolicy Layout = PackedSlots, QueueBlockingPolicy BlockingPolicy = NonBlocking>
 class MPMCQueue : public MPMCNodeTraits {
     public:
-    MPMCQueue () {
+    using value_type = T;
+
+    MPMCQueue ()
+        requires (Capacity != DYNAMIC_CAPACITY)
+    {
         d_writerCommitted.index.store (0, std::memory_order::relaxed);
     }
 
-    ~MPMCQueue () = default;
+    // For placement in memory shared between processes (see SharedMemoryQueue).
+    explicit MPMCQueue (ProcessSharedTag tag)
+        requires (Capacity != DYNAMIC_CAPACITY)
+        : d_notEmpty (tag), d_notFull (tag) {
+        d_writerCommitted.index.store (0, std::memory_order::relaxed);
+    }
+
+    // Runtime-sized queue (Capacity == DYNAMIC_CAPACITY) whose nodes live in their own mapping.
+    explicit MPMCQueue (int64_t capacity, MappingOptions options = {})
+        requires (Capacity == DYNAMIC_CAPACITY)
+        : d_queue (capacity, options) {
+        d_writerCommitted.index.store (0, std::memory_order::relaxed);
+    }
+
+    // Destroys the elements nobody dequeued. Goes by the node states rather than the cursors: a
+    // reader that gave up on a stopped queue has already moved d_reader past its slot.
+    ~MPMCQueue () {
+        for (int64_t i = 0; i < capacity (); i++) {
+            auto& node = d_queue[i];
+            if (node.state ().load (std::memory_order_relaxed) == Node::WRITTEN) {
+                node.asData ().~T ();
+            }
+        }
+    }
 
     MPMCQueue (MPMCQueue const&) = delete;
 
@@ -106,6 +157,8 @@ class MPMCQueue : public MPMCNodeTraits {
 
     void stop () {
         d_stop.store (true, std::memory_order_release);
+        d_notEmpty.notifyAll ();
+        d_notFull.notifyAll ();
     }
 
     bool isRunning () const {
@@ -114,64 +167,228 @@ class MPMCQueue : public MPMCNodeTraits {
 
     void print () {
         std::cout << std::this_thread::get_id () << std::endl;
-        for (int i = 0; i < Capacity; i++) {
+        for (int64_t i = 0; i < capacity (); i++) {
             std::cout << d_queue[i] << std::endl;
         }
     }
 
     template <class... Args>
     bool enqueue (Args&&... args) {
-        if (full (std::memory_order_acquire)) {
+        if (reserveSize (1) == 0) {
             InplaceOstream<debug>::print ("full");
+            d_stats.onFull ();
+            INPLACE_TRACE_INSTANT ("mpmc.full");
             return false;
         }
 
         int64_t index = getNextWriteIndex ();
         if (index == NULL_INDEX) {
+            decreaseSize ();
             return false;
         }
-        auto& node = d_queue[index % Capacity];
-        node.create (std::forward<Args&&> (args)...);
-        node.setWrittenFlag ();
-
-        advanceWriteCommitted (index);
-
-        increaseSize ();
+        d_queue[index % capacity ()].create (std::forward<Args&&> (args)...);
+        commitClaim (index);
         return true;
     }
 
     template <std::invocable<const T&> Callable>
     bool dequeue (Callable&& callable) {
-        if (empty (std::memory_order_acquire)) {
-            InplaceOstream<debug>::print ("empty");
+        int64_t index = claimElement ();
+        if (index == NULL_INDEX) {
             return false;
         }
 
-        if (d_reader.index.load (std::memory_order_relaxed) >= d_writerCommitted.index.load (
-                std::memory_order_relaxed)
-        ) {
-            if (d_reader.index.load (std::memory_order_acquire) >= d_writerCommitted.index.load (
-                    std::memory_order_acquire)
-            ) {
-                InplaceOstream<debug>::print ("empty2");
-                return false;
-            }
-        }
+        std::invoke (std::forward<Callable> (callable), d_queue[index % capacity ()].asData ());
+        releasePeek (index);
+        return true;
+    }
 
-        int64_t index = getNextReadIndex ();
+    // Zero-copy producer side: reserves a slot for the caller to construct in place. The slot is
+    // owned by the ring once claimed, so a claim dropped without commit () is committed as a
+    // SKIPPED node that consumers step over. Later commits wait for earlier claims, so commit (or
+    // drop) promptly.
+    ClaimedSlot<MPMCQueue, T> tryClaim () {
+        if (reserveSize (1) == 0) {
+            InplaceOstream<debug>::print ("full");
+            d_stats.onFull ();
+            INPLACE_TRACE_INSTANT ("mpmc.full");
+            return {};
+        }
+        int64_t index = getNextWriteIndex ();
+        if (index == NULL_INDEX) {
+            decreaseSize ();
+            return {};
+        }
+        return { this, index, d_queue[index % capacity ()].storage () };
+    }
 
+    // Zero-copy consumer side: exposes a committed element in place until the view is released.
+    PeekedSlot<MPMCQueue, T> tryPeek () {
+        int64_t index = claimElement ();
         if (index == NULL_INDEX) {
+            return {};
+        }
+        return { this, index, std::addressof (d_queue[index % capacity ()].asData ()) };
+    }
+
+    // Moves an element out of its slot instead of handing out a reference to it.
+    std::optional<T> tryDequeue () {
+        auto view = tryPeek ();
+        if (!view) {
+            return std::nullopt;
+        }
+        return std::optional<T> (std::move (*view));
+    }
+
+    bool tryDequeue (T& out) {
+        auto view = tryPeek ();
+        if (!view) {
             return false;
         }
+        out = std::move (*view);
+        return true;
+    }
 
-        auto& node = d_queue[index % Capacity];
-        std::invoke (std::forward<Callable> (callable), node.asData ());
-        node.asData ().~T ();
+    // Blocking variants of enqueue/dequeue: retry while `WaitPolicy` spins, then park until the
+    // other side makes progress, the queue is stopped or `timeout` expires. Return false
+    // unless the element was transferred. A producer only takes a slot once it has reserved room
+    // for it, so past that point enqueueWait at most waits for a consumer that already holds the
+    // slot to finish with it.
+    template <SpinLockWaitStrategy WaitPolicy = SpinThenPark, class Rep, class Period,
+              class... Args>
+    bool enqueueWait (std::chrono::duration<Rep, Period> timeout, Args&&... args)
+        requires std::same_as<BlockingPolicy, Blocking>
+    {
+        bool done = false;
+        parkUntil<WaitPolicy> (d_notFull, Parker::deadlineAfter (timeout), [&] {
+            done = enqueue (std::forward<Args> (args)...);
+            return done || !isRunning ();
+        }, d_stats);
+        return done;
+    }
 
-        node.resetFlag ();
+    template <SpinLockWaitStrategy WaitPolicy = SpinThenPark, class Rep, class Period,
+              std::invocable<const T&> Callable>
+    bool dequeueWait (std::chrono::duration<Rep, Period> timeout, Callable&& callable)
+        requires std::same_as<BlockingPolicy, Blocking>
+    {
+        bool done = false;
+        parkUntil<WaitPolicy> (d_notEmpty, Parker::deadlineAfter (timeout), [&] {
+            done = dequeue (callable);
+            return done || !isRunning ();
+        }, d_stats);
+        return done;
+    }
 
-        decreaseSize ();
-        return true;
+    // Reserves room for the whole batch with a single size update and a single bump of the writer
+    // cursor, and commits it at once. Only as many elements as currently fit are copied from
+    // `range`. Returns the number of elements enqueued. If a copy throws, the elements copied
+    // before it stay enqueued and the rest of the reserved slots are skipped.
+    template <std::ranges::sized_range Range>
+    size_t enqueueBulk (Range&& range) {
+        const size_t count = reserveSize (std::ranges::size (range));
+        if (count == 0) {
+            InplaceOstream<debug>::print ("full");
+            d_stats.onFull ();
+            INPLACE_TRACE_INSTANT ("mpmc.full");
+            return 0;
+        }
+
+        const int64_t first = d_writer.index.fetch_add (count, std::memory_order_acquire);
+        size_t written = 0;
+        bool filling = false;
+        try {
+            for (auto it = std::ranges::begin (range); written < count; ++written, ++it) {
+                if (!acquireNode (first + written, Node::NEUTRAL, Node::WRITING)) {
+                    break;
+                }
+                auto& node = d_queue[(first + written) % capacity ()];
+                filling = true;
+                node.create (*it);
+                node.setWrittenFlag ();
+                filling = false;
+            }
+        } catch (...) {
+            // The slots are reserved already: commit the rest of the batch as SKIPPED, so that the
+            // elements written so far and later claims still commit.
+            for (size_t i = written; i < count; i++) {
+                if (i == written && filling) {
+                    d_queue[(first + i) % capacity ()].state ().store (Node::SKIPPED,
+                                                                       std::memory_order_release);
+                } else if (!acquireNode (first + i, Node::NEUTRAL, Node::SKIPPED)) {
+                    break;
+                }
+            }
+            advanceWriteCommitted (first, count);
+            d_stats.onEnqueue (written, [this] { return size (); });
+            d_notEmpty.notify (count);
+            throw;
+        }
+
+        advanceWriteCommitted (first, written);
+        // A stopped queue leaves the rest of the batch unwritten.
+        decreaseSize (count - written);
+        d_stats.onEnqueue (written, [this] { return size (); });
+        INPLACE_TRACE_INSTANT ("mpmc.enqueue", first, written);
+        d_notEmpty.notify (written);
+        return written;
+    }
+
+    // Claims up to `maxN` committed elements with a single CAS of the reader cursor and hands them
+    // to `callable` as spans. Nodes interleave payload and state, so every span holds exactly one
+    // element; the single cursor bump and size update are what the batch saves. Skipped nodes
+    // (abandoned claims) are released without a call; a batch of nothing but skipped nodes claims
+    // the next one. Returns the number of elements dequeued.
+    template <std::invocable<std::span<T>> Callable>
+    size_t dequeueBulk (size_t maxN, Callable&& callable) {
+        while (true) {
+            int64_t first = d_reader.index.load (std::memory_order_acquire);
+            size_t count = 0;
+            while (true) {
+                const int64_t committed = d_writerCommitted.index.load (std::memory_order_acquire);
+                if (committed <= first) {
+                    InplaceOstream<debug>::print ("empty");
+                    d_stats.onEmpty ();
+                    INPLACE_TRACE_INSTANT ("mpmc.empty");
+                    return 0;
+                }
+                count = std::min (maxN, static_cast<size_t> (committed - first));
+                if (count == 0) {
+                    return 0;
+                }
+                if (d_reader.index.compare_exchange_strong (first, first + count,
+                                                            std::memory_order_acquire)) {
+                    break;
+                }
+                d_stats.onCasRetry ();
+            }
+
+            size_t taken = 0;
+            size_t read = 0;
+            for (; taken < count; taken++) {
+                const int64_t from =
+                    acquireNode (first + taken, Node::WRITTEN, Node::READING, Node::SKIPPED);
+                if (from == 0) {
+                    break;
+                }
+                auto& node = d_queue[(first + taken) % capacity ()];
+                if (from == Node::WRITTEN) {
+                    std::invoke (callable, std::span<T> (std::addressof (node.asData ()), 1));
+                    node.asData ().~T ();
+                    read++;
+                }
+                node.resetFlag ();
+            }
+
+            decreaseSize (taken);
+            d_notFull.notify (taken);
+            if (read == 0 && taken == count) {
+                continue;
+            }
+            d_stats.onDequeue (read);
+            INPLACE_TRACE_INSTANT ("mpmc.dequeue", first, read);
+            return read;
+        }
     }
 
     size_t size (std::memory_order m = std::memory_order_acquire) const {
@@ -183,63 +400,172 @@ class MPMCQueue : public MPMCNodeTraits {
     }
 
     bool full (std::memory_order m = std::memory_order_acquire) const {
-        return d_size.load (m) == Capacity;
+        return d_size.load (m) == static_cast<size_t> (capacity ());
+    }
+
+    int64_t capacity () const {
+        return d_queue.size ();
+    }
+
+    QueueStatsSnapshot stats () const {
+        return d_stats.snapshot ();
     }
 
     private:
+    template <class, class>
+    friend class ClaimedSlot;
+    template <class, class>
+    friend class PeekedSlot;
+
+    void commitClaim (int64_t index) {
+        d_queue[index % capacity ()].setWrittenFlag ();
+        advanceWriteCommitted (index);
+        d_stats.onEnqueue (1, [this] { return size (); });
+        INPLACE_TRACE_INSTANT ("mpmc.enqueue", index, 1);
+        d_notEmpty.notify ();
+    }
+
+    // Commits the slot as SKIPPED, so that later claims still commit and consumers step over it.
+    // It counts towards size () until a consumer releases it.
+    void abandonClaim (int64_t index) {
+        d_queue[index % capacity ()].state ().store (Node::SKIPPED, std::memory_order_release);
+        advanceWriteCommitted (index);
+    }
+
+    void releasePeek (int64_t index) {
+        auto& node = d_queue[index % capacity ()];
+        node.asData ().~T ();
+        node.resetFlag ();
+        decreaseSize ();
+        d_stats.onDequeue (1);
+        INPLACE_TRACE_INSTANT ("mpmc.dequeue", index, 1);
+        d_notFull.notify ();
+    }
+
     [[nodiscard]] int64_t getNextWriteIndex () {
         int64_t index = d_writer.index.fetch_add (1, std::memory_order_acquire);
-        Strategy strategy;
-        auto& node = d_queue[index % Capacity];
-        auto& state = node.state ();
-        int64_t expectedState = MPMCNode::NEUTRAL;
-        while (!state.compare_exchange_strong (expectedState, MPMCNode::WRITING,
-                                               std::memory_order_acquire)) {
-            if (!isRunning ()) {
-                index = NULL_INDEX;
-                break;
+        if (!acquireNode (index, Node::NEUTRAL, Node::WRITING)) {
+            return NULL_INDEX;
+        }
+        return index;
+    }
+
+    // Claims the next committed element for a consumer and moves its node to READING. Skipped
+    // nodes met on the way are handed straight back to the producers. Returns NULL_INDEX when
+    // the queue is empty or stopped.
+    [[nodiscard]] int64_t claimElement () {
+        while (true) {
+            if (empty (std::memory_order_acquire)) {
+                InplaceOstream<debug>::print ("empty");
+                d_stats.onEmpty ();
+                INPLACE_TRACE_INSTANT ("mpmc.empty");
+                return NULL_INDEX;
             }
-            expectedState = MPMCNode::NEUTRAL;
-            if (!strategy.wait ()) {
-                strategy.reset ();
+
+            // Only take reader indices below the commit cursor, like dequeueBulk () does. A bare
+            // fetch_add would let two consumers go for the last element, and the loser would wait
+            // for a slot that no producer has written yet.
+            int64_t index = d_reader.index.load (std::memory_order_acquire);
+            bool claimed = false;
+            while (index < d_writerCommitted.index.load (std::memory_order_acquire)) {
+                if (d_reader.index.compare_exchange_weak (index, index + 1,
+                                                          std::memory_order_acquire)) {
+                    claimed = true;
+                    break;
+                }
+                d_stats.onCasRetry ();
+            }
+            if (!claimed) {
+                InplaceOstream<debug>::print ("empty2");
+                d_stats.onEmpty ();
+                INPLACE_TRACE_INSTANT ("mpmc.empty");
+                return NULL_INDEX;
+            }
+            const int64_t from = acquireNode (index, Node::WRITTEN, Node::READING, Node::SKIPPED);
+            if (from == 0) {
+                return NULL_INDEX;
             }
+            if (from == Node::WRITTEN) {
+                return index;
+            }
+            d_queue[index % capacity ()].resetFlag ();
+            decreaseSize ();
+            d_notFull.notify ();
         }
-        return index;
     }
 
-    [[nodiscard]] int64_t getNextReadIndex () {
-        int64_t index = d_reader.index.fetch_add (1, std::memory_order_acquire);
+    // Moves the node at `index` from `fromState` (or from `orFromState`, when given) to `toState`,
+    // waiting for the slot's previous owner to finish. Returns the state the node left, or 0 when
+    // the queue is stopped.
+    [[nodiscard]] int64_t acquireNode (int64_t index, int64_t fromState, int64_t toState,
+                                       int64_t orFromState = 0) {
         Strategy strategy;
-        auto& node = d_queue[index % Capacity];
-        auto& state = node.state ();
-        int64_t expectedState = MPMCNode::WRITTEN;
-        while (!state.compare_exchange_strong (expectedState, MPMCNode::READING,
+        auto& state = d_queue[index % capacity ()].state ();
+        int64_t expectedState = fromState;
+        while (!state.compare_exchange_strong (expectedState, toState,
+                                               std::memory_order_acquire)) {
+            if (expectedState == orFromState &&
+                state.compare_exchange_strong (expectedState, toState,
                                                std::memory_order_acquire)) {
+                return orFromState;
+            }
+            d_stats.onCasRetry ();
             if (!isRunning ()) {
-                index = NULL_INDEX;
-                break;
+                return 0;
             }
-            expectedState = MPMCNode::WRITTEN;
+            expectedState = fromState;
             if (!strategy.wait ()) {
                 strategy.reset ();
             }
+            d_stats.onSpin ();
         }
-        return index;
+        return fromState;
     }
 
-    void increaseSize () {
-        d_size.fetch_add (1, std::memory_order_release);
+    // Reserves room for up to `wanted` elements before a producer takes writer indices, so that
+    // every index taken has a slot that is free or held by a consumer that has claimed it already.
+    // A plain full () check would let two producers race for the last slot and the loser wait
+    // for a consumer to come along. Returns the number of elements reserved.
+    [[nodiscard]] size_t reserveSize (size_t wanted) {
+        size_t current = d_size.load (std::memory_order_acquire);
+        while (true) {
+            const size_t free = capacity () - std::min (current, static_cast<size_t> (capacity ()));
+            const size_t count = std::min (free, wanted);
+            if (count == 0) {
+                return 0;
+            }
+            if (d_size.compare_exchange_weak (current, current + count, std::memory_order_acq_rel,
+                                              std::memory_order_acquire)) {
+                return count;
+            }
+            d_stats.onCasRetry ();
+        }
     }
 
-    void decreaseSize () {
-        d_size.fetch_sub (1, std::memory_order_release);
+    void decreaseSize (size_t count = 1) {
+        d_size.fetch_sub (count, std::memory_order_release);
     }
 
-    void advanceWriteCommitted (int64_t currIndex) {
+    // Commits wait for every earlier claim to commit first, which only takes the claimant a few
+    // stores, so never sleep through `Strategy` here: spin with a pause hint for a bounded number
+    // of rounds, then yield in case the claimant was preempted. Gives up once the queue is stopped:
+    // a claim that stop () interrupted never commits, so the cursor may never reach `currIndex`.
+    void advanceWriteCommitted (int64_t currIndex, int64_t count = 1) {
+        size_t rounds = 0;
         int64_t lastPotentialIndex = currIndex;
         while (!d_writerCommitted.index.compare_exchange_strong (
-            lastPotentialIndex, currIndex + 1, std::memory_order_acquire)) {
+            lastPotentialIndex, currIndex + count, std::memory_order_acquire)) {
+            d_stats.onCasRetry ();
+            if (!isRunning ()) {
+                return;
+            }
             lastPotentialIndex = currIndex;
+            if (rounds < COMMIT_SPIN_ROUNDS) {
+                cpuRelax ();
+                rounds++;
+            } else {
+                std::this_thread::yield ();
+            }
         }
     }
 
@@ -252,14 +578,18 @@ class MPMCQueue : public MPMCNodeTraits {
     }
 
     private:
-    using MPMCNode = MPMCNode<T>;
+    static constexpr size_t COMMIT_SPIN_ROUNDS = 256;
+    using Node = MPMCNode<T>;
     std::atomic<size_t> d_size = 0;
     std::atomic_bool d_stop = false;
-    std::array<MPMCNode, Capacity> d_queue;
+    SlotArray<Node, Capacity, Layout> d_queue;
     MPMCIndexTraits<int64_t> d_writer;
     MPMCIndexTraits<int64_t> d_writerCommitted;
     MPMCIndexTraits<int64_t> d_reader;
     MPMCIndexTraits<int64_t> d_readerCommitted;
+    [[no_unique_address]] QueueParker<BlockingPolicy> d_notEmpty;
+    [[no_unique_address]] QueueParker<BlockingPolicy> d_notFull;
+    [[no_unique_address]] Stats d_stats;
 };
 }
 
@@ -0,0 +1,152 @@
+#ifndef MAPPEDREGION_HPP
+#define MAPPEDREGION_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace inplace {
+
+enum class HugePages {
+    None,         // regular pages
+    Transparent,  // 2MB aligned mapping advised with MADV_HUGEPAGE; silently small pages if THP is off
+    Explicit      // MAP_HUGETLB from the reserved hugetlbfs pool; throws if none are available
+};
+
+struct MappingOptions {
+    HugePages hugePages = HugePages::None;
+    // Touch every page at construction so the first burst through the queue does not fault.
+    bool prefault = true;
+};
+
+// Owning, move-only anonymous memory mapping used as slot storage for runtime-sized queues.
+class MappedRegion {
+    public:
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    MappedRegion () = default;
+
+    explicit MappedRegion (size_t bytes, MappingOptions options = {}) {
+        if (bytes == 0) {
+            throw std::invalid_argument ("MappedRegion requires a non-zero size");
+        }
+        switch (options.hugePages) {
+            case HugePages::None:
+                d_size = roundUp (bytes, pageSize ());
+                d_data = map (d_size, 0, "mmap");
+                break;
+            case HugePages::Transparent:
+                d_size = roundUp (bytes, HUGE_PAGE_SIZE);
+                d_data = mapAligned (d_size, HUGE_PAGE_SIZE);
+#if defined(MADV_HUGEPAGE)
+                // Best effort: without THP support the region simply stays on small pages.
+                (void)::madvise (d_data, d_size, MADV_HUGEPAGE);
+#endif
+                break;
+            case HugePages::Explicit:
+#if defined(MAP_HUGETLB)
+                d_size = roundUp (bytes, HUGE_PAGE_SIZE);
+                d_data = map (d_size, MAP_HUGETLB, "mmap(MAP_HUGETLB)");
+                break;
+#else
+                throw std::system_error (std::make_error_code (std::errc::not_supported),
+                                         "explicit huge pages are not supported");
+#endif
+        }
+        if (options.prefault) {
+            prefault ();
+        }
+    }
+
+    ~MappedRegion () {
+        release ();
+    }
+
+    MappedRegion (MappedRegion const&) = delete;
+
+    MappedRegion& operator= (MappedRegion const&) = delete;
+
+    MappedRegion (MappedRegion&& rhs) noexcept
+        : d_data (std::exchange (rhs.d_data, nullptr)), d_size (std::exchange (rhs.d_size, 0)) {
+    }
+
+    MappedRegion& operator= (MappedRegion&& rhs) noexcept {
+        if (this != &rhs) {
+            release ();
+            d_data = std::exchange (rhs.d_data, nullptr);
+            d_size = std::exchange (rhs.d_size, 0);
+        }
+        return *this;
+    }
+
+    void* data () const {
+        return d_data;
+    }
+
+    // Mapped size, i.e. the requested size rounded up to the page size in use.
+    size_t size () const {
+        return d_size;
+    }
+
+    static size_t pageSize () {
+        static const size_t size = static_cast<size_t> (::sysconf (_SC_PAGESIZE));
+        return size;
+    }
+
+    private:
+    static size_t roundUp (size_t value, size_t multiple) {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    static void* map (size_t bytes, int extraFlags, const char* what) {
+        void* data = ::mmap (nullptr, bytes, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+        if (data == MAP_FAILED) {
+            throw std::system_error (errno, std::generic_category (), what);
+        }
+        return data;
+    }
+
+    // Over-maps by one alignment unit and trims both ends so the region starts on `alignment`.
+    static void* mapAligned (size_t bytes, size_t alignment) {
+        char* raw = static_cast<char*> (map (bytes + alignment, 0, "mmap"));
+        const auto address = reinterpret_cast<uintptr_t> (raw);
+        char* aligned = raw + (roundUp (address, alignment) - address);
+        const size_t head = aligned - raw;
+        const size_t tail = alignment - head;
+        if (head != 0) {
+            ::munmap (raw, head);
+        }
+        if (tail != 0) {
+            ::munmap (aligned + bytes, tail);
+        }
+        return aligned;
+    }
+
+    void prefault () {
+        volatile char* bytes = static_cast<volatile char*> (d_data);
+        for (size_t offset = 0; offset < d_size; offset += pageSize ()) {
+            bytes[offset] = 0;
+        }
+    }
+
+    void release () {
+        if (d_data != nullptr) {
+            ::munmap (d_data, d_size);
+            d_data = nullptr;
+            d_size = 0;
+        }
+    }
+
+    void* d_data = nullptr;
+    size_t d_size = 0;
+};
+}  // namespace inplace
+
+#endif  // MAPPEDREGION_HPP
@@ -0,0 +1,244 @@
+#ifndef MULTIQUEUE_HPP
+#define MULTIQUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <InplaceCommon.hpp>
+#include <QueueStats.hpp>
+#include <SkipListPriorityQueue.hpp>
+#include <SpinLock.hpp>
+#include <Tracing.hpp>
+
+namespace inplace {
+
+// Relaxed concurrent priority queue (Rihani, Sanders & Dementiev's MultiQueue): `heapsPerThread`
+// binary heaps per thread, each behind its own spin lock. enqueue () pushes onto a random heap;
+// dequeue () looks at two random heaps and pops the better top. The element returned is not
+// necessarily the global best but close to it with high probability, while threads rarely touch
+// the same heap. `Compare` orders like std::priority_queue: std::less dequeues the largest first.
+//
+// Same enqueue/dequeue shape as MPMCQueue. Heap storage for `Capacity` elements (plus slack for
+// uneven spreading) is reserved up front. Use ConcurrentPriorityQueue to choose between this and
+// the exact SkipListPriorityQueue. A heap is only held for one push or pop, so waiting for one goes
+// through `Strategy` as a TTASSpinLock; keep it a strategy that spins before it sleeps.
+template <class T, int64_t Capacity, class Compare = std::less<T>,
+          SpinLockWaitStrategy Strategy = WaitStrategyAdaptive,
+          QueueStatsPolicy Stats = NoQueueStats>
+class MultiQueue {
+    static_assert (Capacity > 0);
+    static_assert (std::is_nothrow_move_constructible_v<T>);
+
+    struct alignas (inplace::CACHE_LINE_SIZE) Heap {
+        TTASSpinLock<Strategy> lock;
+        std::vector<T> items;
+
+        bool tryLock () {
+            return lock.try_lock ();
+        }
+
+        void blockingLock () {
+            lock.lock ();
+        }
+
+        void unlock () {
+            lock.unlock ();
+        }
+    };
+
+    // Random picks before enqueue/dequeue fall back to visiting every heap in turn.
+    static constexpr int RandomAttempts = 8;
+
+    public:
+    using value_type = T;
+
+    explicit MultiQueue (size_t threads = std::max (1u, std::thread::hardware_concurrency ()),
+                         size_t heapsPerThread = 2)
+        : d_heapCount (std::max<size_t> (2, threads * heapsPerThread)),
+          d_heaps (std::make_unique<Heap[]> (d_heapCount)) {
+        if (heapsPerThread == 0) {
+            throw std::invalid_argument ("MultiQueue needs at least one heap per thread");
+        }
+        const size_t share = (static_cast<size_t> (Capacity) + d_heapCount - 1) / d_heapCount;
+        for (size_t i = 0; i < d_heapCount; i++) {
+            d_heaps[i].items.reserve (2 * share);
+        }
+    }
+
+    MultiQueue (MultiQueue const&) = delete;
+
+    MultiQueue& operator= (MultiQueue const&) = delete;
+
+    template <class... Args>
+    bool enqueue (Args&&... args) {
+        if (d_size.fetch_add (1, std::memory_order_acq_rel) >= Capacity) {
+            d_size.fetch_sub (1, std::memory_order_relaxed);
+            d_stats.onFull ();
+            INPLACE_TRACE_INSTANT ("multiqueue.full");
+            return false;
+        }
+        try {
+            T value (std::forward<Args> (args)...);
+            // The reserve up front does not bound random placement, so the push may allocate.
+            Heap& heap = lockRandomHeap ();
+            std::lock_guard guard (heap.lock, std::adopt_lock);
+            heap.items.push_back (std::move (value));
+            std::push_heap (heap.items.begin (), heap.items.end (), d_compare);
+        } catch (...) {
+            d_size.fetch_sub (1, std::memory_order_relaxed);
+            throw;
+        }
+        d_stats.onEnqueue (1, [this] { return size (); });
+        INPLACE_TRACE_INSTANT ("multiqueue.enqueue");
+        return true;
+    }
+
+    // Moves out a high priority element and passes it to `callable`.
+    template <std::invocable<const T&> Callable>
+    bool dequeue (Callable&& callable) {
+        std::optional<T> value = tryDequeue ();
+        if (!value) {
+            return false;
+        }
+        std::invoke (std::forward<Callable> (callable), *value);
+        return true;
+    }
+
+    std::optional<T> tryDequeue () {
+        if (d_size.load (std::memory_order_acquire) <= 0) {
+            d_stats.onEmpty ();
+            INPLACE_TRACE_INSTANT ("multiqueue.empty");
+            return std::nullopt;
+        }
+        for (int attempt = 0; attempt < RandomAttempts; attempt++) {
+            const size_t index = fastRandom () % d_heapCount;
+            Heap* first = tryLockHeap (index);
+            if (first == nullptr) {
+                continue;
+            }
+            // Always a different heap than the first.
+            const size_t other = (index + 1 + fastRandom () % (d_heapCount - 1)) % d_heapCount;
+            Heap* second = tryLockHeap (other);
+            Heap* best = better (first, second);
+            if (second != nullptr && second != best) {
+                second->unlock ();
+            }
+            if (first != best) {
+                first->unlock ();
+            }
+            if (best != nullptr) {
+                return popLocked (*best);
+            }
+        }
+        // Random picks keep missing: the queue is nearly empty or heavily contended.
+        for (size_t i = 0; i < d_heapCount; i++) {
+            Heap& heap = d_heaps[i];
+            heap.blockingLock ();
+            if (!heap.items.empty ()) {
+                return popLocked (heap);
+            }
+            heap.unlock ();
+        }
+        d_stats.onEmpty ();
+        INPLACE_TRACE_INSTANT ("multiqueue.empty");
+        return std::nullopt;
+    }
+
+    size_t size (std::memory_order m = std::memory_order_acquire) const {
+        const int64_t size = d_size.load (m);
+        return size > 0 ? static_cast<size_t> (size) : 0;
+    }
+
+    bool empty (std::memory_order m = std::memory_order_acquire) const {
+        return size (m) == 0;
+    }
+
+    bool full (std::memory_order m = std::memory_order_acquire) const {
+        return size (m) >= static_cast<size_t> (Capacity);
+    }
+
+    static constexpr int64_t capacity () {
+        return Capacity;
+    }
+
+    size_t heapCount () const {
+        return d_heapCount;
+    }
+
+    QueueStatsSnapshot stats () const {
+        return d_stats.snapshot ();
+    }
+
+    private:
+    Heap* tryLockHeap (size_t index) {
+        Heap& heap = d_heaps[index];
+        if (heap.tryLock ()) {
+            return &heap;
+        }
+        d_stats.onCasRetry ();
+        return nullptr;
+    }
+
+    Heap& lockRandomHeap () {
+        for (int attempt = 0; attempt < RandomAttempts; attempt++) {
+            if (Heap* heap = tryLockHeap (fastRandom () % d_heapCount)) {
+                return *heap;
+            }
+        }
+        Heap& heap = d_heaps[fastRandom () % d_heapCount];
+        heap.blockingLock ();
+        return heap;
+    }
+
+    // The locked heap with the better top, or nullptr if both are empty.
+    Heap* better (Heap* first, Heap* second) const {
+        const bool firstEmpty = first == nullptr || first->items.empty ();
+        const bool secondEmpty = second == nullptr || second->items.empty ();
+        if (firstEmpty) {
+            return secondEmpty ? nullptr : second;
+        }
+        if (secondEmpty) {
+            return first;
+        }
+        return d_compare (first->items.front (), second->items.front ()) ? second : first;
+    }
+
+    T popLocked (Heap& heap) {
+        std::pop_heap (heap.items.begin (), heap.items.end (), d_compare);
+        T value (std::move (heap.items.back ()));
+        heap.items.pop_back ();
+        heap.unlock ();
+        d_size.fetch_sub (1, std::memory_order_acq_rel);
+        d_stats.onDequeue (1);
+        INPLACE_TRACE_INSTANT ("multiqueue.dequeue");
+        return value;
+    }
+
+    size_t d_heapCount;
+    std::unique_ptr<Heap[]> d_heaps;
+    [[no_unique_address]] Compare d_compare;
+    alignas (inplace::CACHE_LINE_SIZE) std::atomic<int64_t> d_size = 0;
+    [[no_unique_address]] Stats d_stats;
+};
+
+enum class PriorityQueueMode { Relaxed, Exact };
+
+// Relaxed: MultiQueue (scales, approximately ordered). Exact: SkipListPriorityQueue.
+template <class T, int64_t Capacity, PriorityQueueMode Mode = PriorityQueueMode::Relaxed,
+          class Compare = std::less<T>>
+using ConcurrentPriorityQueue =
+    std::conditional_t<Mode == PriorityQueueMode::Relaxed, MultiQueue<T, Capacity, Compare>,
+                       SkipListPriorityQueue<T, Capacity, Compare>>;
+}  // namespace inplace
+
+#endif  // MULTIQUEUE_HPP
@@ -0,0 +1,564 @@
+#ifndef OBJECTPOOL_HPP
+#define OBJECTPOOL_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <InplaceCommon.hpp>
+
+namespace inplace {
+
+// The magazines the calling thread holds, across every SlabPool; each goes back to its pool when
+// the thread exits. Pools are told apart by id rather than address, so a magazine of a destroyed
+// pool is never mistaken for a live one.
+class PoolMagazines {
+    public:
+    using Release = void (*) (void* pool, void* magazine);
+
+    static uint64_t enroll (void* pool, Release release) {
+        std::lock_guard lock (registryMutex ());
+        static uint64_t ids = 0;
+        registry ().emplace (++ids, Pool{ pool, release });
+        return ids;
+    }
+
+    static void withdraw (uint64_t id) {
+        std::lock_guard lock (registryMutex ());
+        registry ().erase (id);
+    }
+
+    // True once the calling thread has handed its magazines back, while it exits; objects freed
+    // after that (by later thread_local or static destructors) go straight to the shared stack.
+    static bool retired () {
+        return threadRetired ();
+    }
+
+    // The calling thread's magazine of pool `id`, nullptr if it has none yet.
+    static void* find (uint64_t id) {
+        Held& held = threadHeld ();
+        if (held.lastId == id) {
+            return held.last;
+        }
+        for (auto [heldId, magazine] : held.entries) {
+            if (heldId == id) {
+                held.lastId = id;
+                held.last = magazine;
+                return magazine;
+            }
+        }
+        return nullptr;
+    }
+
+    static void add (uint64_t id, void* magazine) {
+        Held& held = threadHeld ();
+        held.entries.emplace_back (id, magazine);
+        held.lastId = id;
+        held.last = magazine;
+    }
+
+    private:
+    struct Pool {
+        void* pool;
+        Release release;
+    };
+
+    struct Held {
+        ~Held () {
+            threadRetired () = true;
+            std::lock_guard lock (registryMutex ());
+            for (auto [id, magazine] : entries) {
+                auto it = registry ().find (id);
+                if (it != registry ().end ()) {
+                    it->second.release (it->second.pool, magazine);
+                }
+            }
+        }
+
+        uint64_t lastId = 0;
+        void* last = nullptr;
+        std::vector<std::pair<uint64_t, void*>> entries;
+    };
+
+    static std::mutex& registryMutex () {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::unordered_map<uint64_t, Pool>& registry () {
+        static std::unordered_map<uint64_t, Pool> pools;
+        return pools;
+    }
+
+    static Held& threadHeld () {
+        thread_local Held held;
+        return held;
+    }
+
+    // Trivially destructible, so it can still be read once `held` is gone.
+    static bool& threadRetired () {
+        thread_local bool retired = false;
+        return retired;
+    }
+};
+
+// Allocator of fixed-size slots carved out of slabs of SlotsPerSlab slots. The first slab is
+// allocated up front; when the slots run out the pool grows by whole slabs, up to MaxSlabs
+// (MaxSlabs = 1 is a fixed-size pool), and allocate () returns nullptr beyond that. Memory goes
+// back to the system only when the pool is destroyed.
+//
+// Free slots sit on a Treiber stack of slot indices; its head carries a tag bumped on every
+// change, so a pop that read a stale link fails its CAS instead of corrupting the stack (ABA). In
+// front of it, every thread using the pool owns a magazine of up to 2 * MagazineSize free slots
+// (MagazineSize = 0 disables them), used with plain loads and stores. Batches of MagazineSize
+// slots move between magazines through a depot, a second tagged stack whose entries are whole
+// chains of slots, with one CAS each: a full magazine hands its upper half to the depot, an empty
+// one takes a batch from it. A thread that only allocates (the producer side of a queue) and one
+// that only frees (the consumer) thus trade batches rather than single slots, and a thread that
+// does both keeps a batch of slack either way. A thread that exits hands its slots back, so each
+// live thread parks at most 2 * MagazineSize slots the others cannot get. No path blocks except
+// slab growth.
+template <size_t SlotSize, size_t SlotAlign = alignof (std::max_align_t),
+          size_t SlotsPerSlab = 1024, size_t MaxSlabs = 1, size_t MagazineSize = 16>
+class SlabPool {
+    static constexpr uint32_t Null = std::numeric_limits<uint32_t>::max ();
+
+    static_assert (std::has_single_bit (SlotAlign) && std::has_single_bit (SlotsPerSlab));
+    static_assert (MaxSlabs > 0 && MaxSlabs * SlotsPerSlab < Null);
+
+    static constexpr size_t Stride =
+        (std::max<size_t> (SlotSize, 1) + SlotAlign - 1) / SlotAlign * SlotAlign;
+    static constexpr unsigned SlabShift = std::countr_zero (SlotsPerSlab);
+
+    struct Slab {
+        Slab ()
+            : bytes (static_cast<std::byte*> (
+                  ::operator new (Stride * SlotsPerSlab, std::align_val_t (SlotAlign)))),
+              next (std::make_unique<std::atomic<uint32_t>[]> (SlotsPerSlab)) {
+        }
+
+        ~Slab () {
+            ::operator delete (bytes, std::align_val_t (SlotAlign));
+        }
+
+        std::byte* bytes;
+        // Free-stack and depot links, kept apart from the slots: a popper may read the link of a
+        // slot that another thread has just taken and is writing to. `next` also chains the slots
+        // of a depot entry, `batch` links the entries through their first slot.
+        std::unique_ptr<std::atomic<uint32_t>[]> next;
+        std::unique_ptr<std::atomic<uint32_t>[]> batch =
+            std::make_unique<std::atomic<uint32_t>[]> (SlotsPerSlab);
+    };
+
+    struct SlabRange {
+        uintptr_t begin;
+        uint32_t slab;
+    };
+
+    // Owned by one thread at a time; recycled by the next thread once its owner exits.
+    struct alignas (CACHE_LINE_SIZE) Magazine {
+        std::atomic<bool> owned = true;
+        // Set before the magazine is published, never changed after.
+        Magazine* next = nullptr;
+        // Owner thread only.
+        uint32_t count = 0;
+        std::array<uint32_t, 2 * MagazineSize> slots;
+    };
+
+    public:
+    SlabPool () {
+        {
+            std::lock_guard lock (d_growMutex);
+            addSlab ();
+        }
+        if constexpr (MagazineSize > 0) {
+            d_id = PoolMagazines::enroll (this, &releaseMagazine);
+        }
+    }
+
+    ~SlabPool () {
+        if constexpr (MagazineSize > 0) {
+            PoolMagazines::withdraw (d_id);
+        }
+        Magazine* magazine = d_magazines.load (std::memory_order_acquire);
+        while (magazine != nullptr) {
+            delete std::exchange (magazine, magazine->next);
+        }
+        for (auto& slab : d_slabs) {
+            delete slab.load (std::memory_order_relaxed);
+        }
+        for (auto& ranges : d_ranges) {
+            delete[] ranges.load (std::memory_order_relaxed);
+        }
+    }
+
+    SlabPool (SlabPool const&) = delete;
+
+    SlabPool& operator= (SlabPool const&) = delete;
+
+    // A slot of at least SlotSize bytes aligned to SlotAlign, or nullptr if the pool is exhausted.
+    void* allocate () {
+        if constexpr (MagazineSize > 0) {
+            Magazine* magazine = threadMagazine ();
+            if (magazine != nullptr && (magazine->count > 0 || refill (*magazine))) {
+                return address (magazine->slots[--magazine->count]);
+            }
+        }
+        while (true) {
+            const uint32_t index = pop ();
+            if (index != Null) {
+                return address (index);
+            }
+            if constexpr (MagazineSize > 0) {
+                // Full magazines may still sit in the depot when this thread has no magazine or
+                // lost the race for them; take one apart.
+                std::array<uint32_t, MagazineSize> batch;
+                if (popBatch (batch.data ())) {
+                    pushAll (batch.data () + 1, MagazineSize - 1);
+                    return address (batch[0]);
+                }
+            }
+            if (!grow ()) {
+                return nullptr;
+            }
+        }
+    }
+
+    // `ptr` must come from allocate () on this pool.
+    void deallocate (void* ptr) {
+        const uint32_t index = indexOf (ptr);
+        if constexpr (MagazineSize > 0) {
+            if (Magazine* magazine = threadMagazine ()) {
+                if (magazine->count == 2 * MagazineSize) {
+                    pushBatch (magazine->slots.data () + MagazineSize);
+                    magazine->count = MagazineSize;
+                }
+                magazine->slots[magazine->count++] = index;
+                return;
+            }
+        }
+        pushAll (&index, 1);
+    }
+
+    bool owns (const void* ptr) const {
+        return rangeOf (ptr) != nullptr;
+    }
+
+    // Slots in the slabs allocated so far.
+    size_t capacity () const {
+        return slabCount () * SlotsPerSlab;
+    }
+
+    size_t slabCount () const {
+        return d_slabCount.load (std::memory_order_acquire);
+    }
+
+    static constexpr size_t slotSize () {
+        return Stride;
+    }
+
+    private:
+    // nullptr once the calling thread is past handing its magazines back.
+    Magazine* threadMagazine () {
+        if (PoolMagazines::retired ()) {
+            return nullptr;
+        }
+        if (void* magazine = PoolMagazines::find (d_id)) {
+            return static_cast<Magazine*> (magazine);
+        }
+        Magazine* magazine = claimMagazine ();
+        PoolMagazines::add (d_id, magazine);
+        return magazine;
+    }
+
+    // A magazine given back by an exited thread, or a new one.
+    Magazine* claimMagazine () {
+        Magazine* head = d_magazines.load (std::memory_order_acquire);
+        for (Magazine* magazine = head; magazine != nullptr; magazine = magazine->next) {
+            if (!magazine->owned.load (std::memory_order_relaxed) &&
+                !magazine->owned.exchange (true, std::memory_order_acquire)) {
+                return magazine;
+            }
+        }
+        auto* magazine = new Magazine ();
+        magazine->next = head;
+        while (!d_magazines.compare_exchange_weak (magazine->next, magazine,
+                                                   std::memory_order_release,
+                                                   std::memory_order_acquire)) {
+        }
+        return magazine;
+    }
+
+    // Called for every magazine the exiting thread holds while its pool still exists.
+    static void releaseMagazine (void* pool, void* released) {
+        auto& self = *static_cast<SlabPool*> (pool);
+        auto& magazine = *static_cast<Magazine*> (released);
+        if (magazine.count > 0) {
+            self.pushAll (magazine.slots.data (), magazine.count);
+            magazine.count = 0;
+        }
+        magazine.owned.store (false, std::memory_order_release);
+    }
+
+    Slab& slabOf (uint32_t index) const {
+        return *d_slabs[index >> SlabShift].load (std::memory_order_acquire);
+    }
+
+    std::atomic<uint32_t>& nextOf (uint32_t index) const {
+        return slabOf (index).next[index & (SlotsPerSlab - 1)];
+    }
+
+    void* address (uint32_t index) const {
+        return slabOf (index).bytes + (index & (SlotsPerSlab - 1)) * Stride;
+    }
+
+    // Binary search of the slabs by address; nullptr if `ptr` is in none of them.
+    const SlabRange* rangeOf (const void* ptr) const {
+        const auto where = reinterpret_cast<uintptr_t> (ptr);
+        const size_t slabs = slabCount ();
+        const SlabRange* ranges = d_ranges[slabs - 1].load (std::memory_order_acquire);
+        const SlabRange* after = std::upper_bound (
+            ranges, ranges + slabs, where,
+            [] (uintptr_t value, const SlabRange& range) { return value < range.begin; });
+        if (after == ranges || where - after[-1].begin >= Stride * SlotsPerSlab) {
+            return nullptr;
+        }
+        return after - 1;
+    }
+
+    uint32_t indexOf (const void* ptr) const {
+        const SlabRange* range = rangeOf (ptr);
+        if (range == nullptr) {
+            throw std::invalid_argument ("SlabPool: pointer does not belong to this pool");
+        }
+        const size_t offset = reinterpret_cast<uintptr_t> (ptr) - range->begin;
+        return static_cast<uint32_t> ((size_t{ range->slab } << SlabShift) + offset / Stride);
+    }
+
+    static uint64_t tagged (uint64_t head, uint32_t index) {
+        return (((head >> 32) + 1) << 32) | index;
+    }
+
+    uint32_t pop () {
+        uint64_t head = d_free.load (std::memory_order_acquire);
+        while (true) {
+            const auto index = static_cast<uint32_t> (head);
+            if (index == Null) {
+                return Null;
+            }
+            const uint32_t next = nextOf (index).load (std::memory_order_relaxed);
+            if (d_free.compare_exchange_weak (head, tagged (head, next), std::memory_order_acquire,
+                                              std::memory_order_acquire)) {
+                return index;
+            }
+        }
+    }
+
+    // Links `count` indices into a chain and pushes it with one CAS.
+    void pushAll (const uint32_t* indices, size_t count) {
+        if (count == 0) {
+            return;
+        }
+        for (size_t i = 0; i + 1 < count; i++) {
+            nextOf (indices[i]).store (indices[i + 1], std::memory_order_relaxed);
+        }
+        std::atomic<uint32_t>& last = nextOf (indices[count - 1]);
+        uint64_t head = d_free.load (std::memory_order_relaxed);
+        do {
+            last.store (static_cast<uint32_t> (head), std::memory_order_relaxed);
+        } while (!d_free.compare_exchange_weak (head, tagged (head, indices[0]),
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+    }
+
+    // Chains MagazineSize slots through `next` and pushes them on the depot with one CAS.
+    void pushBatch (const uint32_t* indices) {
+        for (size_t i = 0; i + 1 < MagazineSize; i++) {
+            nextOf (indices[i]).store (indices[i + 1], std::memory_order_relaxed);
+        }
+        std::atomic<uint32_t>& link = batchOf (indices[0]);
+        uint64_t head = d_depot.load (std::memory_order_relaxed);
+        do {
+            link.store (static_cast<uint32_t> (head), std::memory_order_relaxed);
+        } while (!d_depot.compare_exchange_weak (head, tagged (head, indices[0]),
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed));
+    }
+
+    // Takes a batch of MagazineSize slots off the depot into `indices`; false if it is empty.
+    bool popBatch (uint32_t* indices) {
+        uint64_t head = d_depot.load (std::memory_order_acquire);
+        while (true) {
+            const auto first = static_cast<uint32_t> (head);
+            if (first == Null) {
+                return false;
+            }
+            const uint32_t next = batchOf (first).load (std::memory_order_relaxed);
+            if (d_depot.compare_exchange_weak (head, tagged (head, next), std::memory_order_acquire,
+                                               std::memory_order_acquire)) {
+                break;
+            }
+        }
+        // The chain is ours now.
+        uint32_t index = static_cast<uint32_t> (head);
+        for (size_t i = 0; i < MagazineSize; i++) {
+            indices[i] = index;
+            index = nextOf (index).load (std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    bool refill (Magazine& magazine) {
+        if (!popBatch (magazine.slots.data ())) {
+            return false;
+        }
+        magazine.count = MagazineSize;
+        return true;
+    }
+
+    std::atomic<uint32_t>& batchOf (uint32_t index) const {
+        return slabOf (index).batch[index & (SlotsPerSlab - 1)];
+    }
+
+    // Under d_growMutex.
+    void addSlab () {
+        const size_t slab = d_slabCount.load (std::memory_order_relaxed);
+        Slab* fresh = new Slab ();
+        const auto first = static_cast<uint32_t> (slab << SlabShift);
+        for (uint32_t i = 0; i + 1 < SlotsPerSlab; i++) {
+            fresh->next[i].store (first + i + 1, std::memory_order_relaxed);
+        }
+        // The slab ranges sorted by address, one array per slab count: readers may still be
+        // searching the previous one.
+        auto* ranges = new SlabRange[slab + 1];
+        if (slab > 0) {
+            const SlabRange* previous = d_ranges[slab - 1].load (std::memory_order_relaxed);
+            std::copy (previous, previous + slab, ranges);
+        }
+        ranges[slab] = { reinterpret_cast<uintptr_t> (fresh->bytes), static_cast<uint32_t> (slab) };
+        std::inplace_merge (
+            ranges, ranges + slab, ranges + slab + 1,
+            [] (const SlabRange& a, const SlabRange& b) { return a.begin < b.begin; });
+        // Published before any of its slots can be popped.
+        d_slabs[slab].store (fresh, std::memory_order_release);
+        d_ranges[slab].store (ranges, std::memory_order_release);
+        d_slabCount.store (slab + 1, std::memory_order_release);
+        std::atomic<uint32_t>& last = fresh->next[SlotsPerSlab - 1];
+        uint64_t head = d_free.load (std::memory_order_relaxed);
+        do {
+            last.store (static_cast<uint32_t> (head), std::memory_order_relaxed);
+        } while (!d_free.compare_exchange_weak (head, tagged (head, first),
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+    }
+
+    // False once MaxSlabs are in use. Another thread may have grown the pool or freed slots while
+    // this one waited for the mutex; then there is nothing to do.
+    bool grow () {
+        std::lock_guard lock (d_growMutex);
+        if (static_cast<uint32_t> (d_free.load (std::memory_order_acquire)) != Null ||
+            static_cast<uint32_t> (d_depot.load (std::memory_order_acquire)) != Null) {
+            return true;
+        }
+        if (d_slabCount.load (std::memory_order_relaxed) == MaxSlabs) {
+            return false;
+        }
+        addSlab ();
+        return true;
+    }
+
+    alignas (CACHE_LINE_SIZE) std::atomic<uint64_t> d_free = Null;
+    alignas (CACHE_LINE_SIZE) std::atomic<uint64_t> d_depot = Null;
+    alignas (CACHE_LINE_SIZE) std::array<std::atomic<Slab*>, MaxSlabs> d_slabs{};
+    std::array<std::atomic<SlabRange*>, MaxSlabs> d_ranges{};
+    std::atomic<size_t> d_slabCount = 0;
+    std::mutex d_growMutex;
+    uint64_t d_id = 0;
+    std::atomic<Magazine*> d_magazines = nullptr;
+};
+
+// Typed pool of T on top of SlabPool: acquire () constructs an object in a free slot and returns
+// a unique_ptr that destroys it and gives the slot back; an empty one if the pool is exhausted.
+// The pool must outlive its handles. create ()/destroy () are the raw-pointer equivalents, for
+// code that keeps the pointer itself.
+template <class T, size_t SlotsPerSlab = 1024, size_t MaxSlabs = 1, size_t MagazineSize = 16>
+class ObjectPool {
+    using Slots = SlabPool<sizeof (T), alignof (T), SlotsPerSlab, MaxSlabs, MagazineSize>;
+
+    public:
+    struct Releaser {
+        void operator() (T* object) const {
+            pool->destroy (object);
+        }
+
+        ObjectPool* pool;
+    };
+
+    using Handle = std::unique_ptr<T, Releaser>;
+
+    ObjectPool () = default;
+
+    ObjectPool (ObjectPool const&) = delete;
+
+    ObjectPool& operator= (ObjectPool const&) = delete;
+
+    // Process-wide pool for T, never destroyed, so objects may be released during static
+    // destruction.
+    static ObjectPool& shared () {
+        static ObjectPool* pool = new ObjectPool ();
+        return *pool;
+    }
+
+    template <class... Args>
+    Handle acquire (Args&&... args) {
+        return Handle (create (std::forward<Args> (args)...), Releaser{ this });
+    }
+
+    // nullptr if the pool is exhausted.
+    template <class... Args>
+    T* create (Args&&... args) {
+        void* slot = d_slots.allocate ();
+        if (slot == nullptr) {
+            return nullptr;
+        }
+        try {
+            return ::new (slot) T (std::forward<Args> (args)...);
+        } catch (...) {
+            d_slots.deallocate (slot);
+            throw;
+        }
+    }
+
+    void destroy (T* object) {
+        std::destroy_at (object);
+        d_slots.deallocate (object);
+    }
+
+    bool owns (const T* object) const {
+        return d_slots.owns (object);
+    }
+
+    size_t capacity () const {
+        return d_slots.capacity ();
+    }
+
+    size_t slabCount () const {
+        return d_slots.slabCount ();
+    }
+
+    private:
+    Slots d_slots;
+};
+}  // namespace inplace
+
+#endif  // OBJECTPOOL_HPP
@@ -0,0 +1,221 @@
+#ifndef PARKING_HPP
+#define PARKING_HPP
+
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <InplaceCommon.hpp>
+#include <QueueStats.hpp>
+#include <SpinLock.hpp>
+#include <Tracing.hpp>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+namespace inplace {
+
+// Constructor tag for objects that are placed in memory shared between processes.
+struct ProcessSharedTag {
+    explicit ProcessSharedTag () = default;
+};
+
+inline constexpr ProcessSharedTag processShared{};
+
+// A place for threads to sleep until some condition (e.g. "queue not empty") may have changed.
+// Waiters announce themselves before re-checking the condition, so the notifying side only pays a
+// fence and a load when nobody is parked and only issues a wake-up syscall when somebody is.
+//
+// On Linux the epoch word is parked on directly with futex(2), which also gives us timed waits;
+// elsewhere untimed waits use std::atomic::wait/notify and timed waits fall back to short sleeps.
+// A Parker constructed with `processShared` uses shared futexes so that it works when placed in
+// memory mapped by several processes.
+class alignas (inplace::CACHE_LINE_SIZE) Parker {
+    public:
+    using Clock = std::chrono::steady_clock;
+
+    Parker () = default;
+
+    explicit Parker (ProcessSharedTag) : d_processShared (true) {
+    }
+
+    Parker (Parker const&) = delete;
+
+    Parker& operator= (Parker const&) = delete;
+
+    // Registers the calling thread as a waiter and returns the epoch to park on. The caller must
+    // re-check its condition after this call and either park () or cancel () exactly once.
+    [[nodiscard]] uint32_t prepare () {
+        d_waiters.fetch_add (1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        return d_epoch.load (std::memory_order_acquire);
+    }
+
+    void cancel () {
+        d_waiters.fetch_sub (1, std::memory_order_relaxed);
+    }
+
+    // Sleeps until notified, until `deadline`, or spuriously. Always deregisters the waiter.
+    void park (uint32_t epoch, Clock::time_point deadline) {
+#if defined(__linux__)
+        const auto now = Clock::now ();
+        if (now < deadline) {
+            timespec* timeout = nullptr;
+            timespec relative{};
+            if (deadline != Clock::time_point::max ()) {
+                const auto left = std::chrono::duration_cast<std::chrono::nanoseconds> (
+                    deadline - now);
+                relative.tv_sec = static_cast<time_t> (left.count () / 1000000000);
+                relative.tv_nsec = static_cast<long> (left.count () % 1000000000);
+                timeout = &relative;
+            }
+            syscall (SYS_futex, epochWord (), d_processShared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE,
+                     epoch, timeout, nullptr, 0);
+        }
+#else
+        if (deadline == Clock::time_point::max ()) {
+            d_epoch.wait (epoch, std::memory_order_acquire);
+        } else if (Clock::now () < deadline) {
+            std::this_thread::sleep_for (std::chrono::microseconds (50));
+        }
+#endif
+        cancel ();
+    }
+
+    // Wakes up to `count` parked threads. Cheap when no thread is parked.
+    void notify (uint32_t count = 1) {
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        if (d_waiters.load (std::memory_order_relaxed) == 0) {
+            return;
+        }
+        d_epoch.fetch_add (1, std::memory_order_release);
+#if defined(__linux__)
+        const int wake = count > static_cast<uint32_t> (std::numeric_limits<int>::max ())
+                             ? std::numeric_limits<int>::max ()
+                             : static_cast<int> (count);
+        syscall (SYS_futex, epochWord (), d_processShared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE, wake,
+                 nullptr, nullptr, 0);
+#else
+        if (count == 1) {
+            d_epoch.notify_one ();
+        } else {
+            d_epoch.notify_all ();
+        }
+#endif
+    }
+
+    void notifyAll () {
+        notify (std::numeric_limits<uint32_t>::max ());
+    }
+
+    [[nodiscard]] uint32_t waiters () const {
+        return d_waiters.load (std::memory_order_relaxed);
+    }
+
+    // Converts a relative timeout into a deadline, saturating instead of overflowing.
+    template <class Rep, class Period>
+    static Clock::time_point deadlineAfter (std::chrono::duration<Rep, Period> timeout) {
+        const auto now = Clock::now ();
+        if (timeout <= std::chrono::duration<Rep, Period>::zero ()) {
+            return now;
+        }
+        if (std::chrono::duration<double> (timeout) >=
+            std::chrono::duration<double> (Clock::time_point::max () - now)) {
+            return Clock::time_point::max ();
+        }
+        return now + std::chrono::ceil<Clock::duration> (timeout);
+    }
+
+    private:
+#if defined(__linux__)
+    uint32_t* epochWord () {
+        static_assert (sizeof (std::atomic<uint32_t>) == sizeof (uint32_t));
+        static_assert (std::atomic<uint32_t>::is_always_lock_free);
+        return reinterpret_cast<uint32_t*> (&d_epoch);
+    }
+#endif
+
+    std::atomic<uint32_t> d_epoch = 0;
+    std::atomic<uint32_t> d_waiters = 0;
+    bool d_processShared = false;
+};
+
+// Whether a queue offers the blocking enqueueWait/dequeueWait. A Blocking queue checks for parked
+// threads, behind a full fence, every time it publishes progress; a NonBlocking one (the default)
+// keeps that off the enqueue/dequeue path entirely.
+struct NonBlocking {};
+
+struct Blocking {};
+
+template <class P>
+concept QueueBlockingPolicy = std::same_as<P, NonBlocking> || std::same_as<P, Blocking>;
+
+// The Parker a queue notifies on progress: a real one for Blocking queues, an empty stand-in whose
+// notify () is a no-op for NonBlocking ones.
+template <QueueBlockingPolicy Policy>
+class QueueParker : public Parker {
+    public:
+    using Parker::Parker;
+};
+
+template <>
+class QueueParker<NonBlocking> {
+    public:
+    QueueParker () = default;
+
+    explicit QueueParker (ProcessSharedTag) {
+    }
+
+    void notify (uint32_t = 1) {
+    }
+
+    void notifyAll () {
+    }
+};
+
+// Runs `attempt` until it succeeds or `deadline` passes: first while `Strategy::wait ()` keeps
+// returning true (the spin phase), then by parking on `parker` between attempts. Every failed
+// spin-phase attempt and every park is reported to `stats`.
+template <SpinLockWaitStrategy Strategy, class Attempt, QueueStatsPolicy Stats>
+bool parkUntil (Parker& parker, Parker::Clock::time_point deadline, Attempt&& attempt,
+                Stats& stats) {
+    Strategy strategy;
+    do {
+        if (attempt ()) {
+            return true;
+        }
+        stats.onSpin ();
+    } while (strategy.wait ());
+
+    while (true) {
+        const uint32_t epoch = parker.prepare ();
+        if (attempt ()) {
+            parker.cancel ();
+            return true;
+        }
+        if (Parker::Clock::now () >= deadline) {
+            parker.cancel ();
+            return false;
+        }
+        stats.onPark ();
+        INPLACE_TRACE_BEGIN ("park", parker.waiters ());
+        parker.park (epoch, deadline);
+        INPLACE_TRACE_END ("park");
+    }
+}
+
+template <SpinLockWaitStrategy Strategy, class Attempt>
+bool parkUntil (Parker& parker, Parker::Clock::time_point deadline, Attempt&& attempt) {
+    NoQueueStats stats;
+    return parkUntil<Strategy> (parker, deadline, std::forward<Attempt> (attempt), stats);
+}
+}  // namespace inplace
+
+#endif  // PARKING_HPP
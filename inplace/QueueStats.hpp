@@ -0,0 +1,197 @@
+#ifndef QUEUESTATS_HPP
+#define QUEUESTATS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <InplaceCommon.hpp>
+
+namespace inplace {
+
+// Occupancy is bucketed by bit width: bucket 0 counts an empty queue, bucket b counts
+// occupancies in [2^(b-1), 2^b). The last bucket also absorbs anything larger.
+constexpr const size_t OCCUPANCY_BUCKETS = 32;
+
+struct QueueStatsSnapshot {
+    uint64_t enqueued = 0;
+    uint64_t dequeued = 0;
+    uint64_t fullRejections = 0;
+    uint64_t emptyRejections = 0;
+    uint64_t casRetries = 0;
+    uint64_t spins = 0;
+    uint64_t parks = 0;
+    uint64_t highWaterMark = 0;
+    // Occupancy observed right after each successful enqueue (or enqueue batch).
+    std::array<uint64_t, OCCUPANCY_BUCKETS> occupancy{};
+
+    static constexpr size_t bucketOf (uint64_t occupancy) {
+        return std::min (static_cast<size_t> (std::bit_width (occupancy)), OCCUPANCY_BUCKETS - 1);
+    }
+};
+
+inline std::ostream& operator<< (std::ostream& os, const QueueStatsSnapshot& stats) {
+    os << "enqueued=" << stats.enqueued << " dequeued=" << stats.dequeued
+       << " full=" << stats.fullRejections << " empty=" << stats.emptyRejections
+       << " casRetries=" << stats.casRetries << " spins=" << stats.spins
+       << " parks=" << stats.parks << " highWaterMark=" << stats.highWaterMark << " occupancy=[";
+    for (size_t i = 0; i < OCCUPANCY_BUCKETS; i++) {
+        if (stats.occupancy[i] != 0) {
+            os << " <" << (uint64_t{ 1 } << i) << ":" << stats.occupancy[i];
+        }
+    }
+    os << " ]";
+    return os;
+}
+
+// Compile-time statistics policy of the inplace queues. `occupancy` is a callable returning the
+// queue size after an enqueue, so a disabled policy never pays for computing it.
+template <class S>
+concept QueueStatsPolicy = requires (S s, const S cs, size_t n) {
+    { S::enabled } -> std::convertible_to<bool>;
+    s.onEnqueue (n, [] { return size_t{ 0 }; });
+    s.onDequeue (n);
+    s.onFull ();
+    s.onEmpty ();
+    s.onCasRetry ();
+    s.onSpin ();
+    s.onPark ();
+    { cs.snapshot () } -> std::same_as<QueueStatsSnapshot>;
+};
+
+// Default policy: every hook is an empty inline function and the member takes no space.
+struct NoQueueStats {
+    static constexpr bool enabled = false;
+
+    template <class Occupancy>
+    void onEnqueue (size_t, Occupancy&&) {
+    }
+
+    void onDequeue (size_t) {
+    }
+
+    void onFull () {
+    }
+
+    void onEmpty () {
+    }
+
+    void onCasRetry () {
+    }
+
+    void onSpin () {
+    }
+
+    void onPark () {
+    }
+
+    QueueStatsSnapshot snapshot () const {
+        return {};
+    }
+};
+
+// Small dense id per thread, handed out on first use.
+inline size_t statsThreadId () {
+    static std::atomic<size_t> next = 0;
+    static thread_local const size_t id = next.fetch_add (1, std::memory_order_relaxed);
+    return id;
+}
+
+// Counts into one cache-line aligned block per thread, so recording never writes a line that
+// another thread writes. Threads beyond `MaxThreads` share blocks, which stays correct because
+// every update is atomic. snapshot () sums (and maxes) over all blocks and is only a
+// point-in-time view while the queue is in use.
+template <size_t MaxThreads = 64>
+class QueueStats {
+    public:
+    static constexpr bool enabled = true;
+
+    template <class Occupancy>
+    void onEnqueue (size_t count, Occupancy&& occupancy) {
+        auto& counters = local ();
+        bump (counters.enqueued, count);
+        const uint64_t observed = occupancy ();
+        bump (counters.occupancy[QueueStatsSnapshot::bucketOf (observed)], 1);
+        uint64_t highWaterMark = counters.highWaterMark.load (std::memory_order_relaxed);
+        while (observed > highWaterMark &&
+               !counters.highWaterMark.compare_exchange_weak (highWaterMark, observed,
+                                                              std::memory_order_relaxed)) {
+        }
+    }
+
+    void onDequeue (size_t count) {
+        bump (local ().dequeued, count);
+    }
+
+    void onFull () {
+        bump (local ().fullRejections, 1);
+    }
+
+    void onEmpty () {
+        bump (local ().emptyRejections, 1);
+    }
+
+    void onCasRetry () {
+        bump (local ().casRetries, 1);
+    }
+
+    void onSpin () {
+        bump (local ().spins, 1);
+    }
+
+    void onPark () {
+        bump (local ().parks, 1);
+    }
+
+    QueueStatsSnapshot snapshot () const {
+        QueueStatsSnapshot result;
+        for (const auto& counters : d_counters) {
+            result.enqueued += counters.enqueued.load (std::memory_order_relaxed);
+            result.dequeued += counters.dequeued.load (std::memory_order_relaxed);
+            result.fullRejections += counters.fullRejections.load (std::memory_order_relaxed);
+            result.emptyRejections += counters.emptyRejections.load (std::memory_order_relaxed);
+            result.casRetries += counters.casRetries.load (std::memory_order_relaxed);
+            result.spins += counters.spins.load (std::memory_order_relaxed);
+            result.parks += counters.parks.load (std::memory_order_relaxed);
+            result.highWaterMark = std::max<uint64_t> (
+                result.highWaterMark, counters.highWaterMark.load (std::memory_order_relaxed));
+            for (size_t i = 0; i < OCCUPANCY_BUCKETS; i++) {
+                result.occupancy[i] += counters.occupancy[i].load (std::memory_order_relaxed);
+            }
+        }
+        return result;
+    }
+
+    private:
+    struct alignas (inplace::CACHE_LINE_SIZE) Counters {
+        std::atomic<uint64_t> enqueued = 0;
+        std::atomic<uint64_t> dequeued = 0;
+        std::atomic<uint64_t> fullRejections = 0;
+        std::atomic<uint64_t> emptyRejections = 0;
+        std::atomic<uint64_t> casRetries = 0;
+        std::atomic<uint64_t> spins = 0;
+        std::atomic<uint64_t> parks = 0;
+        std::atomic<uint64_t> highWaterMark = 0;
+        std::array<std::atomic<uint64_t>, OCCUPANCY_BUCKETS> occupancy{};
+    };
+
+    static void bump (std::atomic<uint64_t>& counter, uint64_t count) {
+        counter.fetch_add (count, std::memory_order_relaxed);
+    }
+
+    Counters& local () {
+        return d_counters[statsThreadId () % MaxThreads];
+    }
+
+    std::array<Counters, MaxThreads> d_counters;
+};
+
+static_assert (QueueStatsPolicy<NoQueueStats>);
+static_assert (QueueStatsPolicy<QueueStats<>>);
+}  // namespace inplace
+
+#endif  // QUEUESTATS_HPP
@@ -13,12 +13,22 @@
 #include <stdalign.h>
 #include <type_traits>
 #include <SpinLock.hpp>
+#include <Parking.hpp>
+#include <SlotArray.hpp>
+#include <SlotHandle.hpp>
+#include <QueueStats.hpp>
+#include <Tracing.hpp>
+#include <chrono>
 #include <ranges>
+#include <span>
+#include <algorithm>
+#include <functional>
+#include <optional>
 
 namespace inplace
 {
 template <class T>
-concept LockFreeType = std::is_default_constructible_v<T> && !std::is_const_v<T>;
+concept LockFreeType = std::is_nothrow_move_constructible_v<T> && !std::is_const_v<T>;
 template <class F, class... Args>
 concept ReaderCallable = requires (F f, Args... args) {
     { f (args...) } -> std::same_as<void>;
@@ -32,6 +42,8 @@ template <Integral T>
 struct alignas (inplace::CACHE_LINE_SIZE) RWTraits {
     std::atomic<T> index = 0;
     int identity = 0;
+    // Owner-private copy of the other side's cursor (SPSCMode::CachedCursor only).
+    T peer = 0;
 };
 
 template <LockFreeType T>
@@ -42,7 +54,7 @@ class LockFreeNode {
 
    public:
     template <class... Args>
-    std::add_pointer_t<Type> create (Args... args) {
+    std::add_pointer_t<Type> create (Args&&... args) {
         return ::new (&d_data) T (std::forward<Args> (args)...);
     }
 
@@ -51,14 +63,48 @@ class LockFreeNode {
     }
 
     void destroy () { std::launder<T> (reinterpret_cast<T*> (&d_data))->~T (); }
+
+    void* storage () { return &d_data; }
 };
 
-template <LockFreeType T, int64_t Capacity>
+// How the producer and the consumer learn about each other's progress.
+//   SharedCounter: both sides update a shared size counter on every operation.
+//   CachedCursor:  each side only publishes its own cursor and keeps a private copy of the peer's
+//                  cursor, re-reading the peer only when the queue looks full (producer) or empty
+//                  (consumer). No cache line is written by both sides.
+enum class SPSCMode { SharedCounter, CachedCursor };
+
+// Pass DYNAMIC_CAPACITY as Capacity to choose the capacity at construction time; the slots then
+// live in their own mapping (see SlotArray/MappedRegion) instead of inside the queue object.
+// `Stats` selects what is counted (see QueueStats.hpp); the default records nothing.
+// `BlockingPolicy` enables enqueueWait/dequeueWait (see Parking.hpp); without it nothing on the
+// enqueue/dequeue path looks for parked threads.
+template <LockFreeType T, int64_t Capacity, SPSCMode Mode = SPSCMode::SharedCounter,
+          QueueStatsPolicy Stats = NoQueueStats, QueueBlockingPolicy BlockingPolicy = NonBlocking>
 class SPSCQueue : public LFNodeTraits {
    public:
-    SPSCQueue () = default;
+    using value_type = T;
+
+    SPSCQueue ()
+        requires (Capacity != DYNAMIC_CAPACITY)
+    = default;
+
+    explicit SPSCQueue (int64_t capacity, MappingOptions options = {})
+        requires (Capacity == DYNAMIC_CAPACITY)
+        : d_queue (capacity, options) {}
 
-    ~SPSCQueue () = default;
+    // For placement in memory shared between processes (see SharedMemoryQueue).
+    explicit SPSCQueue (ProcessSharedTag tag)
+        requires (Capacity != DYNAMIC_CAPACITY)
+        : d_notEmpty (tag), d_notFull (tag) {}
+
+    ~SPSCQueue () {
+        int64_t reader = d_reader.index.load (std::memory_order_relaxed);
+        const int64_t writer = d_writer.index.load (std::memory_order_relaxed);
+        for (; reader < writer; reader++) {
+            d_queue[reader % capacity ()].destroy ();
+        }
+    }
 
     SPSCQueue (SPSCQueue const&) = delete;
 
@@ -70,42 +116,254 @@ class SPSCQueue : public LFNodeTraits {
 
     template <class... Args>
     bool enqueue (Args&&... args) {
-        if (full (std::memory_order_acquire)) {
+        if (writableSlots (1) == 0) {
+            d_stats.onFull ();
+            INPLACE_TRACE_INSTANT ("spsc.full");
             return false;
         }
         int64_t index = d_writer.index.load (std::memory_order_relaxed);
-        d_queue[index % Capacity].create (std::forward<Args&&> (args)...);
-        d_writer.index.store (index + 1, std::memory_order_relaxed);
-        d_size.fetch_add (1, std::memory_order_release);
+        d_queue[index % capacity ()].create (std::forward<Args&&> (args)...);
+        publishWrite (index, 1);
         return true;
     }
 
     bool dequeue (ReaderCallable<T> auto&& callable) {
-        if (empty (std::memory_order_acquire)) {
+        if (readableSlots (1) == 0) {
+            d_stats.onEmpty ();
+            INPLACE_TRACE_INSTANT ("spsc.empty");
             return false;
         }
         int64_t index = d_reader.index.load (std::memory_order_relaxed);
-        std::invoke (callable, d_queue[index % Capacity].asData ());
-        d_queue[index % Capacity].destroy ();
-        d_reader.index.store (index + 1, std::memory_order_relaxed);
-        d_size.fetch_sub (1, std::memory_order_release);
+        std::invoke (callable, d_queue[index % capacity ()].asData ());
+        d_queue[index % capacity ()].destroy ();
+        publishRead (index, 1);
+        return true;
+    }
+
+    // Zero-copy producer side: reserves the next slot for the caller to construct in place.
+    // Only one claim may be outstanding; an abandoned claim is simply never published.
+    ClaimedSlot<SPSCQueue, T> tryClaim () {
+        if (writableSlots (1) == 0) {
+            d_stats.onFull ();
+            INPLACE_TRACE_INSTANT ("spsc.full");
+            return {};
+        }
+        int64_t index = d_writer.index.load (std::memory_order_relaxed);
+        return { this, index, d_queue[index % capacity ()].storage () };
+    }
+
+    // Zero-copy consumer side: exposes the oldest element in place until the view is released.
+    // Only one view may be outstanding.
+    PeekedSlot<SPSCQueue, T> tryPeek () {
+        if (readableSlots (1) == 0) {
+            d_stats.onEmpty ();
+            INPLACE_TRACE_INSTANT ("spsc.empty");
+            return {};
+        }
+        int64_t index = d_reader.index.load (std::memory_order_relaxed);
+        return { this, index, std::addressof (d_queue[index % capacity ()].asData ()) };
+    }
+
+    // Moves the oldest element out of its slot instead of handing out a reference to it.
+    std::optional<T> tryDequeue () {
+        auto view = tryPeek ();
+        if (!view) {
+            return std::nullopt;
+        }
+        return std::optional<T> (std::move (*view));
+    }
+
+    bool tryDequeue (T& out) {
+        auto view = tryPeek ();
+        if (!view) {
+            return false;
+        }
+        out = std::move (*view);
         return true;
     }
 
-    size_t size (std::memory_order m = std::memory_order_acquire) const { return d_size.load (m); }
-    bool empty (std::memory_order m = std::memory_order_acquire) const {
-        return d_size.load (m) == 0;
+    // Blocking variants of enqueue/dequeue: retry while `Strategy` spins, then park until the other
+    // side makes progress or `timeout` expires. Return false on timeout.
+    template <SpinLockWaitStrategy Strategy = SpinThenPark, class Rep, class Period, class... Args>
+    bool enqueueWait (std::chrono::duration<Rep, Period> timeout, Args&&... args)
+        requires std::same_as<BlockingPolicy, Blocking>
+    {
+        return parkUntil<Strategy> (d_notFull, Parker::deadlineAfter (timeout),
+                                    [&] { return enqueue (std::forward<Args> (args)...); },
+                                    d_stats);
+    }
+
+    template <SpinLockWaitStrategy Strategy = SpinThenPark, class Rep, class Period>
+    bool dequeueWait (std::chrono::duration<Rep, Period> timeout,
+                      ReaderCallable<T> auto&& callable)
+        requires std::same_as<BlockingPolicy, Blocking>
+    {
+        return parkUntil<Strategy> (d_notEmpty, Parker::deadlineAfter (timeout),
+                                    [&] { return dequeue (callable); }, d_stats);
+    }
+
+    // Copies as many elements of `range` as currently fit into the queue (a range of move iterators
+    // moves them instead) and publishes them with a single cursor update. Returns the number of
+    // elements enqueued. If copying throws, nothing is enqueued.
+    template <std::ranges::input_range Range>
+    size_t enqueueBulk (Range&& range) {
+        size_t wanted = capacity ();
+        if constexpr (std::ranges::sized_range<Range>) {
+            wanted = std::min (wanted, static_cast<size_t> (std::ranges::size (range)));
+        }
+        const size_t free = writableSlots (wanted);
+        int64_t index = d_writer.index.load (std::memory_order_relaxed);
+        size_t count = 0;
+        auto end = std::ranges::end (range);
+        try {
+            for (auto it = std::ranges::begin (range); count < free && it != end; ++it, ++count) {
+                d_queue[(index + count) % capacity ()].create (*it);
+            }
+        } catch (...) {
+            for (size_t i = 0; i < count; i++) {
+                d_queue[(index + i) % capacity ()].destroy ();
+            }
+            throw;
+        }
+        if (count == 0) {
+            d_stats.onFull ();
+            INPLACE_TRACE_INSTANT ("spsc.full");
+            return 0;
+        }
+        publishWrite (index, count);
+        return count;
+    }
+
+    // Hands up to `maxN` ready elements to `callable` as contiguous spans (two spans when the batch
+    // wraps around the ring), then destroys them and releases the slots with a single cursor
+    // update. Returns the number of elements dequeued.
+    template <std::invocable<std::span<T>> Callable>
+    size_t dequeueBulk (size_t maxN, Callable&& callable) {
+        const size_t count = std::min (maxN, readableSlots (maxN));
+        if (count == 0) {
+            d_stats.onEmpty ();
+            INPLACE_TRACE_INSTANT ("spsc.empty");
+            return 0;
+        }
+        int64_t index = d_reader.index.load (std::memory_order_relaxed);
+        size_t done = 0;
+        while (done < count) {
+            const size_t slot = (index + done) % capacity ();
+            const size_t run = std::min (count - done, static_cast<size_t> (capacity ()) - slot);
+            std::invoke (callable, std::span<T> (std::addressof (d_queue[slot].asData ()), run));
+            for (size_t i = slot; i < slot + run; i++) {
+                d_queue[i].destroy ();
+            }
+            done += run;
+        }
+        publishRead (index, count);
+        return count;
     }
+
+    size_t size (std::memory_order m = std::memory_order_acquire) const {
+        if constexpr (Mode == SPSCMode::SharedCounter) {
+            return d_size.load (m);
+        } else {
+            const int64_t reader = d_reader.index.load (m);
+            return static_cast<size_t> (d_writer.index.load (m) - reader);
+        }
+    }
+    bool empty (std::memory_order m = std::memory_order_acquire) const { return size (m) == 0; }
     bool full (std::memory_order m = std::memory_order_acquire) const {
-        return d_size.load (m) == Capacity;
+        return size (m) == static_cast<size_t> (capacity ());
+    }
+    int64_t capacity () const { return d_queue.size (); }
+
+    QueueStatsSnapshot stats () const { return d_stats.snapshot (); }
+
+   private:
+    template <class, class>
+    friend class ClaimedSlot;
+    template <class, class>
+    friend class PeekedSlot;
+
+    void commitClaim (int64_t index) {
+        publishWrite (index, 1);
+    }
+
+    void abandonClaim (int64_t) {
+    }
+
+    void releasePeek (int64_t index) {
+        d_queue[index % capacity ()].destroy ();
+        publishRead (index, 1);
+    }
+
+    // Number of slots the producer may fill. In CachedCursor mode the reader cursor is re-read
+    // only when the cached copy shows fewer than `wanted` free slots.
+    size_t writableSlots (size_t wanted) {
+        if constexpr (Mode == SPSCMode::SharedCounter) {
+            return capacity () - d_size.load (std::memory_order_acquire);
+        } else {
+            const int64_t index = d_writer.index.load (std::memory_order_relaxed);
+            size_t free = capacity () - (index - d_writer.peer);
+            if (free < wanted) {
+                d_writer.peer = d_reader.index.load (std::memory_order_acquire);
+                free = capacity () - (index - d_writer.peer);
+            }
+            return free;
+        }
+    }
+
+    // Number of elements the consumer may read. In CachedCursor mode the writer cursor is re-read
+    // only when the cached copy shows fewer than `wanted` ready elements.
+    size_t readableSlots (size_t wanted) {
+        if constexpr (Mode == SPSCMode::SharedCounter) {
+            return d_size.load (std::memory_order_acquire);
+        } else {
+            const int64_t index = d_reader.index.load (std::memory_order_relaxed);
+            size_t ready = d_reader.peer - index;
+            if (ready < wanted) {
+                d_reader.peer = d_writer.index.load (std::memory_order_acquire);
+                ready = d_reader.peer - index;
+            }
+            return ready;
+        }
+    }
+
+    void publishWrite (int64_t index, size_t count) {
+        if constexpr (Mode == SPSCMode::SharedCounter) {
+            d_writer.index.store (index + count, std::memory_order_relaxed);
+            const size_t previous = d_size.fetch_add (count, std::memory_order_release);
+            d_stats.onEnqueue (count, [previous, count] { return previous + count; });
+        } else {
+            d_writer.index.store (index + count, std::memory_order_release);
+            // Against the cached reader cursor: an upper bound that costs no shared load.
+            d_stats.onEnqueue (count, [this, index, count] {
+                return static_cast<size_t> (index + count - d_writer.peer);
+            });
+        }
+        INPLACE_TRACE_INSTANT ("spsc.enqueue", index, count);
+        d_notEmpty.notify (count);
+    }
+
+    void publishRead (int64_t index, size_t count) {
+        if constexpr (Mode == SPSCMode::SharedCounter) {
+            d_reader.index.store (index + count, std::memory_order_relaxed);
+            d_size.fetch_sub (count, std::memory_order_release);
+        } else {
+            d_reader.index.store (index + count, std::memory_order_release);
+        }
+        d_stats.onDequeue (count);
+        INPLACE_TRACE_INSTANT ("spsc.dequeue", index, count);
+        d_notFull.notify (count);
     }
 
    private:
     using Node = LockFreeNode<T>;
+    static_assert (sizeof (Node) == sizeof (T), "Nodes must be laid out like T for bulk spans");
     std::atomic<size_t> d_size = 0;
-    std::array<Node, Capacity> d_queue;
+    SlotArray<Node, Capacity> d_queue;
     RWTraits<int64_t> d_writer;
     RWTraits<int64_t> d_reader;
+    [[no_unique_address]] QueueParker<BlockingPolicy> d_notEmpty;
+    [[no_unique_address]] QueueParker<BlockingPolicy> d_notFull;
+    [[no_unique_address]] Stats d_stats;
 };
 }  // namespace inplace
 
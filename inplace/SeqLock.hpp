@@ -0,0 +1,122 @@
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <InplaceCommon.hpp>
+#include <SpinLock.hpp>
+
+namespace inplace {
+
+template <class T>
+concept SeqLockable = std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>;
+
+// Sequence lock around a value of trivially copyable T, for data read all the time and written
+// rarely (limits, reference data, fee tables). The writer makes the sequence odd, writes the
+// value and makes it even again; a reader copies the value between two reads of the sequence and
+// retries if they differ or are odd. Readers never write shared memory, so any number of them
+// keep the line in their caches until the next update, and a read that does not overlap a write
+// finishes in one pass.
+//
+// One writer at a time: concurrent store ()s must be serialized by the caller. The value is kept
+// as 64-bit words accessed with relaxed atomics, which keeps the racy copy well-defined; a torn
+// copy is never handed out.
+template <SeqLockable T, SpinLockWaitStrategy Strategy = WaitStrategyAdaptive>
+class alignas (CACHE_LINE_SIZE) SeqLock {
+    static constexpr size_t Words = (sizeof (T) + sizeof (uint64_t) - 1) / sizeof (uint64_t);
+
+    using Buffer = std::array<uint64_t, Words>;
+
+    public:
+    SeqLock () : SeqLock (T{}) {
+    }
+
+    explicit SeqLock (const T& value) {
+        write (value);
+    }
+
+    SeqLock (SeqLock const&) = delete;
+
+    SeqLock& operator= (SeqLock const&) = delete;
+
+    // Consistent copy of the value, retrying while a write is in progress.
+    T load () const {
+        T value;
+        Strategy strategy;
+        while (!tryLoad (value)) {
+            backOff (strategy);
+        }
+        return value;
+    }
+
+    // One attempt: false, leaving `value` alone, if it raced with a write.
+    bool tryLoad (T& value) const {
+        const uint64_t before = d_sequence.load (std::memory_order_acquire);
+        if (before & 1) {
+            return false;
+        }
+        Buffer buffer;
+        for (size_t i = 0; i < Words; i++) {
+            buffer[i] = d_words[i].load (std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if (d_sequence.load (std::memory_order_relaxed) != before) {
+            return false;
+        }
+        std::memcpy (static_cast<void*> (&value), buffer.data (), sizeof (T));
+        return true;
+    }
+
+    // Writer only.
+    void store (const T& value) {
+        const uint64_t sequence = d_sequence.load (std::memory_order_relaxed);
+        d_sequence.store (sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+        write (value);
+        d_sequence.store (sequence + 2, std::memory_order_release);
+    }
+
+    // Writer only: stores fn (current) in place of the current value. The writer reads its own
+    // value without retrying.
+    template <class F>
+    void update (F&& fn) {
+        T value = peek ();
+        fn (value);
+        store (value);
+    }
+
+    // Writer only: the current value, which no one else can be changing.
+    T peek () const {
+        Buffer buffer;
+        for (size_t i = 0; i < Words; i++) {
+            buffer[i] = d_words[i].load (std::memory_order_relaxed);
+        }
+        T value;
+        std::memcpy (static_cast<void*> (&value), buffer.data (), sizeof (T));
+        return value;
+    }
+
+    // Even, and advanced by two per store (), so readers can tell whether a value changed.
+    uint64_t version () const {
+        return d_sequence.load (std::memory_order_acquire);
+    }
+
+    private:
+    void write (const T& value) {
+        Buffer buffer{};
+        std::memcpy (buffer.data (), &value, sizeof (T));
+        for (size_t i = 0; i < Words; i++) {
+            d_words[i].store (buffer[i], std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint64_t> d_sequence = 0;
+    std::array<std::atomic<uint64_t>, Words> d_words;
+};
+}  // namespace inplace
+
+#endif  // SEQLOCK_HPP
@@ -0,0 +1,483 @@
+#ifndef SEQUENCEDMPMCQUEUE_HPP
+#define SEQUENCEDMPMCQUEUE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <functional>
+#include <InplaceCommon.hpp>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <MPMCQueue.hpp>
+#include <Parking.hpp>
+#include <SlotArray.hpp>
+#include <SlotHandle.hpp>
+#include <QueueStats.hpp>
+#include <Tracing.hpp>
+#include <chrono>
+
+namespace inplace {
+
+// Bounded MPMC queue in the style of Vyukov: every slot carries a sequence number ("turn") that
+// encodes both the lap the slot belongs to and whether it is empty or full.
+//   turn == 4 * lap      -> slot is empty and may be written by the producer of `lap`
+//   turn == 4 * lap + 1  -> slot is full and may be read by the consumer of `lap`
+//   turn == 4 * lap + 2  -> slot was claimed but abandoned; the consumer of `lap` skips it
+// Producers and consumers only CAS their own cursor; there is no shared size counter and no
+// commit cursor, so the only shared lines touched per operation are one cursor and one slot.
+// Offers the same enqueue/dequeue shape as MPMCQueue so it can be selected in its place.
+// Pass DYNAMIC_CAPACITY as Capacity to choose the capacity at construction time. `Stats` selects
+// what is counted (see QueueStats.hpp); the default records nothing. `BlockingPolicy` enables
+// enqueueWait/dequeueWait (see Parking.hpp); without it nothing on the enqueue/dequeue path looks
+// for parked threads.
+template <MPMCLockFreeType T, int64_t Capacity, QueueStatsPolicy Stats = NoQueueStats,
+          QueueBlockingPolicy BlockingPolicy = NonBlocking>
+class SequencedMPMCQueue : public MPMCNodeTraits {
+    public:
+    using value_type = T;
+
+    SequencedMPMCQueue ()
+        requires (Capacity != DYNAMIC_CAPACITY)
+    {
+        resetTurns ();
+    }
+
+    // For placement in memory shared between processes (see SharedMemoryQueue).
+    explicit SequencedMPMCQueue (ProcessSharedTag tag)
+        requires (Capacity != DYNAMIC_CAPACITY)
+        : d_notEmpty (tag), d_notFull (tag) {
+        resetTurns ();
+    }
+
+    explicit SequencedMPMCQueue (int64_t capacity, MappingOptions options = {})
+        requires (Capacity == DYNAMIC_CAPACITY)
+        : d_turns (capacity, options), d_slots (capacity, options) {
+        resetTurns ();
+    }
+
+    ~SequencedMPMCQueue () {
+        int64_t reader = d_reader.index.load (std::memory_order_relaxed);
+        int64_t writer = d_writer.index.load (std::memory_order_relaxed);
+        for (; reader < writer; reader++) {
+            if (d_turns[slot (reader)].load (std::memory_order_relaxed) == fullTurn (reader)) {
+                d_slots[slot (reader)].destroy ();
+            }
+        }
+    }
+
+    SequencedMPMCQueue (SequencedMPMCQueue const&) = delete;
+
+    SequencedMPMCQueue& operator= (SequencedMPMCQueue const&) = delete;
+
+    SequencedMPMCQueue (SequencedMPMCQueue&&) = delete;
+
+    SequencedMPMCQueue& operator= (SequencedMPMCQueue&&) = delete;
+
+    void stop () {
+        d_stop.store (true, std::memory_order_release);
+        d_notEmpty.notifyAll ();
+        d_notFull.notifyAll ();
+    }
+
+    bool isRunning () const {
+        return !d_stop.load (std::memory_order_acquire);
+    }
+
+    template <class... Args>
+    bool enqueue (Args&&... args) {
+        int64_t index = 0;
+        if (!reserveSlot (index)) {
+            d_stats.onFull ();
+            INPLACE_TRACE_INSTANT ("seqmpmc.full");
+            return false;
+        }
+        d_slots[slot (index)].create (std::forward<Args> (args)...);
+        commitClaim (index);
+        return true;
+    }
+
+    template <std::invocable<const T&> Callable>
+    bool dequeue (Callable&& callable) {
+        int64_t index = 0;
+        if (!reserveElement (index)) {
+            d_stats.onEmpty ();
+            INPLACE_TRACE_INSTANT ("seqmpmc.empty");
+            return false;
+        }
+        std::invoke (std::forward<Callable> (callable),
+                     std::as_const (d_slots[slot (index)].asData ()));
+        releasePeek (index);
+        return true;
+    }
+
+    // Zero-copy producer side: reserves a slot for the caller to construct in place. The consumer
+    // of that lap waits on the slot, so a claim dropped without commit () marks it skipped.
+    ClaimedSlot<SequencedMPMCQueue, T> tryClaim () {
+        int64_t index = 0;
+        if (!reserveSlot (index)) {
+            d_stats.onFull ();
+            INPLACE_TRACE_INSTANT ("seqmpmc.full");
+            return {};
+        }
+        return { this, index, d_slots[slot (index)].storage () };
+    }
+
+    // Zero-copy consumer side: exposes the element in place until the view is released.
+    PeekedSlot<SequencedMPMCQueue, T> tryPeek () {
+        int64_t index = 0;
+        if (!reserveElement (index)) {
+            d_stats.onEmpty ();
+            INPLACE_TRACE_INSTANT ("seqmpmc.empty");
+            return {};
+        }
+        return { this, index, std::addressof (d_slots[slot (index)].asData ()) };
+    }
+
+    // Moves an element out of its slot instead of handing out a reference to it.
+    std::optional<T> tryDequeue () {
+        auto view = tryPeek ();
+        if (!view) {
+            return std::nullopt;
+        }
+        return std::optional<T> (std::move (*view));
+    }
+
+    bool tryDequeue (T& out) {
+        auto view = tryPeek ();
+        if (!view) {
+            return false;
+        }
+        out = std::move (*view);
+        return true;
+    }
+
+    // Blocking variants of enqueue/dequeue: retry while `Strategy` spins, then park until the other
+    // side makes progress, the queue is stopped or `timeout` expires. Return false unless the
+    // element was transferred.
+    template <SpinLockWaitStrategy Strategy = SpinThenPark, class Rep, class Period, class... Args>
+    bool enqueueWait (std::chrono::duration<Rep, Period> timeout, Args&&... args)
+        requires std::same_as<BlockingPolicy, Blocking>
+    {
+        bool done = false;
+        parkUntil<Strategy> (d_notFull, Parker::deadlineAfter (timeout), [&] {
+            done = enqueue (std::forward<Args> (args)...);
+            return done || !isRunning ();
+        }, d_stats);
+        return done;
+    }
+
+    template <SpinLockWaitStrategy Strategy = SpinThenPark, class Rep, class Period,
+              std::invocable<const T&> Callable>
+    bool dequeueWait (std::chrono::duration<Rep, Period> timeout, Callable&& callable)
+        requires std::same_as<BlockingPolicy, Blocking>
+    {
+        bool done = false;
+        parkUntil<Strategy> (d_notEmpty, Parker::deadlineAfter (timeout), [&] {
+            done = dequeue (callable);
+            return done || !isRunning ();
+        }, d_stats);
+        return done;
+    }
+
+    // Reserves the longest run of free slots (up to the size of `range`) with a single CAS of the
+    // writer cursor, then copies into and publishes each slot. Returns the number of elements
+    // enqueued. If a copy throws, the elements copied before it stay enqueued and the rest of the
+    // reserved slots are skipped.
+    template <std::ranges::sized_range Range>
+    size_t enqueueBulk (Range&& range) {
+        const int64_t wanted = std::min (static_cast<int64_t> (std::ranges::size (range)),
+                                         capacity ());
+        if (wanted == 0) {
+            return 0;
+        }
+        int64_t first = d_writer.index.load (std::memory_order_acquire);
+        int64_t count = 0;
+        while (true) {
+            count = 0;
+            while (count < wanted && d_turns[slot (first + count)].load (
+                                         std::memory_order_acquire) == emptyTurn (first + count)) {
+                count++;
+            }
+            if (count == 0) {
+                const int64_t previous = first;
+                first = d_writer.index.load (std::memory_order_acquire);
+                if (first == previous) {
+                    d_stats.onFull ();
+                    INPLACE_TRACE_INSTANT ("seqmpmc.full");
+                    return 0;
+                }
+                continue;
+            }
+            if (d_writer.index.compare_exchange_strong (first, first + count,
+                                                        std::memory_order_relaxed)) {
+                break;
+            }
+            d_stats.onCasRetry ();
+        }
+
+        int64_t i = 0;
+        try {
+            auto it = std::ranges::begin (range);
+            for (; i < count; i++, ++it) {
+                d_slots[slot (first + i)].create (*it);
+                d_turns[slot (first + i)].store (fullTurn (first + i), std::memory_order_release);
+            }
+        } catch (...) {
+            // Consumers wait on every reserved slot: hand the rest of the batch over as skipped.
+            for (; i < count; i++) {
+                d_turns[slot (first + i)].store (skippedTurn (first + i), std::memory_order_release);
+            }
+            d_notEmpty.notify (static_cast<uint32_t> (count));
+            throw;
+        }
+        d_stats.onEnqueue (static_cast<size_t> (count), [this] { return size (); });
+        INPLACE_TRACE_INSTANT ("seqmpmc.enqueue", first, count);
+        d_notEmpty.notify (static_cast<uint32_t> (count));
+        return static_cast<size_t> (count);
+    }
+
+    // Claims the longest run of ready slots (up to `maxN`) with a single CAS of the reader cursor
+    // and hands its elements to `callable` as contiguous spans of the slot array: one span, or
+    // more when the run wraps around the ring or has skipped slots (abandoned claims) in it. A run
+    // of nothing but skipped slots claims the next one. Returns the number of elements dequeued.
+    template <std::invocable<std::span<T>> Callable>
+    size_t dequeueBulk (size_t maxN, Callable&& callable) {
+        const int64_t wanted = std::min (static_cast<int64_t> (maxN), capacity ());
+        if (wanted == 0) {
+            return 0;
+        }
+        while (true) {
+            int64_t first = d_reader.index.load (std::memory_order_acquire);
+            int64_t count = 0;
+            while (true) {
+                count = 0;
+                while (count < wanted &&
+                       readable (first + count, d_turns[slot (first + count)].load (
+                                                    std::memory_order_acquire))) {
+                    count++;
+                }
+                if (count == 0) {
+                    const int64_t previous = first;
+                    first = d_reader.index.load (std::memory_order_acquire);
+                    if (first == previous) {
+                        d_stats.onEmpty ();
+                        INPLACE_TRACE_INSTANT ("seqmpmc.empty");
+                        return 0;
+                    }
+                    continue;
+                }
+                if (d_reader.index.compare_exchange_strong (first, first + count,
+                                                            std::memory_order_relaxed)) {
+                    break;
+                }
+                d_stats.onCasRetry ();
+            }
+
+            int64_t read = 0;
+            int64_t done = 0;
+            while (done < count) {
+                const int64_t start = slot (first + done);
+                const int64_t limit = std::min (count - done, capacity () - start);
+                int64_t run = 0;
+                while (run < limit && isFull (first + done + run)) {
+                    run++;
+                }
+                if (run == 0) {
+                    done++;
+                    continue;
+                }
+                std::invoke (callable,
+                             std::span<T> (std::addressof (d_slots[start].asData ()), run));
+                done += run;
+                read += run;
+            }
+            for (int64_t i = 0; i < count; i++) {
+                if (isFull (first + i)) {
+                    d_slots[slot (first + i)].destroy ();
+                }
+                d_turns[slot (first + i)].store (emptyTurn (first + i + capacity ()),
+                                                 std::memory_order_release);
+            }
+            d_notFull.notify (static_cast<uint32_t> (count));
+            if (read == 0) {
+                continue;
+            }
+            d_stats.onDequeue (static_cast<size_t> (read));
+            INPLACE_TRACE_INSTANT ("seqmpmc.dequeue", first, read);
+            return static_cast<size_t> (read);
+        }
+    }
+
+    // size/empty/full are derived from the two cursors and are therefore only a snapshot when
+    // other threads are active. Abandoned claims count until a consumer skips them.
+    size_t size (std::memory_order m = std::memory_order_acquire) const {
+        const int64_t reader = d_reader.index.load (m);
+        const int64_t writer = d_writer.index.load (m);
+        const int64_t count = writer - reader;
+        if (count < 0) {
+            return 0;
+        }
+        return static_cast<size_t> (std::min (count, capacity ()));
+    }
+
+    bool empty (std::memory_order m = std::memory_order_acquire) const {
+        return size (m) == 0;
+    }
+
+    bool full (std::memory_order m = std::memory_order_acquire) const {
+        return size (m) == static_cast<size_t> (capacity ());
+    }
+
+    int64_t capacity () const {
+        return d_turns.size ();
+    }
+
+    QueueStatsSnapshot stats () const {
+        return d_stats.snapshot ();
+    }
+
+    private:
+    class Slot {
+        typedef std::aligned_storage_t<sizeof (T), alignof (T)> StorageType;
+        StorageType d_data;
+
+        public:
+        template <class... Args>
+        T* create (Args&&... args) {
+            return ::new (&d_data) T (std::forward<Args> (args)...);
+        }
+
+        T& asData () {
+            return *std::launder (reinterpret_cast<T*> (&d_data));
+        }
+
+        void destroy () {
+            asData ().~T ();
+        }
+
+        void* storage () {
+            return &d_data;
+        }
+    };
+
+    template <class, class>
+    friend class ClaimedSlot;
+    template <class, class>
+    friend class PeekedSlot;
+
+    // Moves `cursor` past one slot whose turn is `ready (index, turn)`; on success `index` is the
+    // slot's position. A turn that is not ready means either the slot still holds the previous lap
+    // or another thread has moved the cursor; only fail when the cursor did not move.
+    template <class Ready>
+    bool reserve (MPMCIndexTraits<int64_t>& cursor, int64_t& index, Ready&& ready) {
+        index = cursor.index.load (std::memory_order_acquire);
+        while (true) {
+            if (ready (index, d_turns[slot (index)].load (std::memory_order_acquire))) {
+                if (cursor.index.compare_exchange_strong (index, index + 1,
+                                                          std::memory_order_relaxed)) {
+                    return true;
+                }
+                d_stats.onCasRetry ();
+            } else {
+                const int64_t previous = index;
+                index = cursor.index.load (std::memory_order_acquire);
+                if (index == previous) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    void commitClaim (int64_t index) {
+        d_turns[slot (index)].store (fullTurn (index), std::memory_order_release);
+        d_stats.onEnqueue (1, [this] { return size (); });
+        INPLACE_TRACE_INSTANT ("seqmpmc.enqueue", index, 1);
+        d_notEmpty.notify ();
+    }
+
+    bool reserveSlot (int64_t& index) {
+        return reserve (d_writer, index, [this] (int64_t i, int64_t turn) {
+            return turn == emptyTurn (i);
+        });
+    }
+
+    // Reserves the next element for a consumer. Skipped slots met on the way are handed straight
+    // to the producers of the next lap.
+    bool reserveElement (int64_t& index) {
+        while (reserve (d_reader, index, [this] (int64_t i, int64_t turn) {
+            return readable (i, turn);
+        })) {
+            if (isFull (index)) {
+                return true;
+            }
+            d_turns[slot (index)].store (emptyTurn (index + capacity ()),
+                                         std::memory_order_release);
+            d_notFull.notify ();
+        }
+        return false;
+    }
+
+    void abandonClaim (int64_t index) {
+        d_turns[slot (index)].store (skippedTurn (index), std::memory_order_release);
+    }
+
+    void releasePeek (int64_t index) {
+        d_slots[slot (index)].destroy ();
+        d_turns[slot (index)].store (emptyTurn (index + capacity ()), std::memory_order_release);
+        d_stats.onDequeue (1);
+        INPLACE_TRACE_INSTANT ("seqmpmc.dequeue", index, 1);
+        d_notFull.notify ();
+    }
+
+    void resetTurns () {
+        for (int64_t i = 0; i < capacity (); i++) {
+            d_turns[i].store (0, std::memory_order_relaxed);
+        }
+    }
+
+    int64_t slot (int64_t index) const {
+        return index % capacity ();
+    }
+
+    int64_t emptyTurn (int64_t index) const {
+        return 4 * (index / capacity ());
+    }
+
+    int64_t fullTurn (int64_t index) const {
+        return 4 * (index / capacity ()) + 1;
+    }
+
+    int64_t skippedTurn (int64_t index) const {
+        return 4 * (index / capacity ()) + 2;
+    }
+
+    // Whether the consumer of `index` may take the slot: full, or skipped by its producer.
+    bool readable (int64_t index, int64_t turn) const {
+        return turn == fullTurn (index) || turn == skippedTurn (index);
+    }
+
+    // For a slot the caller has reserved, whose turn no longer changes under it.
+    bool isFull (int64_t index) const {
+        return d_turns[slot (index)].load (std::memory_order_relaxed) == fullTurn (index);
+    }
+
+    static_assert (sizeof (Slot) == sizeof (T), "Slots must be laid out like T for bulk spans");
+
+    private:
+    std::atomic_bool d_stop = false;
+    SlotArray<std::atomic<int64_t>, Capacity> d_turns;
+    SlotArray<Slot, Capacity> d_slots;
+    MPMCIndexTraits<int64_t> d_writer;
+    MPMCIndexTraits<int64_t> d_reader;
+    [[no_unique_address]] QueueParker<BlockingPolicy> d_notEmpty;
+    [[no_unique_address]] QueueParker<BlockingPolicy> d_notFull;
+    [[no_unique_address]] Stats d_stats;
+};
+}
+
+#endif //SEQUENCEDMPMCQUEUE_HPP
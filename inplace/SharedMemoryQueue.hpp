@@ -0,0 +1,362 @@
+#ifndef SHAREDMEMORYQUEUE_HPP
+#define SHAREDMEMORYQUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <InplaceCommon.hpp>
+#include <MPMCQueue.hpp>
+#include <Parking.hpp>
+#include <SPSCQueue.hpp>
+#include <SequencedMPMCQueue.hpp>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace inplace {
+
+// Versioned header at offset 0 of a shared queue region; the queue itself follows at
+// `queueOffset`. Everything in the region is addressed by offsets/indices, never by pointers, so
+// every process may map it at a different address.
+struct SharedQueueHeader {
+    // Stored little-endian, so the region starts with the bytes "IPCQUEUE".
+    static constexpr uint64_t MAGIC = 0x4555455551435049;
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t MaxParticipants = 16;
+
+    enum State : uint32_t { Initializing = 0, Ready = 1 };
+
+    // One attached process. `pid` is 0 for a free slot.
+    struct Participant {
+        std::atomic<int32_t> pid = 0;
+        std::atomic<uint64_t> heartbeatNs = 0;
+    };
+
+    uint64_t magic = MAGIC;
+    uint32_t version = VERSION;
+    uint32_t headerSize = sizeof (SharedQueueHeader);
+    uint64_t capacity = 0;
+    uint64_t elementSize = 0;
+    uint64_t elementAlign = 0;
+    uint64_t queueSize = 0;
+    uint64_t queueOffset = 0;
+    // Hash of the queue's type name: catches peers built with a different queue type.
+    uint64_t layoutId = 0;
+    std::atomic<uint32_t> state = Initializing;
+    std::array<Participant, MaxParticipants> participants;
+};
+
+static_assert (std::atomic<int32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free &&
+                   std::atomic<int64_t>::is_always_lock_free,
+               "shared queues rely on address-free (lock-free) atomics");
+
+// A fixed-capacity inplace queue placed in a shared memory region. One process create ()s the
+// region (named via shm_open, or anonymous via memfd_create whose descriptor is then inherited or
+// passed over a Unix socket) and other processes attach () to it. The payload must be trivially
+// copyable; it is copied between address spaces as raw bytes.
+//
+// Each process takes a participant slot holding its pid and a heartbeat, from which peers tell
+// whether the other side is still alive (see peerAlive ()).
+template <class Queue>
+class SharedMemoryQueue {
+    using T = typename Queue::value_type;
+    static_assert (std::is_trivially_copyable_v<T>, "shared queue payloads must be trivially copyable");
+
+    public:
+    static constexpr auto AttachTimeout = std::chrono::seconds (5);
+
+    // Creates and initialises a named region; fails if the name already exists. The creator
+    // unlinks the name again when it is destroyed.
+    static SharedMemoryQueue create (const std::string& name) {
+        const int fd = ::shm_open (name.c_str (), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            throw std::system_error (errno, std::generic_category (), "shm_open(" + name + ")");
+        }
+        SharedMemoryQueue queue (fd, name);
+        queue.initialise ();
+        return queue;
+    }
+
+    // Creates an unnamed region; share it by handing fd () to another process.
+    static SharedMemoryQueue createAnonymous (const std::string& debugName = "inplace-queue") {
+        const int fd = ::memfd_create (debugName.c_str (), MFD_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error (errno, std::generic_category (), "memfd_create");
+        }
+        SharedMemoryQueue queue (fd, {});
+        queue.initialise ();
+        return queue;
+    }
+
+    static SharedMemoryQueue attach (const std::string& name) {
+        const int fd = ::shm_open (name.c_str (), O_RDWR, 0600);
+        if (fd < 0) {
+            throw std::system_error (errno, std::generic_category (), "shm_open(" + name + ")");
+        }
+        SharedMemoryQueue queue (fd, {});
+        queue.attachExisting ();
+        return queue;
+    }
+
+    // Attaches to a region received as a descriptor. Takes ownership of a duplicate of `fd`.
+    static SharedMemoryQueue attach (int fd) {
+        const int copy = ::dup (fd);
+        if (copy < 0) {
+            throw std::system_error (errno, std::generic_category (), "dup");
+        }
+        SharedMemoryQueue queue (copy, {});
+        queue.attachExisting ();
+        return queue;
+    }
+
+    static void unlink (const std::string& name) {
+        ::shm_unlink (name.c_str ());
+    }
+
+    ~SharedMemoryQueue () {
+        if (d_header != nullptr && d_slot < SharedQueueHeader::MaxParticipants) {
+            d_header->participants[d_slot].pid.store (0, std::memory_order_release);
+        }
+        if (d_base != nullptr) {
+            ::munmap (d_base, RegionSize);
+        }
+        if (d_fd >= 0) {
+            ::close (d_fd);
+        }
+        if (!d_unlinkName.empty ()) {
+            unlink (d_unlinkName);
+        }
+    }
+
+    SharedMemoryQueue (SharedMemoryQueue const&) = delete;
+
+    SharedMemoryQueue& operator= (SharedMemoryQueue const&) = delete;
+
+    SharedMemoryQueue (SharedMemoryQueue&& rhs) noexcept
+        : d_fd (std::exchange (rhs.d_fd, -1)), d_base (std::exchange (rhs.d_base, nullptr)),
+          d_header (std::exchange (rhs.d_header, nullptr)),
+          d_queue (std::exchange (rhs.d_queue, nullptr)),
+          d_slot (std::exchange (rhs.d_slot, SharedQueueHeader::MaxParticipants)),
+          d_unlinkName (std::exchange (rhs.d_unlinkName, {})) {
+    }
+
+    SharedMemoryQueue& operator= (SharedMemoryQueue&&) = delete;
+
+    Queue& queue () {
+        return *d_queue;
+    }
+
+    Queue* operator-> () {
+        return d_queue;
+    }
+
+    int fd () const {
+        return d_fd;
+    }
+
+    const SharedQueueHeader& header () const {
+        return *d_header;
+    }
+
+    // Publishes a sign of life for peers that check with a `maxSilence`.
+    void heartbeat () {
+        d_header->participants[d_slot].heartbeatNs.store (monotonicNs (),
+                                                          std::memory_order_release);
+    }
+
+    // True while some other attached process exists and, if `maxSilence` is non-zero, has
+    // heartbeat () within it. A peer that died without detaching is detected through its pid.
+    bool peerAlive (std::chrono::nanoseconds maxSilence = std::chrono::nanoseconds::zero ()) const {
+        for (size_t i = 0; i < SharedQueueHeader::MaxParticipants; i++) {
+            if (i != d_slot && participantAlive (i, maxSilence)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Frees the slots of peers whose process no longer exists; returns how many were reaped.
+    size_t reapDeadPeers () {
+        size_t reaped = 0;
+        for (size_t i = 0; i < SharedQueueHeader::MaxParticipants; i++) {
+            auto& participant = d_header->participants[i];
+            int32_t pid = participant.pid.load (std::memory_order_acquire);
+            if (i != d_slot && pid != 0 && !processExists (pid) &&
+                participant.pid.compare_exchange_strong (pid, 0, std::memory_order_acq_rel)) {
+                reaped++;
+            }
+        }
+        return reaped;
+    }
+
+    static constexpr size_t queueOffset () {
+        return (sizeof (SharedQueueHeader) + alignof (Queue) - 1) / alignof (Queue) * alignof (Queue);
+    }
+
+    static constexpr size_t RegionSize = queueOffset () + sizeof (Queue);
+
+    private:
+    SharedMemoryQueue (int fd, std::string unlinkName)
+        : d_fd (fd), d_unlinkName (std::move (unlinkName)) {
+    }
+
+    void initialise () {
+        if (::ftruncate (d_fd, static_cast<off_t> (RegionSize)) != 0) {
+            throw std::system_error (errno, std::generic_category (), "ftruncate");
+        }
+        map ();
+        d_header = ::new (d_base) SharedQueueHeader;
+        d_queue = ::new (static_cast<char*> (d_base) + queueOffset ()) Queue (processShared);
+        d_header->capacity = static_cast<uint64_t> (d_queue->capacity ());
+        d_header->elementSize = sizeof (T);
+        d_header->elementAlign = alignof (T);
+        d_header->queueSize = sizeof (Queue);
+        d_header->queueOffset = queueOffset ();
+        d_header->layoutId = layoutId ();
+        join ();
+        d_header->state.store (SharedQueueHeader::Ready, std::memory_order_release);
+    }
+
+    void attachExisting () {
+        struct stat info {};
+        if (::fstat (d_fd, &info) != 0) {
+            throw std::system_error (errno, std::generic_category (), "fstat");
+        }
+        if (static_cast<size_t> (info.st_size) != RegionSize) {
+            throw std::runtime_error ("shared queue region has size " + std::to_string (info.st_size) +
+                                      ", expected " + std::to_string (RegionSize));
+        }
+        map ();
+        d_header = std::launder (reinterpret_cast<SharedQueueHeader*> (d_base));
+        const auto deadline = std::chrono::steady_clock::now () + AttachTimeout;
+        while (d_header->state.load (std::memory_order_acquire) != SharedQueueHeader::Ready) {
+            if (std::chrono::steady_clock::now () > deadline) {
+                throw std::runtime_error ("shared queue was never initialised by its creator");
+            }
+            std::this_thread::yield ();
+        }
+        validate ();
+        d_queue = std::launder (reinterpret_cast<Queue*> (static_cast<char*> (d_base) + queueOffset ()));
+        join ();
+    }
+
+    void validate () const {
+        const auto& h = *d_header;
+        auto mismatch = [] (const char* what, uint64_t found, uint64_t expected) {
+            throw std::runtime_error (std::string ("shared queue ") + what + " mismatch: found " +
+                                      std::to_string (found) + ", expected " +
+                                      std::to_string (expected));
+        };
+        if (h.magic != SharedQueueHeader::MAGIC) {
+            mismatch ("magic", h.magic, SharedQueueHeader::MAGIC);
+        }
+        if (h.version != SharedQueueHeader::VERSION) {
+            mismatch ("version", h.version, SharedQueueHeader::VERSION);
+        }
+        if (h.headerSize != sizeof (SharedQueueHeader)) {
+            mismatch ("header size", h.headerSize, sizeof (SharedQueueHeader));
+        }
+        if (h.elementSize != sizeof (T) || h.elementAlign != alignof (T)) {
+            mismatch ("element size", h.elementSize, sizeof (T));
+        }
+        if (h.queueSize != sizeof (Queue) || h.queueOffset != queueOffset ()) {
+            mismatch ("queue size", h.queueSize, sizeof (Queue));
+        }
+        if (h.layoutId != layoutId ()) {
+            mismatch ("queue type", h.layoutId, layoutId ());
+        }
+    }
+
+    void map () {
+        void* base = ::mmap (nullptr, RegionSize, PROT_READ | PROT_WRITE, MAP_SHARED, d_fd, 0);
+        if (base == MAP_FAILED) {
+            throw std::system_error (errno, std::generic_category (), "mmap");
+        }
+        d_base = base;
+    }
+
+    // Takes a free participant slot, reclaiming slots of dead processes if all are taken.
+    void join () {
+        const auto pid = static_cast<int32_t> (::getpid ());
+        for (int attempt = 0; attempt < 2; attempt++) {
+            for (size_t i = 0; i < SharedQueueHeader::MaxParticipants; i++) {
+                int32_t expected = 0;
+                if (d_header->participants[i].pid.compare_exchange_strong (
+                        expected, pid, std::memory_order_acq_rel)) {
+                    d_slot = i;
+                    heartbeat ();
+                    return;
+                }
+            }
+            reapDeadPeers ();
+        }
+        throw std::runtime_error ("shared queue has no free participant slot");
+    }
+
+    bool participantAlive (size_t index, std::chrono::nanoseconds maxSilence) const {
+        const auto& participant = d_header->participants[index];
+        const int32_t pid = participant.pid.load (std::memory_order_acquire);
+        if (pid == 0 || !processExists (pid)) {
+            return false;
+        }
+        if (maxSilence == std::chrono::nanoseconds::zero ()) {
+            return true;
+        }
+        const uint64_t last = participant.heartbeatNs.load (std::memory_order_acquire);
+        return monotonicNs () - last <= static_cast<uint64_t> (maxSilence.count ());
+    }
+
+    static bool processExists (int32_t pid) {
+        return ::kill (pid, 0) == 0 || errno == EPERM;
+    }
+
+    // CLOCK_MONOTONIC is system wide, so heartbeats compare across processes.
+    static uint64_t monotonicNs () {
+        timespec now{};
+        ::clock_gettime (CLOCK_MONOTONIC, &now);
+        return static_cast<uint64_t> (now.tv_sec) * 1000000000ull + static_cast<uint64_t> (now.tv_nsec);
+    }
+
+    static uint64_t layoutId () {
+        // FNV-1a of the mangled type name; stable for peers built by the same toolchain.
+        uint64_t hash = 14695981039346656037ull;
+        for (const char* c = typeid (Queue).name (); *c != '\0'; c++) {
+            hash = (hash ^ static_cast<unsigned char> (*c)) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    int d_fd = -1;
+    void* d_base = nullptr;
+    SharedQueueHeader* d_header = nullptr;
+    Queue* d_queue = nullptr;
+    size_t d_slot = SharedQueueHeader::MaxParticipants;
+    std::string d_unlinkName;
+};
+
+template <class T, int64_t Capacity>
+using SharedSPSCQueue = SharedMemoryQueue<SPSCQueue<T, Capacity, SPSCMode::CachedCursor>>;
+
+template <class T, int64_t Capacity>
+using SharedMPMCQueue = SharedMemoryQueue<MPMCQueue<T, Capacity>>;
+
+template <class T, int64_t Capacity>
+using SharedSequencedMPMCQueue = SharedMemoryQueue<SequencedMPMCQueue<T, Capacity>>;
+}  // namespace inplace
+
+#endif  // SHAREDMEMORYQUEUE_HPP
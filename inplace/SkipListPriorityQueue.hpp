@@ -0,0 +1,273 @@
+#ifndef SKIPLISTPRIORITYQUEUE_HPP
+#define SKIPLISTPRIORITYQUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <EpochReclamation.hpp>
+#include <InplaceCommon.hpp>
+#include <QueueStats.hpp>
+#include <Tracing.hpp>
+
+namespace inplace {
+
+// Exact concurrent priority queue: a lock-free skiplist (Herlihy & Shavit's LockFreeSkipList with
+// Lotan & Shavit's deleteMin). dequeue () hands out the highest priority element according to
+// `Compare` (std::less: largest first, like std::priority_queue); equal elements come out in
+// insertion order. dequeue () claims the first unclaimed node of the bottom level with one
+// exchange and then unlinks it; enqueue () links a node bottom-up and makes it visible to
+// dequeue () once every level is linked.
+//
+// Nodes are heap allocated. Every operation pins the queue's EpochDomain and unlinked nodes are
+// retired to it, so they are freed in batches once no traversal can still hold them, even while
+// the queue stays busy. Elements are not moved once enqueued (concurrent traversals compare
+// them), so dequeue () passes a const reference.
+template <class T, int64_t Capacity, class Compare = std::less<T>, QueueStatsPolicy Stats = NoQueueStats>
+class SkipListPriorityQueue {
+    static_assert (Capacity > 0);
+
+    static constexpr int MaxLevel = 16;
+
+    struct Tower {
+        std::atomic<uintptr_t> next[MaxLevel] = {};
+    };
+
+    struct Node {
+        template <class... Args>
+        Node (int levelCount, uint64_t ticket, Args&&... args)
+            : value (std::forward<Args> (args)...), ticket (ticket), levels (levelCount) {
+        }
+
+        Tower tower;
+        T value;
+        uint64_t ticket;
+        int levels;
+        std::atomic<bool> fullyLinked = false;
+        std::atomic<bool> taken = false;
+    };
+
+    // Bit 0 of a next pointer marks its owner as deleted at that level.
+    static Node* ptr (uintptr_t link) {
+        return reinterpret_cast<Node*> (link & ~uintptr_t{ 1 });
+    }
+
+    static bool marked (uintptr_t link) {
+        return (link & 1) != 0;
+    }
+
+    static uintptr_t pack (Node* node, bool mark = false) {
+        return reinterpret_cast<uintptr_t> (node) | static_cast<uintptr_t> (mark);
+    }
+
+    public:
+    using value_type = T;
+
+    SkipListPriorityQueue () = default;
+
+    ~SkipListPriorityQueue () {
+        Node* node = ptr (d_head.next[0].load (std::memory_order_relaxed));
+        while (node != nullptr) {
+            Node* next = ptr (node->tower.next[0].load (std::memory_order_relaxed));
+            delete node;
+            node = next;
+        }
+        // d_epochs frees the retired nodes.
+    }
+
+    SkipListPriorityQueue (SkipListPriorityQueue const&) = delete;
+
+    SkipListPriorityQueue& operator= (SkipListPriorityQueue const&) = delete;
+
+    template <class... Args>
+    bool enqueue (Args&&... args) {
+        if (d_size.fetch_add (1, std::memory_order_relaxed) >= Capacity) {
+            d_size.fetch_sub (1, std::memory_order_relaxed);
+            d_stats.onFull ();
+            INPLACE_TRACE_INSTANT ("skiplist.full");
+            return false;
+        }
+        Node* node = nullptr;
+        try {
+            node = new Node (randomLevels (), d_tickets.fetch_add (1, std::memory_order_relaxed),
+                             std::forward<Args> (args)...);
+        } catch (...) {
+            d_size.fetch_sub (1, std::memory_order_relaxed);
+            throw;
+        }
+        auto pinned = d_epochs.pin ();
+        Tower* preds[MaxLevel];
+        Node* succs[MaxLevel];
+        while (true) {
+            find (*node, preds, succs);
+            for (int level = 0; level < node->levels; level++) {
+                node->tower.next[level].store (pack (succs[level]), std::memory_order_relaxed);
+            }
+            uintptr_t expected = pack (succs[0]);
+            if (preds[0]->next[0].compare_exchange_strong (expected, pack (node),
+                                                           std::memory_order_release,
+                                                           std::memory_order_relaxed)) {
+                break;
+            }
+            d_stats.onCasRetry ();
+        }
+        for (int level = 1; level < node->levels; level++) {
+            while (true) {
+                uintptr_t expected = pack (succs[level]);
+                if (preds[level]->next[level].compare_exchange_strong (
+                        expected, pack (node), std::memory_order_release,
+                        std::memory_order_relaxed)) {
+                    break;
+                }
+                d_stats.onCasRetry ();
+                find (*node, preds, succs);
+                // Nobody else writes this level of the node before it is linked there.
+                node->tower.next[level].store (pack (succs[level]), std::memory_order_relaxed);
+            }
+        }
+        node->fullyLinked.store (true, std::memory_order_release);
+        d_stats.onEnqueue (1, [this] { return size (); });
+        INPLACE_TRACE_INSTANT ("skiplist.enqueue", node->levels);
+        return true;
+    }
+
+    // Passes the highest priority element to `callable` and removes it.
+    template <std::invocable<const T&> Callable>
+    bool dequeue (Callable&& callable) {
+        auto pinned = d_epochs.pin ();
+        Node* node = claimFirst ();
+        if (node == nullptr) {
+            d_stats.onEmpty ();
+            INPLACE_TRACE_INSTANT ("skiplist.empty");
+            return false;
+        }
+        std::invoke (std::forward<Callable> (callable), std::as_const (node->value));
+        unlink (*node);
+        d_size.fetch_sub (1, std::memory_order_relaxed);
+        d_stats.onDequeue (1);
+        INPLACE_TRACE_INSTANT ("skiplist.dequeue");
+        return true;
+    }
+
+    std::optional<T> tryDequeue ()
+        requires std::copy_constructible<T>
+    {
+        std::optional<T> value;
+        dequeue ([&value] (const T& element) { value.emplace (element); });
+        return value;
+    }
+
+    // Counts claimed and in-flight elements too, so it is exact only while the queue is idle.
+    size_t size (std::memory_order m = std::memory_order_acquire) const {
+        const int64_t size = d_size.load (m);
+        return size > 0 ? static_cast<size_t> (size) : 0;
+    }
+
+    bool empty (std::memory_order m = std::memory_order_acquire) const {
+        return size (m) == 0;
+    }
+
+    bool full (std::memory_order m = std::memory_order_acquire) const {
+        return size (m) >= static_cast<size_t> (Capacity);
+    }
+
+    static constexpr int64_t capacity () {
+        return Capacity;
+    }
+
+    QueueStatsSnapshot stats () const {
+        return d_stats.snapshot ();
+    }
+
+    private:
+    // True when `a` is dequeued before `b`.
+    bool before (const Node& a, const Node& b) const {
+        if (d_compare (b.value, a.value)) {
+            return true;
+        }
+        return !d_compare (a.value, b.value) && a.ticket < b.ticket;
+    }
+
+    static int randomLevels () {
+        const int levels = 1 + std::countr_zero (fastRandom () | (uint64_t{ 1 } << (MaxLevel - 1)));
+        return std::min (levels, MaxLevel);
+    }
+
+    // Fills, per level, the last node before `key` and its successor, unlinking marked nodes on the
+    // way.
+    void find (const Node& key, Tower** preds, Node** succs) {
+        while (!tryFind (key, preds, succs)) {
+            d_stats.onCasRetry ();
+        }
+    }
+
+    bool tryFind (const Node& key, Tower** preds, Node** succs) {
+        Tower* pred = &d_head;
+        for (int level = MaxLevel - 1; level >= 0; level--) {
+            Node* curr = ptr (pred->next[level].load (std::memory_order_acquire));
+            while (curr != nullptr) {
+                const uintptr_t succ = curr->tower.next[level].load (std::memory_order_acquire);
+                if (marked (succ)) {
+                    uintptr_t expected = pack (curr);
+                    if (!pred->next[level].compare_exchange_strong (expected, pack (ptr (succ)),
+                                                                    std::memory_order_acq_rel,
+                                                                    std::memory_order_relaxed)) {
+                        return false;
+                    }
+                    curr = ptr (succ);
+                } else if (before (*curr, key)) {
+                    pred = &curr->tower;
+                    curr = ptr (succ);
+                } else {
+                    break;
+                }
+            }
+            preds[level] = pred;
+            succs[level] = curr;
+        }
+        return true;
+    }
+
+    Node* claimFirst () {
+        Node* node = ptr (d_head.next[0].load (std::memory_order_acquire));
+        while (node != nullptr) {
+            if (node->fullyLinked.load (std::memory_order_acquire) &&
+                !node->taken.load (std::memory_order_relaxed) &&
+                !node->taken.exchange (true, std::memory_order_acq_rel)) {
+                return node;
+            }
+            node = ptr (node->tower.next[0].load (std::memory_order_acquire));
+        }
+        return nullptr;
+    }
+
+    // Marks every level of a claimed node top-down, lets find () unlink it and retires it.
+    void unlink (Node& node) {
+        for (int level = node.levels - 1; level >= 0; level--) {
+            uintptr_t succ = node.tower.next[level].load (std::memory_order_relaxed);
+            while (!marked (succ) &&
+                   !node.tower.next[level].compare_exchange_weak (succ, succ | 1,
+                                                                  std::memory_order_acq_rel,
+                                                                  std::memory_order_relaxed)) {
+            }
+        }
+        Tower* preds[MaxLevel];
+        Node* succs[MaxLevel];
+        find (node, preds, succs);
+        d_epochs.retire (&node);
+    }
+
+    Tower d_head;
+    [[no_unique_address]] Compare d_compare;
+    alignas (inplace::CACHE_LINE_SIZE) std::atomic<int64_t> d_size = 0;
+    std::atomic<uint64_t> d_tickets = 0;
+    EpochDomain d_epochs;
+    [[no_unique_address]] Stats d_stats;
+};
+}  // namespace inplace
+
+#endif  // SKIPLISTPRIORITYQUEUE_HPP
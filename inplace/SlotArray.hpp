@@ -0,0 +1,153 @@
+#ifndef SLOTARRAY_HPP
+#define SLOTARRAY_HPP
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <InplaceCommon.hpp>
+#include <MappedRegion.hpp>
+
+namespace inplace {
+
+// Slot layout policies: how a queue's slots are placed in memory. `Cell<Node>` wraps one slot and
+// position<Node> (slot, capacity) maps a slot number to the cell that holds it; the mapping must
+// be a permutation of [0, capacity).
+//
+//   PackedSlots:     slots back to back; the smallest footprint, but producers and consumers
+//                    working on neighbouring slots write the same cache line.
+//   PaddedSlots:     one slot per cache line (or more lines for big slots); no false sharing
+//                    between slots at the cost of memory and of adjacent-slot prefetching.
+//   SwizzledSlots:   packed cells, but consecutive slots are spread over different lines (slot i
+//                    goes to line i % lines), so neighbours stop sharing a line while the
+//                    footprint stays packed. Slots `lines` apart share one instead.
+template <class Layout>
+concept SlotLayoutPolicy = requires (int64_t slot, int64_t capacity) {
+    typename Layout::template Cell<int>;
+    { Layout::template position<int> (slot, capacity) } -> std::same_as<int64_t>;
+};
+
+struct PackedSlots {
+    template <class Node>
+    struct Cell {
+        Node node;
+    };
+
+    template <class Node>
+    static constexpr int64_t position (int64_t slot, int64_t) {
+        return slot;
+    }
+};
+
+template <size_t LineSize = CACHE_LINE_SIZE>
+struct PaddedSlots {
+    template <class Node>
+    struct alignas (std::max (LineSize, alignof (Node))) Cell {
+        Node node;
+    };
+
+    template <class Node>
+    static constexpr int64_t position (int64_t slot, int64_t) {
+        return slot;
+    }
+};
+
+template <size_t LineSize = CACHE_LINE_SIZE>
+struct SwizzledSlots {
+    template <class Node>
+    struct Cell {
+        Node node;
+    };
+
+    // Only the largest prefix made of whole lines is swizzled; the remainder keeps its place.
+    template <class Node>
+    static constexpr int64_t position (int64_t slot, int64_t capacity) {
+        constexpr int64_t perLine = std::max<int64_t> (1, LineSize / sizeof (Cell<Node>));
+        const int64_t lines = capacity / perLine;
+        if (perLine == 1 || slot >= lines * perLine) {
+            return slot;
+        }
+        return (slot % lines) * perLine + slot / lines;
+    }
+};
+
+static_assert (SlotLayoutPolicy<PackedSlots>);
+static_assert (SlotLayoutPolicy<PaddedSlots<>>);
+static_assert (SlotLayoutPolicy<SwizzledSlots<>>);
+
+// Slot storage shared by the inplace queues. With a compile-time capacity the slots live inline
+// in the queue object; with DYNAMIC_CAPACITY the capacity is chosen at construction time and the
+// slots live in their own (optionally huge-page backed, prefaulted) mapping. Indices are slot
+// numbers in [0, size ()); `Layout` decides where each slot is stored.
+template <class Node, int64_t Capacity, SlotLayoutPolicy Layout = PackedSlots>
+class SlotArray {
+    static_assert (Capacity > 0, "Capacity must be positive");
+
+    using Cell = typename Layout::template Cell<Node>;
+
+    public:
+    Node& operator[] (int64_t index) {
+        return d_cells[Layout::template position<Node> (index, Capacity)].node;
+    }
+
+    const Node& operator[] (int64_t index) const {
+        return d_cells[Layout::template position<Node> (index, Capacity)].node;
+    }
+
+    static constexpr int64_t size () {
+        return Capacity;
+    }
+
+    private:
+    std::array<Cell, Capacity> d_cells;
+};
+
+template <class Node, SlotLayoutPolicy Layout>
+class SlotArray<Node, DYNAMIC_CAPACITY, Layout> {
+    using Cell = typename Layout::template Cell<Node>;
+
+    public:
+    explicit SlotArray (int64_t capacity, MappingOptions options = {})
+        : d_region (checkedBytes (capacity), options),
+          d_cells (static_cast<Cell*> (d_region.data ())),
+          d_size (capacity) {
+        std::uninitialized_default_construct_n (d_cells, d_size);
+    }
+
+    ~SlotArray () {
+        std::destroy_n (d_cells, d_size);
+    }
+
+    SlotArray (SlotArray const&) = delete;
+
+    SlotArray& operator= (SlotArray const&) = delete;
+
+    Node& operator[] (int64_t index) {
+        return d_cells[Layout::template position<Node> (index, d_size)].node;
+    }
+
+    const Node& operator[] (int64_t index) const {
+        return d_cells[Layout::template position<Node> (index, d_size)].node;
+    }
+
+    int64_t size () const {
+        return d_size;
+    }
+
+    private:
+    static size_t checkedBytes (int64_t capacity) {
+        if (capacity <= 0) {
+            throw std::invalid_argument ("capacity must be positive");
+        }
+        return sizeof (Cell) * static_cast<size_t> (capacity);
+    }
+
+    MappedRegion d_region;
+    Cell* d_cells;
+    int64_t d_size;
+};
+}  // namespace inplace
+
+#endif  // SLOTARRAY_HPP
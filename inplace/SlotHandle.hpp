@@ -0,0 +1,169 @@
+#ifndef SLOTHANDLE_HPP
+#define SLOTHANDLE_HPP
+
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace inplace {
+
+// Two-phase access to a queue slot, so that producers can build and consumers can parse elements
+// directly in ring memory instead of copying them in and out.
+//
+//   if (auto slot = q.tryClaim ()) {         if (auto view = q.tryPeek ()) {
+//       new (slot.ptr ()) Msg{ ... };            parse (*view);
+//       slot.commit ();                          view.release ();
+//   }                                        }
+//
+// The queue side of the protocol is three private members reached through friendship:
+// commitClaim (index), abandonClaim (index) and releasePeek (index).
+
+// A reserved, not yet constructed slot. Construct a T at ptr () (or call emplace ()) and then
+// commit () to publish it. A claim that goes out of scope uncommitted is handed back with
+// abandonClaim (); see the queue for what that means. A T built by emplace () is destroyed first;
+// after constructing at ptr () yourself, call constructed () so that it is too.
+template <class Queue, class T>
+class [[nodiscard]] ClaimedSlot {
+    public:
+    ClaimedSlot () = default;
+
+    ClaimedSlot (Queue* queue, int64_t index, void* storage)
+        : d_queue (queue), d_index (index), d_storage (storage) {
+    }
+
+    ~ClaimedSlot () {
+        abandon ();
+    }
+
+    ClaimedSlot (ClaimedSlot const&) = delete;
+
+    ClaimedSlot& operator= (ClaimedSlot const&) = delete;
+
+    ClaimedSlot (ClaimedSlot&& rhs) noexcept
+        : d_queue (std::exchange (rhs.d_queue, nullptr)), d_index (rhs.d_index),
+          d_storage (std::exchange (rhs.d_storage, nullptr)),
+          d_constructed (std::exchange (rhs.d_constructed, false)) {
+    }
+
+    ClaimedSlot& operator= (ClaimedSlot&& rhs) noexcept {
+        if (this != &rhs) {
+            abandon ();
+            d_queue = std::exchange (rhs.d_queue, nullptr);
+            d_index = rhs.d_index;
+            d_storage = std::exchange (rhs.d_storage, nullptr);
+            d_constructed = std::exchange (rhs.d_constructed, false);
+        }
+        return *this;
+    }
+
+    explicit operator bool () const {
+        return d_queue != nullptr;
+    }
+
+    // Raw, uninitialised storage for one T.
+    T* ptr () const {
+        return static_cast<T*> (d_storage);
+    }
+
+    template <class... Args>
+    T& emplace (Args&&... args) {
+        T& value = *::new (d_storage) T (std::forward<Args> (args)...);
+        d_constructed = true;
+        return value;
+    }
+
+    // Records that a T was constructed at ptr (), so that dropping the claim destroys it.
+    void constructed () {
+        d_constructed = true;
+    }
+
+    // Publishes the element constructed at ptr (). Must be called at most once.
+    void commit () {
+        d_constructed = false;
+        std::exchange (d_queue, nullptr)->commitClaim (d_index);
+    }
+
+    private:
+    void abandon () {
+        if (d_queue == nullptr) {
+            return;
+        }
+        if (std::exchange (d_constructed, false)) {
+            ptr ()->~T ();
+        }
+        std::exchange (d_queue, nullptr)->abandonClaim (d_index);
+    }
+
+    Queue* d_queue = nullptr;
+    int64_t d_index = 0;
+    void* d_storage = nullptr;
+    bool d_constructed = false;
+};
+
+// A claimed, fully constructed element that stays in the ring until release () (or destruction
+// of the view) destroys it and hands the slot back to the producers.
+template <class Queue, class T>
+class [[nodiscard]] PeekedSlot {
+    public:
+    PeekedSlot () = default;
+
+    PeekedSlot (Queue* queue, int64_t index, T* data)
+        : d_queue (queue), d_index (index), d_data (data) {
+    }
+
+    ~PeekedSlot () {
+        if (d_queue != nullptr) {
+            release ();
+        }
+    }
+
+    PeekedSlot (PeekedSlot const&) = delete;
+
+    PeekedSlot& operator= (PeekedSlot const&) = delete;
+
+    PeekedSlot (PeekedSlot&& rhs) noexcept
+        : d_queue (std::exchange (rhs.d_queue, nullptr)), d_index (rhs.d_index),
+          d_data (std::exchange (rhs.d_data, nullptr)) {
+    }
+
+    PeekedSlot& operator= (PeekedSlot&& rhs) noexcept {
+        if (this != &rhs) {
+            if (d_queue != nullptr) {
+                release ();
+            }
+            d_queue = std::exchange (rhs.d_queue, nullptr);
+            d_index = rhs.d_index;
+            d_data = std::exchange (rhs.d_data, nullptr);
+        }
+        return *this;
+    }
+
+    explicit operator bool () const {
+        return d_queue != nullptr;
+    }
+
+    T* ptr () const {
+        return d_data;
+    }
+
+    T& operator* () const {
+        return *d_data;
+    }
+
+    T* operator-> () const {
+        return d_data;
+    }
+
+    void release () {
+        d_data = nullptr;
+        std::exchange (d_queue, nullptr)->releasePeek (d_index);
+    }
+
+    private:
+    Queue* d_queue = nullptr;
+    int64_t d_index = 0;
+    T* d_data = nullptr;
+};
+}  // namespace inplace
+
+#endif  // SLOTHANDLE_HPP
@@ -2,15 +2,19 @@
 
 #ifndef SPINLOCK_HPPdd
 #define SPINLOCK_HPPdd
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <concepts>
+#include <cstdint>
 #include <thread>
 #include <tuple>
 #include <InplaceCommon.hpp>
+#include <Tsc.hpp>
 #include <memory>
 #include <chrono>
 #include <type_traits>
+#include <vector>
 
 namespace inplace
 {
@@ -38,16 +42,15 @@ namespace inplace
         size_t d_beginSleep = DELAY_CONSUMER_MICROSECONDS;
         static constexpr std::chrono::microseconds MAX_DELAY = std::chrono::microseconds
         (maxTimeInMicroSec);
-        std::chrono::time_point<std::chrono::system_clock> d_begin = std::chrono::system_clock::now();
+        std::chrono::time_point<std::chrono::steady_clock> d_begin = std::chrono::steady_clock::now();
 
     public:
         WaitStrategy() = default;
 
         [[nodiscard]] bool wait()
         {
-            std::chrono::time_point<std::chrono::system_clock> now = std::chrono::system_clock::now();
-            auto elapsed_time = std::chrono::duration<int64_t, std::micro>(d_begin - now).count();
-            if (elapsed_time > MAX_DELAY.count())
+            const auto elapsed = std::chrono::steady_clock::now() - d_begin;
+            if (elapsed > MAX_DELAY)
             {
                 return false;
             }
@@ -68,7 +71,7 @@ namespace inplace
 
         void reset() {
             d_spinner = 0;
-            d_begin = std::chrono::system_clock::now();
+            d_begin = std::chrono::steady_clock::now();
         }
 
     private:
@@ -84,6 +87,229 @@ namespace inplace
     using WaitStrategyYield = WaitStrategy<2, 10, 10, 100, 1, 1000>;
     using WaitStrategyExponential = WaitStrategy<5, 1000, 0, 10000, 2, 1000000>;
 
+    // Tells the CPU that the caller is busy-waiting, which saves power and frees pipeline
+    // resources for a sibling hyper-thread.
+    inline void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#endif
+    }
+
+    // Spin phase of the parking wait strategies (see Parking.hpp): spins with a pause hint for
+    // SpinCount rounds, yields the CPU for YieldCount rounds, then returns false to tell the caller
+    // to park the thread instead of sleeping for a fixed interval.
+    template <size_t SpinCount, size_t YieldCount>
+    struct ParkingWaitStrategy
+    {
+    private:
+        size_t d_rounds = 0;
+
+    public:
+        ParkingWaitStrategy() = default;
+
+        [[nodiscard]] bool wait()
+        {
+            if (d_rounds < SpinCount)
+            {
+                cpuRelax();
+            }
+            else if (d_rounds < SpinCount + YieldCount)
+            {
+                std::this_thread::yield();
+            }
+            else
+            {
+                return false;
+            }
+            d_rounds++;
+            return true;
+        }
+
+        void reset() {
+            d_rounds = 0;
+        }
+    };
+
+    using ParkImmediately = ParkingWaitStrategy<0, 0>;
+    using SpinThenPark = ParkingWaitStrategy<256, 0>;
+    using SpinYieldThenPark = ParkingWaitStrategy<128, 8>;
+
+    // Backoff measured in TSC cycles rather than sleeps: spins with exponentially growing bursts
+    // of pause hints while the wait is younger than the spin budget, then calls sched_yield ()
+    // until the yield budget runs out too, and then returns false. Like ParkingWaitStrategy that
+    // means "park now" to parkUntil () (and so to the queues' enqueueWait/dequeueWait); loops that
+    // reset () on false start spinning again.
+    //
+    // The budgets adapt from how long the recent waits of the calling thread lasted (a moving
+    // average, kept per thread and per `Site`). Waits that end within MaxSpinNanos get a spin
+    // budget of twice that average; sites whose waits outlast spinning only spin briefly before
+    // yielding, and sites whose waits outlast yielding too cut the yield phase short and park.
+    // A wait ends when the strategy is reset or destroyed, so keep one object per wait. Give
+    // call sites with different wait profiles different Site tags. A wait that starts before the
+    // TSC is calibrated (see TscClock) starts the calibration in the background, times itself with
+    // steady_clock against the fixed limits and is left out of the average.
+    template <size_t MaxSpinNanos = 20000, size_t MaxYieldNanos = 200000, class Site = void>
+    class AdaptiveWaitStrategy
+    {
+        static constexpr size_t MIN_SPIN_NANOSECONDS = MaxSpinNanos / 64;
+        static constexpr uint64_t MAX_PAUSE_BURST = 64;
+        // Weight of the newest wait in the moving average, as a power of two.
+        static constexpr unsigned AVERAGE_SHIFT = 3;
+
+        struct Limits
+        {
+            uint64_t minSpin;
+            uint64_t maxSpin;
+            uint64_t maxYield;
+        };
+
+    public:
+        AdaptiveWaitStrategy() = default;
+
+        ~AdaptiveWaitStrategy()
+        {
+            finish();
+        }
+
+        AdaptiveWaitStrategy(AdaptiveWaitStrategy const&) = delete;
+
+        AdaptiveWaitStrategy& operator=(AdaptiveWaitStrategy const&) = delete;
+
+        [[nodiscard]] bool wait()
+        {
+            if (d_begin == 0)
+            {
+                start();
+            }
+            const uint64_t elapsed = now() - d_begin;
+            if (elapsed < d_spinBudget)
+            {
+                for (uint64_t i = 0; i < d_burst; i++)
+                {
+                    cpuRelax();
+                }
+                d_burst = std::min(d_burst * 2, MAX_PAUSE_BURST);
+                return true;
+            }
+            if (elapsed < d_spinBudget + d_yieldBudget)
+            {
+                std::this_thread::yield();
+                return true;
+            }
+            return false;
+        }
+
+        void reset()
+        {
+            finish();
+        }
+
+        // Moving average of the calling thread's recent waits at this Site, in TSC cycles.
+        static uint64_t recentWaitCycles()
+        {
+            TscClock::instance();
+            return history();
+        }
+
+        static uint64_t spinBudgetCycles()
+        {
+            return spinBudget(calibratedLimits());
+        }
+
+        static uint64_t yieldBudgetCycles()
+        {
+            return yieldBudget(calibratedLimits());
+        }
+
+    private:
+        static const Limits& calibratedLimits()
+        {
+            static const Limits l = [] {
+                const TscClock& clock = TscClock::instance();
+                return Limits{ std::max<uint64_t>(1, clock.fromNanoseconds(MIN_SPIN_NANOSECONDS)),
+                               std::max<uint64_t>(1, clock.fromNanoseconds(MaxSpinNanos)),
+                               clock.fromNanoseconds(MaxYieldNanos) };
+            }();
+            return l;
+        }
+
+        // Starts at half the spin limit, so a fresh thread spins for the whole budget.
+        static uint64_t& history()
+        {
+            static thread_local uint64_t average = calibratedLimits().maxSpin / 2;
+            return average;
+        }
+
+        static uint64_t spinBudget(const Limits& l)
+        {
+            const uint64_t average = history();
+            return average > l.maxSpin ? l.minSpin : std::clamp(2 * average, l.minSpin, l.maxSpin);
+        }
+
+        static uint64_t yieldBudget(const Limits& l)
+        {
+            return history() > l.maxSpin + l.maxYield ? l.maxYield / 8 : l.maxYield;
+        }
+
+        static uint64_t steadyNanoseconds()
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                             std::chrono::steady_clock::now().time_since_epoch())
+                                             .count());
+        }
+
+        uint64_t now() const
+        {
+            return d_steady ? steadyNanoseconds() : readTsc();
+        }
+
+        void start()
+        {
+            d_steady = TscClock::calibrated() == nullptr;
+            if (d_steady)
+            {
+                TscClock::calibrateInBackground();
+            }
+            d_begin = now();
+            d_burst = 1;
+            if (d_steady)
+            {
+                d_spinBudget = MaxSpinNanos;
+                d_yieldBudget = MaxYieldNanos;
+                return;
+            }
+            const Limits& l = calibratedLimits();
+            d_spinBudget = spinBudget(l);
+            d_yieldBudget = yieldBudget(l);
+        }
+
+        void finish()
+        {
+            if (d_begin == 0)
+            {
+                return;
+            }
+            if (!d_steady)
+            {
+                const uint64_t waited = readTsc() - d_begin;
+                uint64_t& average = history();
+                average = average - (average >> AVERAGE_SHIFT) + (waited >> AVERAGE_SHIFT);
+            }
+            d_begin = 0;
+        }
+
+        uint64_t d_begin = 0;
+        uint64_t d_burst = 1;
+        uint64_t d_spinBudget = 0;
+        uint64_t d_yieldBudget = 0;
+        bool d_steady = false;
+    };
+
+    using WaitStrategyAdaptive = AdaptiveWaitStrategy<>;
+
     template <SpinLockWaitStrategy Strategy = WaitStrategy1>
     class SpinLock
     {
@@ -114,6 +340,317 @@ namespace inplace
             }
         }
     };
+
+    // One round of backoff inside a wait loop that must not give up: when the strategy is out of
+    // patience it starts over (or, without reset (), the thread yields once).
+    template <SpinLockWaitStrategy Strategy>
+    void backOff(Strategy& strategy)
+    {
+        if (!strategy.wait())
+        {
+            if constexpr (requires { strategy.reset(); })
+            {
+                strategy.reset();
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Lockable spin locks for critical sections of a few dozen instructions, usable with
+    // std::lock_guard, std::unique_lock and std::scoped_lock. Waiting goes through `Strategy`;
+    // none of them parks, so they are no replacement for std::mutex around long or blocking work.
+
+    // Test-and-test-and-set: waiters spin on a plain load and only try the exchange once the lock
+    // looks free, so a held lock's line stays shared instead of bouncing between waiters. Unfair:
+    // the thread that finds the lock free takes it.
+    template <SpinLockWaitStrategy Strategy = WaitStrategyAdaptive>
+    class TTASSpinLock
+    {
+    public:
+        TTASSpinLock() = default;
+
+        TTASSpinLock(TTASSpinLock const&) = delete;
+
+        TTASSpinLock& operator=(TTASSpinLock const&) = delete;
+
+        void lock()
+        {
+            Strategy strategy;
+            while (!try_lock())
+            {
+                do
+                {
+                    backOff(strategy);
+                } while (d_locked.load(std::memory_order_relaxed));
+            }
+        }
+
+        bool try_lock()
+        {
+            return !d_locked.load(std::memory_order_relaxed) &&
+                   !d_locked.exchange(true, std::memory_order_acquire);
+        }
+
+        void unlock()
+        {
+            d_locked.store(false, std::memory_order_release);
+        }
+
+    private:
+        std::atomic<bool> d_locked = false;
+    };
+
+    // FIFO ticket lock: lock () draws a ticket and waits until it is served, so waiters get the
+    // lock in arrival order and none starves. Every waiter watches the same counter, so a handoff
+    // still invalidates one line in every waiting core; see MCSSpinLock for many cores. Like every
+    // FIFO lock it suffers when threads outnumber cores: a handoff to a preempted waiter stalls
+    // everybody queued behind it until that waiter runs again. Prefer TTASSpinLock there.
+    template <SpinLockWaitStrategy Strategy = WaitStrategyAdaptive>
+    class TicketSpinLock
+    {
+    public:
+        TicketSpinLock() = default;
+
+        TicketSpinLock(TicketSpinLock const&) = delete;
+
+        TicketSpinLock& operator=(TicketSpinLock const&) = delete;
+
+        void lock()
+        {
+            const uint32_t ticket = d_next.fetch_add(1, std::memory_order_relaxed);
+            Strategy strategy;
+            while (d_serving.load(std::memory_order_acquire) != ticket)
+            {
+                backOff(strategy);
+            }
+        }
+
+        bool try_lock()
+        {
+            uint32_t ticket = d_serving.load(std::memory_order_acquire);
+            return d_next.compare_exchange_strong(ticket, ticket + 1, std::memory_order_acquire,
+                                                  std::memory_order_relaxed);
+        }
+
+        void unlock()
+        {
+            // Only the holder writes d_serving.
+            d_serving.store(d_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+    private:
+        alignas(inplace::CACHE_LINE_SIZE) std::atomic<uint32_t> d_next = 0;
+        alignas(inplace::CACHE_LINE_SIZE) std::atomic<uint32_t> d_serving = 0;
+    };
+
+    // MCS queue lock (Mellor-Crummey & Scott): waiters form a linked queue and each spins on a
+    // flag in its own cache-line sized node, so a handoff touches only the next waiter's line and
+    // the lock keeps scaling with the number of cores. FIFO like TicketSpinLock, with the same
+    // caveat about oversubscribed cores.
+    //
+    // Lockable needs lock ()/unlock () without a node argument: nodes come from a small
+    // per-thread pool (one per MCS lock the thread holds at once) and the holder keeps its node in
+    // the lock. unlock () must run on the thread that locked.
+    template <SpinLockWaitStrategy Strategy = WaitStrategyAdaptive>
+    class MCSSpinLock
+    {
+        struct alignas(inplace::CACHE_LINE_SIZE) Node
+        {
+            std::atomic<Node*> next = nullptr;
+            std::atomic<bool> waiting = false;
+        };
+
+        class NodePool
+        {
+        public:
+            ~NodePool()
+            {
+                for (Node* node : d_free)
+                {
+                    delete node;
+                }
+            }
+
+            Node* take()
+            {
+                if (d_free.empty())
+                {
+                    return new Node;
+                }
+                Node* node = d_free.back();
+                d_free.pop_back();
+                return node;
+            }
+
+            void give(Node* node)
+            {
+                d_free.push_back(node);
+            }
+
+        private:
+            std::vector<Node*> d_free;
+        };
+
+    public:
+        MCSSpinLock() = default;
+
+        MCSSpinLock(MCSSpinLock const&) = delete;
+
+        MCSSpinLock& operator=(MCSSpinLock const&) = delete;
+
+        void lock()
+        {
+            Node* node = pool().take();
+            node->next.store(nullptr, std::memory_order_relaxed);
+            node->waiting.store(true, std::memory_order_relaxed);
+            Node* predecessor = d_tail.exchange(node, std::memory_order_acq_rel);
+            if (predecessor != nullptr)
+            {
+                predecessor->next.store(node, std::memory_order_release);
+                Strategy strategy;
+                while (node->waiting.load(std::memory_order_acquire))
+                {
+                    backOff(strategy);
+                }
+            }
+            d_holder = node;
+        }
+
+        bool try_lock()
+        {
+            Node* node = pool().take();
+            node->next.store(nullptr, std::memory_order_relaxed);
+            Node* expected = nullptr;
+            if (!d_tail.compare_exchange_strong(expected, node, std::memory_order_acq_rel,
+                                                std::memory_order_relaxed))
+            {
+                pool().give(node);
+                return false;
+            }
+            d_holder = node;
+            return true;
+        }
+
+        void unlock()
+        {
+            Node* node = d_holder;
+            Node* successor = node->next.load(std::memory_order_acquire);
+            if (successor == nullptr)
+            {
+                Node* expected = node;
+                if (d_tail.compare_exchange_strong(expected, nullptr, std::memory_order_release,
+                                                   std::memory_order_relaxed))
+                {
+                    pool().give(node);
+                    return;
+                }
+                // A waiter swapped itself in but has not linked behind us yet.
+                while ((successor = node->next.load(std::memory_order_acquire)) == nullptr)
+                {
+                    cpuRelax();
+                }
+            }
+            successor->waiting.store(false, std::memory_order_release);
+            pool().give(node);
+        }
+
+    private:
+        static NodePool& pool()
+        {
+            static thread_local NodePool nodes;
+            return nodes;
+        }
+
+        alignas(inplace::CACHE_LINE_SIZE) std::atomic<Node*> d_tail = nullptr;
+        // Written by each holder after it acquires; read by the same holder in unlock ().
+        Node* d_holder = nullptr;
+    };
+
+    // Writer-preferring reader-writer spin lock, SharedLockable (std::shared_lock) as well as
+    // Lockable. A waiting writer stops new readers from entering, so a steady stream of readers
+    // cannot starve writers; readers already inside finish first.
+    template <SpinLockWaitStrategy Strategy = WaitStrategyAdaptive>
+    class RWSpinLock
+    {
+        static constexpr uint32_t WRITER = uint32_t{ 1 } << 31;
+
+    public:
+        RWSpinLock() = default;
+
+        RWSpinLock(RWSpinLock const&) = delete;
+
+        RWSpinLock& operator=(RWSpinLock const&) = delete;
+
+        void lock()
+        {
+            d_writersWaiting.fetch_add(1, std::memory_order_relaxed);
+            Strategy strategy;
+            while (!try_lock())
+            {
+                backOff(strategy);
+            }
+            d_writersWaiting.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        bool try_lock()
+        {
+            uint32_t expected = 0;
+            return d_state.load(std::memory_order_relaxed) == 0 &&
+                   d_state.compare_exchange_strong(expected, WRITER, std::memory_order_acquire,
+                                                   std::memory_order_relaxed);
+        }
+
+        void unlock()
+        {
+            d_state.store(0, std::memory_order_release);
+        }
+
+        void lock_shared()
+        {
+            Strategy strategy;
+            while (!try_lock_shared())
+            {
+                backOff(strategy);
+            }
+        }
+
+        bool try_lock_shared()
+        {
+            if (d_writersWaiting.load(std::memory_order_relaxed) != 0)
+            {
+                return false;
+            }
+            uint32_t state = d_state.load(std::memory_order_relaxed);
+            while ((state & WRITER) == 0)
+            {
+                if (d_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire,
+                                                  std::memory_order_relaxed))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void unlock_shared()
+        {
+            d_state.fetch_sub(1, std::memory_order_release);
+        }
+
+        // Readers inside right now; for diagnostics and tests.
+        uint32_t readers() const
+        {
+            return d_state.load(std::memory_order_relaxed) & ~WRITER;
+        }
+
+    private:
+        // WRITER while a writer holds the lock, otherwise the number of readers inside.
+        alignas(inplace::CACHE_LINE_SIZE) std::atomic<uint32_t> d_state = 0;
+        std::atomic<uint32_t> d_writersWaiting = 0;
+    };
 }
 
 #endif //SPINLOCK_HPP
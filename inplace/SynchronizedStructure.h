@@ -3,7 +3,25 @@
 #ifndef SYNCHRONIZEDSTRUCTURE_H
 #define SYNCHRONIZEDSTRUCTURE_H
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <shared_mutex>
+#include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+#include <InplaceCommon.hpp>
+#include <SeqLock.hpp>
+#include <SpinLock.hpp>
 
 namespace SynchronizedStructure {
 
@@ -13,13 +31,459 @@ class Structure{
 
 };
 
-template <class Key, class Data, class Container = std::unordered_map<Key, Data>>
+// Top `bits` bits of a multiplicative mix of `hash`. The containers usually bucket by the low
+// bits of the same hash, so taking the high bits leaves those free to spread keys further.
+inline size_t highBitsOf (uint64_t hash, unsigned bits) {
+    if (bits == 0) {
+        return 0;
+    }
+    return static_cast<size_t> ((hash * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+}
+
+// Container tag for the read-optimized mode of SynchronizedStructure, see below.
+struct ReadOptimized {};
+
+// Concurrent map made of independently locked shards. A key hashes to one of shardCount ()
+// cache-line aligned shards, each holding its own `Container` (any map with find,
+// insert_or_assign and erase) behind its own reader-writer `Lock`; operations on keys in
+// different shards never touch the same lock. Lookups take the shard lock shared, updates take
+// it exclusively.
+//
+// Callbacks run under the shard lock: keep them short, and never call back into the structure
+// from them (the locks are not recursive).
+template <class Key, class Data, class Container = std::unordered_map<Key, Data>,
+          class Lock = inplace::RWSpinLock<>, class Hash = std::hash<Key>>
 class SynchronizedStructure {
-    Container d_container;
+    struct alignas (inplace::CACHE_LINE_SIZE) Shard {
+        mutable Lock lock;
+        Container container;
+    };
+
     public:
+    static constexpr size_t DefaultShardCount = 64;
+
+    // `shards` is rounded up to a power of two.
+    explicit SynchronizedStructure (size_t shards = DefaultShardCount, Hash hash = Hash ())
+        : d_shardBits (std::bit_width (std::bit_ceil (std::max<size_t> (1, shards))) - 1),
+          d_shards (std::make_unique<Shard[]> (size_t{ 1 } << d_shardBits)),
+          d_hash (std::move (hash)) {
+    }
+
+    SynchronizedStructure (SynchronizedStructure const&) = delete;
+
+    SynchronizedStructure& operator= (SynchronizedStructure const&) = delete;
+
+    // Copy of the value stored under `key`, if any.
+    std::optional<Data> find (const Key& key) const {
+        const Shard& shard = shardOf (key);
+        std::shared_lock lock (shard.lock);
+        auto it = shard.container.find (key);
+        if (it == shard.container.end ()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    bool contains (const Key& key) const {
+        const Shard& shard = shardOf (key);
+        std::shared_lock lock (shard.lock);
+        return shard.container.find (key) != shard.container.end ();
+    }
+
+    // True if `key` was inserted, false if an existing value was replaced.
+    template <class V>
+    bool insert_or_assign (const Key& key, V&& value) {
+        Shard& shard = shardOf (key);
+        std::lock_guard lock (shard.lock);
+        return shard.container.insert_or_assign (key, std::forward<V> (value)).second;
+    }
+
+    bool erase (const Key& key) {
+        Shard& shard = shardOf (key);
+        std::lock_guard lock (shard.lock);
+        return shard.container.erase (key) != 0;
+    }
+
+    // Calls `fn (Data&)` on the value under `key` with its shard locked exclusively, for in-place
+    // updates. Returns false, without calling `fn`, if the key is absent.
+    template <std::invocable<Data&> F>
+    bool visit (const Key& key, F&& fn) {
+        Shard& shard = shardOf (key);
+        std::lock_guard lock (shard.lock);
+        auto it = shard.container.find (key);
+        if (it == shard.container.end ()) {
+            return false;
+        }
+        std::invoke (std::forward<F> (fn), it->second);
+        return true;
+    }
+
+    // Read-only visit under a shared lock.
+    template <std::invocable<const Data&> F>
+    bool visit (const Key& key, F&& fn) const {
+        const Shard& shard = shardOf (key);
+        std::shared_lock lock (shard.lock);
+        auto it = shard.container.find (key);
+        if (it == shard.container.end ()) {
+            return false;
+        }
+        std::invoke (std::forward<F> (fn), std::as_const (it->second));
+        return true;
+    }
+
+    // Calls `fn (const Key&, Data&)` on every element, one shard at a time with that shard locked
+    // exclusively. Not a snapshot: other shards change meanwhile.
+    template <std::invocable<const Key&, Data&> F>
+    void for_each (F&& fn) {
+        for (size_t i = 0; i < shardCount (); i++) {
+            Shard& shard = d_shards[i];
+            std::lock_guard lock (shard.lock);
+            for (auto& [key, value] : shard.container) {
+                std::invoke (fn, key, value);
+            }
+        }
+    }
+
+    template <std::invocable<const Key&, const Data&> F>
+    void for_each (F&& fn) const {
+        for (size_t i = 0; i < shardCount (); i++) {
+            const Shard& shard = d_shards[i];
+            std::shared_lock lock (shard.lock);
+            for (const auto& [key, value] : shard.container) {
+                std::invoke (fn, key, value);
+            }
+        }
+    }
+
+    // insert_or_assign ()s every (key, value) pair of `range`, taking each shard's lock once for
+    // all of its keys. Pairs are applied in range order within a shard, so of duplicate keys the
+    // last one wins. Returns the number of keys that were newly inserted.
+    template <std::ranges::input_range Range>
+    size_t insert_many (Range&& range) {
+        using Reference = std::ranges::range_reference_t<Range>;
+        if constexpr (!std::is_lvalue_reference_v<Reference>) {
+            // Generated elements: keep them alive while they are grouped.
+            std::vector<std::ranges::range_value_t<Range>> owned;
+            for (auto&& element : range) {
+                owned.push_back (std::forward<decltype (element)> (element));
+            }
+            return insert_many (owned);
+        } else {
+            std::vector<std::pair<size_t, std::remove_reference_t<Reference>*>> pending;
+            if constexpr (std::ranges::sized_range<Range>) {
+                pending.reserve (std::ranges::size (range));
+            }
+            for (auto& element : range) {
+                pending.emplace_back (shardIndex (std::get<0> (element)), std::addressof (element));
+            }
+            std::stable_sort (pending.begin (), pending.end (),
+                              [] (const auto& a, const auto& b) { return a.first < b.first; });
+            size_t inserted = 0;
+            for (auto run = pending.begin (); run != pending.end ();) {
+                const size_t index = run->first;
+                Shard& shard = d_shards[index];
+                std::lock_guard lock (shard.lock);
+                for (; run != pending.end () && run->first == index; ++run) {
+                    const auto& [key, value] = *run->second;
+                    inserted += shard.container.insert_or_assign (key, value).second;
+                }
+            }
+            return inserted;
+        }
+    }
+
+    // Sum over the shards, each read under its lock; only exact while nobody writes.
+    size_t size () const {
+        size_t total = 0;
+        for (size_t i = 0; i < shardCount (); i++) {
+            std::shared_lock lock (d_shards[i].lock);
+            total += d_shards[i].container.size ();
+        }
+        return total;
+    }
+
+    bool empty () const {
+        return size () == 0;
+    }
+
+    void clear () {
+        for (size_t i = 0; i < shardCount (); i++) {
+            std::lock_guard lock (d_shards[i].lock);
+            d_shards[i].container.clear ();
+        }
+    }
+
+    size_t shardCount () const {
+        return size_t{ 1 } << d_shardBits;
+    }
+
+    // Shard that holds `key`; keys with equal hashes share one.
+    size_t shardIndex (const Key& key) const {
+        return highBitsOf (static_cast<uint64_t> (d_hash (key)), d_shardBits);
+    }
+
+    private:
+    Shard& shardOf (const Key& key) {
+        return d_shards[shardIndex (key)];
+    }
+
+    const Shard& shardOf (const Key& key) const {
+        return d_shards[shardIndex (key)];
+    }
+
+    unsigned d_shardBits;
+    std::unique_ptr<Shard[]> d_shards;
+    [[no_unique_address]] Hash d_hash;
 };
 
 
+// Read-optimized mode, for tables read on every message and written rarely (risk limits, symbol
+// metadata, fee tables): SynchronizedStructure<Key, Data, ReadOptimized>. Entries live in a fixed
+// open-addressed table, each slot a cache-line sized SeqLock holding key, value and state, so
+// lookups take no lock and write nothing: a lookup probes slots with SeqLock reads and only
+// retries a slot that is being written at that moment. Writers serialize on one `Lock`, taken
+// exclusively.
+//
+// Key and Data must be trivially copyable. The table holds at most `capacity` keys; inserting
+// beyond that throws std::length_error. Erasing the last entry of a probe chain empties its slot
+// and the tombstones right before it, so the chain ends where it did before those keys went in;
+// an erase from the middle of a chain leaves a tombstone for a later insert to reuse.
+template <class Key, class Data, class Lock, class Hash>
+class SynchronizedStructure<Key, Data, ReadOptimized, Lock, Hash> {
+    static_assert (std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Data>,
+                   "the read-optimized mode copies keys and values through SeqLocks");
+
+    enum class State : uint8_t { Empty, Used, Erased };
+
+    struct Entry {
+        Key key{};
+        Data data{};
+        State state = State::Empty;
+    };
+
+    using Slot = inplace::SeqLock<Entry>;
+
+    public:
+    static constexpr size_t DefaultCapacity = 1024;
+
+    // Slots for twice `capacity` keys, rounded up to a power of two, keep probe chains short.
+    explicit SynchronizedStructure (size_t capacity = DefaultCapacity, Hash hash = Hash ())
+        : d_capacity (std::max<size_t> (1, capacity)),
+          d_slotBits (std::bit_width (std::bit_ceil (2 * d_capacity)) - 1),
+          d_slots (std::make_unique<Slot[]> (size_t{ 1 } << d_slotBits)),
+          d_hash (std::move (hash)) {
+    }
+
+    SynchronizedStructure (SynchronizedStructure const&) = delete;
+
+    SynchronizedStructure& operator= (SynchronizedStructure const&) = delete;
+
+    std::optional<Data> find (const Key& key) const {
+        std::optional<Data> found;
+        probe (key, [&] (const Entry& entry) { found = entry.data; });
+        return found;
+    }
+
+    bool contains (const Key& key) const {
+        return probe (key, [] (const Entry&) {});
+    }
+
+    template <class V>
+    bool insert_or_assign (const Key& key, V&& value) {
+        std::lock_guard lock (d_lock);
+        return assign (key, Data (std::forward<V> (value)));
+    }
+
+    bool erase (const Key& key) {
+        std::lock_guard lock (d_lock);
+        Slot* slot = locate (key);
+        if (slot == nullptr) {
+            return false;
+        }
+        const size_t mask = slotCount () - 1;
+        size_t index = static_cast<size_t> (slot - d_slots.get ());
+        if (d_slots[(index + 1) & mask].peek ().state != State::Empty) {
+            slot->update ([] (Entry& entry) { entry.state = State::Erased; });
+            d_tombstones.fetch_add (1, std::memory_order_relaxed);
+        } else {
+            // No chain runs past this slot, nor past the tombstones that lead up to it.
+            slot->store (Entry{});
+            for (size_t i = 1; i < slotCount (); i++) {
+                index = (index - 1) & mask;
+                if (d_slots[index].peek ().state != State::Erased) {
+                    break;
+                }
+                d_slots[index].store (Entry{});
+                d_tombstones.fetch_sub (1, std::memory_order_relaxed);
+            }
+        }
+        d_size.fetch_sub (1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Calls `fn (Data&)` on a copy of the value and publishes the result, under the writer lock.
+    template <std::invocable<Data&> F>
+    bool visit (const Key& key, F&& fn) {
+        std::lock_guard lock (d_lock);
+        Slot* slot = locate (key);
+        if (slot == nullptr) {
+            return false;
+        }
+        slot->update ([&] (Entry& entry) { std::invoke (fn, entry.data); });
+        return true;
+    }
+
+    // Calls `fn (const Data&)` on a consistent copy of the value, without locking.
+    template <std::invocable<const Data&> F>
+    bool visit (const Key& key, F&& fn) const {
+        return probe (key, [&] (const Entry& entry) { std::invoke (fn, entry.data); });
+    }
+
+    template <std::invocable<const Key&, Data&> F>
+    void for_each (F&& fn) {
+        std::lock_guard lock (d_lock);
+        for (size_t i = 0; i < slotCount (); i++) {
+            if (d_slots[i].peek ().state == State::Used) {
+                d_slots[i].update ([&] (Entry& entry) {
+                    std::invoke (fn, std::as_const (entry.key), entry.data);
+                });
+            }
+        }
+    }
+
+    // Lock-free; every entry is a consistent copy, but the whole is not a snapshot.
+    template <std::invocable<const Key&, const Data&> F>
+    void for_each (F&& fn) const {
+        for (size_t i = 0; i < slotCount (); i++) {
+            const Entry entry = d_slots[i].load ();
+            if (entry.state == State::Used) {
+                std::invoke (fn, entry.key, entry.data);
+            }
+        }
+    }
+
+    // One writer lock acquisition for the whole range; returns the number of new keys.
+    template <std::ranges::input_range Range>
+    size_t insert_many (Range&& range) {
+        std::lock_guard lock (d_lock);
+        size_t inserted = 0;
+        for (auto&& element : range) {
+            const auto& [key, value] = element;
+            inserted += assign (key, Data (value));
+        }
+        return inserted;
+    }
+
+    size_t size () const {
+        return d_size.load (std::memory_order_relaxed);
+    }
+
+    bool empty () const {
+        return size () == 0;
+    }
+
+    // Erased slots still on some probe chain; lookups step over them.
+    size_t tombstones () const {
+        return d_tombstones.load (std::memory_order_relaxed);
+    }
+
+    void clear () {
+        std::lock_guard lock (d_lock);
+        for (size_t i = 0; i < slotCount (); i++) {
+            if (d_slots[i].peek ().state != State::Empty) {
+                d_slots[i].store (Entry{});
+            }
+        }
+        d_size.store (0, std::memory_order_relaxed);
+        d_tombstones.store (0, std::memory_order_relaxed);
+    }
+
+    // Most keys the table takes.
+    size_t capacity () const {
+        return d_capacity;
+    }
+
+    private:
+    size_t slotCount () const {
+        return size_t{ 1 } << d_slotBits;
+    }
+
+    size_t home (const Key& key) const {
+        return highBitsOf (static_cast<uint64_t> (d_hash (key)), d_slotBits);
+    }
+
+    // Reader side: calls `fn` with the entry of `key` if it is present.
+    template <class F>
+    bool probe (const Key& key, F&& fn) const {
+        const size_t mask = slotCount () - 1;
+        for (size_t i = 0, slot = home (key); i < slotCount (); i++, slot = (slot + 1) & mask) {
+            const Entry entry = d_slots[slot].load ();
+            if (entry.state == State::Empty) {
+                return false;
+            }
+            if (entry.state == State::Used && entry.key == key) {
+                fn (entry);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Writer side, under d_lock: the slot holding `key`, or nullptr.
+    Slot* locate (const Key& key) {
+        const size_t mask = slotCount () - 1;
+        for (size_t i = 0, slot = home (key); i < slotCount (); i++, slot = (slot + 1) & mask) {
+            const Entry entry = d_slots[slot].peek ();
+            if (entry.state == State::Empty) {
+                return nullptr;
+            }
+            if (entry.state == State::Used && entry.key == key) {
+                return &d_slots[slot];
+            }
+        }
+        return nullptr;
+    }
+
+    // Under d_lock. Reuses the first tombstone on the probe chain once the key is known to be
+    // absent further along it.
+    bool assign (const Key& key, Data&& data) {
+        const size_t mask = slotCount () - 1;
+        Slot* free = nullptr;
+        bool reusesTombstone = false;
+        for (size_t i = 0, slot = home (key); i < slotCount (); i++, slot = (slot + 1) & mask) {
+            const Entry entry = d_slots[slot].peek ();
+            if (entry.state == State::Used && entry.key == key) {
+                d_slots[slot].store (Entry{ key, std::move (data), State::Used });
+                return false;
+            }
+            if (entry.state != State::Used && free == nullptr) {
+                free = &d_slots[slot];
+                reusesTombstone = entry.state == State::Erased;
+            }
+            if (entry.state == State::Empty) {
+                break;
+            }
+        }
+        if (free == nullptr || size () == d_capacity) {
+            throw std::length_error ("SynchronizedStructure<ReadOptimized> is full");
+        }
+        free->store (Entry{ key, std::move (data), State::Used });
+        d_size.fetch_add (1, std::memory_order_relaxed);
+        if (reusesTombstone) {
+            d_tombstones.fetch_sub (1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    const size_t d_capacity;
+    const unsigned d_slotBits;
+    std::unique_ptr<Slot[]> d_slots;
+    [[no_unique_address]] Hash d_hash;
+    std::atomic<size_t> d_size = 0;
+    std::atomic<size_t> d_tombstones = 0;
+    Lock d_lock;
+};
+
 }
 
 #endif //SYNCHRONIZEDSTRUCTURE_H
@@ -0,0 +1,392 @@
+#ifndef TRACING_HPP
+#define TRACING_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ios>
+#include <InplaceCommon.hpp>
+#include <Tsc.hpp>
+
+// Binary event tracing. Each thread records fixed-size events into its own ring; a flusher drains
+// the rings on demand (or periodically) into Chrome/Perfetto JSON.
+//
+// Instrument code with the INPLACE_TRACE_* macros below. Unless INPLACE_TRACING is defined they
+// expand to nothing and their arguments are not evaluated.
+//
+//   INPLACE_TRACE_INSTANT ("queue.full", index);
+//   INPLACE_TRACE_SCOPE ("worker.task");
+//   INPLACE_TRACE_COUNTER ("queue.size", size);
+
+namespace inplace {
+
+enum class TracePhase : uint8_t { Instant, Begin, End, Counter };
+
+struct TraceEvent {
+    uint64_t tsc = 0;
+    // Must point to a string with static storage duration (a literal); doubles as the event id.
+    const char* name = nullptr;
+    uint64_t arg0 = 0;
+    uint32_t arg1 = 0;
+    TracePhase phase = TracePhase::Instant;
+};
+
+static_assert (sizeof (TraceEvent) == 32, "TraceEvent is meant to fill half a cache line");
+
+// Single-producer ring owned by one thread. The owner never blocks: when the flusher falls
+// behind, new events are dropped and counted rather than overwriting unread ones.
+class TraceBuffer {
+    public:
+    static constexpr size_t Capacity = 1 << 14;
+
+    explicit TraceBuffer (uint32_t threadId) : d_threadId (threadId) {
+    }
+
+    void record (const TraceEvent& event) {
+        const uint64_t head = d_head.load (std::memory_order_relaxed);
+        if (head - d_cachedTail >= Capacity) {
+            d_cachedTail = d_tail.load (std::memory_order_acquire);
+            if (head - d_cachedTail >= Capacity) {
+                d_dropped.fetch_add (1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        d_events[head % Capacity] = event;
+        d_head.store (head + 1, std::memory_order_release);
+    }
+
+    // Consumer side; callers serialise through TraceRegistry.
+    template <class Sink>
+    size_t drain (Sink&& sink) {
+        const uint64_t tail = d_tail.load (std::memory_order_relaxed);
+        const uint64_t head = d_head.load (std::memory_order_acquire);
+        for (uint64_t i = tail; i < head; i++) {
+            sink (d_threadId, d_events[i % Capacity]);
+        }
+        d_tail.store (head, std::memory_order_release);
+        return static_cast<size_t> (head - tail);
+    }
+
+    uint32_t threadId () const {
+        return d_threadId;
+    }
+
+    uint64_t dropped () const {
+        return d_dropped.load (std::memory_order_relaxed);
+    }
+
+    void setName (std::string name) {
+        std::lock_guard lock (d_nameMutex);
+        d_name = std::move (name);
+    }
+
+    std::string name () const {
+        std::lock_guard lock (d_nameMutex);
+        return d_name;
+    }
+
+    private:
+    alignas (inplace::CACHE_LINE_SIZE) std::atomic<uint64_t> d_head = 0;
+    uint64_t d_cachedTail = 0;
+    alignas (inplace::CACHE_LINE_SIZE) std::atomic<uint64_t> d_tail = 0;
+    std::atomic<uint64_t> d_dropped = 0;
+    uint32_t d_threadId;
+    mutable std::mutex d_nameMutex;
+    std::string d_name;
+    std::array<TraceEvent, Capacity> d_events;
+};
+
+// Owns every thread's buffer. A thread's buffer is retired when the thread exits and freed once
+// a drain has emptied it, so late flushes still see everything the thread recorded.
+class TraceRegistry {
+    public:
+    static TraceRegistry& instance () {
+        static TraceRegistry registry;
+        return registry;
+    }
+
+    TraceBuffer& local () {
+        thread_local BufferOwner owner (registerThread ());
+        return owner.buffer ();
+    }
+
+    // Hands every pending event, oldest first per thread, to `sink (threadId, event)`.
+    template <class Sink>
+    size_t drain (Sink&& sink) {
+        return drain (sink, [] (const TraceBuffer&) {});
+    }
+
+    // As above, and passes the buffer of every exited thread to `retired (buffer)` once it is
+    // empty, just before freeing it.
+    template <class Sink, class Retired>
+    size_t drain (Sink&& sink, Retired&& retired) {
+        std::lock_guard lock (d_mutex);
+        size_t count = 0;
+        for (auto it = d_buffers.begin (); it != d_buffers.end ();) {
+            // Read before draining: once retired, the owner has recorded its last event.
+            const bool isRetired = (*it)->retired.load (std::memory_order_acquire);
+            count += (*it)->buffer.drain (sink);
+            if (isRetired) {
+                retired ((*it)->buffer);
+                it = d_buffers.erase (it);
+            } else {
+                ++it;
+            }
+        }
+        return count;
+    }
+
+    template <class Visitor>
+    void forEachBuffer (Visitor&& visitor) {
+        std::lock_guard lock (d_mutex);
+        for (auto& buffer : d_buffers) {
+            visitor (buffer->buffer);
+        }
+    }
+
+    // Buffers currently held: one per live recording thread, plus those of exited threads that
+    // have not been drained yet.
+    size_t bufferCount () {
+        std::lock_guard lock (d_mutex);
+        return d_buffers.size ();
+    }
+
+    private:
+    struct ThreadBuffer {
+        explicit ThreadBuffer (uint32_t threadId) : buffer (threadId) {
+        }
+
+        TraceBuffer buffer;
+        // Set by the owning thread on exit, after its last event.
+        std::atomic_bool retired = false;
+    };
+
+    // Lives in thread-local storage and retires the thread's buffer when the thread exits. Shares
+    // the buffer with d_buffers, so a thread outliving the registry does not touch freed memory.
+    class BufferOwner {
+        public:
+        explicit BufferOwner (std::shared_ptr<ThreadBuffer> buffer) : d_buffer (std::move (buffer)) {
+        }
+
+        ~BufferOwner () {
+            d_buffer->retired.store (true, std::memory_order_release);
+        }
+
+        BufferOwner (BufferOwner const&) = delete;
+
+        BufferOwner& operator= (BufferOwner const&) = delete;
+
+        TraceBuffer& buffer () {
+            return d_buffer->buffer;
+        }
+
+        private:
+        std::shared_ptr<ThreadBuffer> d_buffer;
+    };
+
+    // Calibrates the TSC up front so that every recorded timestamp lies after its origin.
+    TraceRegistry () {
+        TscClock::instance ();
+    }
+
+    std::shared_ptr<ThreadBuffer> registerThread () {
+        std::lock_guard lock (d_mutex);
+        d_buffers.push_back (std::make_shared<ThreadBuffer> (d_nextThreadId++));
+        return d_buffers.back ();
+    }
+
+    std::mutex d_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> d_buffers;
+    uint32_t d_nextThreadId = 0;
+};
+
+inline void traceRecord (TracePhase phase, const char* name, uint64_t arg0 = 0,
+                         uint32_t arg1 = 0) {
+    auto& buffer = TraceRegistry::instance ().local ();
+    buffer.record (TraceEvent{ readTsc (), name, arg0, arg1, phase });
+}
+
+// Names the calling thread in exported traces.
+inline void setTraceThreadName (std::string name) {
+    TraceRegistry::instance ().local ().setName (std::move (name));
+}
+
+// Begin/End pair around a C++ scope.
+class TraceScope {
+    public:
+    explicit TraceScope (const char* name) : d_name (name) {
+        traceRecord (TracePhase::Begin, d_name);
+    }
+
+    ~TraceScope () {
+        traceRecord (TracePhase::End, d_name);
+    }
+
+    TraceScope (TraceScope const&) = delete;
+
+    TraceScope& operator= (TraceScope const&) = delete;
+
+    private:
+    const char* d_name;
+};
+
+// Streams drained events as a Chrome trace ("Trace Event Format", also read by Perfetto).
+// flush () may be called any number of times; the JSON document is closed on destruction.
+class ChromeTraceWriter {
+    public:
+    explicit ChromeTraceWriter (std::ostream& os) : d_os (os) {
+        d_os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    }
+
+    ~ChromeTraceWriter () {
+        flush ();
+        writeThreadNames ();
+        d_os << "\n]}\n";
+        d_os.flush ();
+    }
+
+    ChromeTraceWriter (ChromeTraceWriter const&) = delete;
+
+    ChromeTraceWriter& operator= (ChromeTraceWriter const&) = delete;
+
+    // Drains every thread's buffer into the stream. Returns the number of events written.
+    size_t flush () {
+        std::lock_guard lock (d_mutex);
+        const auto& clock = TscClock::instance ();
+        // Chrome timestamps are microseconds; keep the nanosecond fraction.
+        const auto flags = d_os.setf (std::ios::fixed, std::ios::floatfield);
+        const auto precision = d_os.precision (3);
+        auto write = [this, &clock] (uint32_t tid, const TraceEvent& e) {
+            const double ts = clock.sinceOrigin (e.tsc) / 1000.0;
+            separator ();
+            d_os << "{\"name\":\"" << e.name << "\",\"ph\":\"" << phaseCode (e.phase)
+                 << "\",\"ts\":" << ts << ",\"pid\":1,\"tid\":" << tid;
+            if (e.phase == TracePhase::Instant) {
+                d_os << ",\"s\":\"t\"";
+            }
+            if (e.phase == TracePhase::Counter) {
+                d_os << ",\"args\":{\"value\":" << e.arg0 << "}}";
+            } else {
+                d_os << ",\"args\":{\"a0\":" << e.arg0 << ",\"a1\":" << e.arg1 << "}}";
+            }
+        };
+        // An exited thread's buffer is freed once drained, so name its thread now.
+        auto writeName = [this] (const TraceBuffer& buffer) { writeThreadName (buffer); };
+        const size_t count = TraceRegistry::instance ().drain (write, writeName);
+        d_os.flags (flags);
+        d_os.precision (precision);
+        return count;
+    }
+
+    private:
+    static char phaseCode (TracePhase phase) {
+        switch (phase) {
+            case TracePhase::Begin:
+                return 'B';
+            case TracePhase::End:
+                return 'E';
+            case TracePhase::Counter:
+                return 'C';
+            case TracePhase::Instant:
+            default:
+                return 'i';
+        }
+    }
+
+    void separator () {
+        d_os << (d_first ? "\n" : ",\n");
+        d_first = false;
+    }
+
+    void writeThreadNames () {
+        TraceRegistry::instance ().forEachBuffer ([this] (const TraceBuffer& buffer) {
+            writeThreadName (buffer);
+        });
+    }
+
+    void writeThreadName (const TraceBuffer& buffer) {
+        const auto name = buffer.name ();
+        separator ();
+        d_os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+             << buffer.threadId () << ",\"args\":{\"name\":\""
+             << (name.empty () ? "thread" : name) << "\",\"dropped\":" << buffer.dropped ()
+             << "}}";
+    }
+
+    std::ostream& d_os;
+    std::mutex d_mutex;
+    bool d_first = true;
+};
+
+// Flushes a ChromeTraceWriter every `period` on its own thread until destroyed.
+class BackgroundTraceFlusher {
+    public:
+    BackgroundTraceFlusher (ChromeTraceWriter& writer, std::chrono::milliseconds period)
+        : d_writer (writer), d_period (period), d_thread ([this] { run (); }) {
+    }
+
+    ~BackgroundTraceFlusher () {
+        {
+            std::lock_guard lock (d_mutex);
+            d_stop = true;
+        }
+        d_wakeup.notify_one ();
+        d_thread.join ();
+        d_writer.flush ();
+    }
+
+    BackgroundTraceFlusher (BackgroundTraceFlusher const&) = delete;
+
+    BackgroundTraceFlusher& operator= (BackgroundTraceFlusher const&) = delete;
+
+    private:
+    void run () {
+        std::unique_lock lock (d_mutex);
+        while (!d_wakeup.wait_for (lock, d_period, [this] { return d_stop; })) {
+            lock.unlock ();
+            d_writer.flush ();
+            lock.lock ();
+        }
+    }
+
+    ChromeTraceWriter& d_writer;
+    std::chrono::milliseconds d_period;
+    std::mutex d_mutex;
+    std::condition_variable d_wakeup;
+    bool d_stop = false;
+    std::thread d_thread;
+};
+}  // namespace inplace
+
+#define INPLACE_TRACE_CONCAT_IMPL(a, b) a##b
+#define INPLACE_TRACE_CONCAT(a, b) INPLACE_TRACE_CONCAT_IMPL (a, b)
+
+#if defined(INPLACE_TRACING)
+#define INPLACE_TRACE_INSTANT(name, ...) \
+    ::inplace::traceRecord (::inplace::TracePhase::Instant, name __VA_OPT__ (, ) __VA_ARGS__)
+#define INPLACE_TRACE_BEGIN(name, ...) \
+    ::inplace::traceRecord (::inplace::TracePhase::Begin, name __VA_OPT__ (, ) __VA_ARGS__)
+#define INPLACE_TRACE_END(name, ...) \
+    ::inplace::traceRecord (::inplace::TracePhase::End, name __VA_OPT__ (, ) __VA_ARGS__)
+#define INPLACE_TRACE_COUNTER(name, value) \
+    ::inplace::traceRecord (::inplace::TracePhase::Counter, name, value)
+#define INPLACE_TRACE_SCOPE(name) \
+    ::inplace::TraceScope INPLACE_TRACE_CONCAT (inplaceTraceScope, __LINE__) (name)
+#else
+#define INPLACE_TRACE_INSTANT(name, ...) static_cast<void> (0)
+#define INPLACE_TRACE_BEGIN(name, ...) static_cast<void> (0)
+#define INPLACE_TRACE_END(name, ...) static_cast<void> (0)
+#define INPLACE_TRACE_COUNTER(name, value) static_cast<void> (0)
+#define INPLACE_TRACE_SCOPE(name) static_cast<void> (0)
+#endif
+
+#endif  // TRACING_HPP
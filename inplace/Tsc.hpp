@@ -0,0 +1,114 @@
+#ifndef TSC_HPP
+#define TSC_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <system_error>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace inplace {
+
+// Raw timestamp counter: rdtsc on x86, the virtual counter on AArch64, steady_clock elsewhere.
+// Cheap enough for hot paths; convert to time with TscClock.
+inline uint64_t readTsc () {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc ();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile ("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<uint64_t> (std::chrono::duration_cast<std::chrono::nanoseconds> (
+                                      std::chrono::steady_clock::now ().time_since_epoch ())
+                                      .count ());
+#endif
+}
+
+// Converts timestamp counter ticks to nanoseconds. The rate is measured once, by reading both
+// the counter and steady_clock before and after sleeping for `CalibrationPeriod`; assumes an
+// invariant TSC. That happens on the first instance (), or on a background thread started by
+// calibrateInBackground ().
+class TscClock {
+    public:
+    static constexpr std::chrono::milliseconds CalibrationPeriod{ 20 };
+
+    // Calibrates on the first call, which blocks for CalibrationPeriod.
+    static const TscClock& instance () {
+        static const TscClock clock;
+        return clock;
+    }
+
+    // The clock once calibration has finished, nullptr before. Never blocks, so wait loops can
+    // fall back to steady_clock rather than calibrate on a lock path.
+    static const TscClock* calibrated () {
+        return published ().load (std::memory_order_acquire);
+    }
+
+    // Starts calibrating on a detached thread, once per process, and returns without waiting.
+    // If no thread can be started, a later call tries again.
+    static void calibrateInBackground () {
+        static std::atomic_bool started = false;
+        if (calibrated () != nullptr || started.load (std::memory_order_relaxed) ||
+            started.exchange (true, std::memory_order_relaxed)) {
+            return;
+        }
+        try {
+            std::thread ([] { instance (); }).detach ();
+        } catch (const std::system_error&) {
+            started.store (false, std::memory_order_relaxed);
+        }
+    }
+
+    double ticksPerNanosecond () const {
+        return d_ticksPerNanosecond;
+    }
+
+    // Counter value taken at calibration time, a convenient origin for relative timestamps.
+    uint64_t originTicks () const {
+        return d_originTicks;
+    }
+
+    double toNanoseconds (uint64_t ticks) const {
+        return static_cast<double> (ticks) / d_ticksPerNanosecond;
+    }
+
+    uint64_t fromNanoseconds (double nanoseconds) const {
+        return static_cast<uint64_t> (nanoseconds * d_ticksPerNanosecond);
+    }
+
+    // Nanoseconds from the calibration origin to `ticks`.
+    double sinceOrigin (uint64_t ticks) const {
+        return toNanoseconds (ticks - d_originTicks);
+    }
+
+    private:
+    TscClock () {
+        using Clock = std::chrono::steady_clock;
+        const auto wallBegin = Clock::now ();
+        const uint64_t ticksBegin = readTsc ();
+        std::this_thread::sleep_for (CalibrationPeriod);
+        const auto wallEnd = Clock::now ();
+        const uint64_t ticksEnd = readTsc ();
+        const double elapsed =
+            std::chrono::duration<double, std::nano> (wallEnd - wallBegin).count ();
+        d_ticksPerNanosecond = static_cast<double> (ticksEnd - ticksBegin) / elapsed;
+        d_originTicks = ticksBegin;
+        published ().store (this, std::memory_order_release);
+    }
+
+    static std::atomic<const TscClock*>& published () {
+        static std::atomic<const TscClock*> clock = nullptr;
+        return clock;
+    }
+
+    double d_ticksPerNanosecond = 1.0;
+    uint64_t d_originTicks = 0;
+};
+}  // namespace inplace
+
+#endif  // TSC_HPP
@@ -0,0 +1,170 @@
+#ifndef WORKSTEALINGDEQUE_HPP
+#define WORKSTEALINGDEQUE_HPP
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+#include <InplaceCommon.hpp>
+#include <SPSCQueue.hpp>
+#include <Tracing.hpp>
+
+namespace inplace {
+
+template <class T>
+concept WorkStealingType = std::is_trivially_copyable_v<T> && !std::is_const_v<T>;
+
+// Chase-Lev work-stealing deque (in the formulation of Lê et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models"). The owning thread push ()es and pop ()s at the bottom,
+// LIFO; any other thread steal ()s from the top, FIFO.
+//
+// The ring starts with `InitialCapacity` slots and doubles when the owner finds it full, up to
+// `MaxCapacity`; past that push () fails and the caller should run the item itself. Replaced rings
+// are kept until the deque is destroyed because a thief may still be reading from them.
+//
+// Items are copied by thieves before they know whether they won the item, hence T must be
+// trivially copyable: typically a pointer or a small task descriptor.
+template <WorkStealingType T, int64_t InitialCapacity = 256, int64_t MaxCapacity = 1 << 20>
+class WorkStealingDeque {
+    static_assert (std::has_single_bit (static_cast<uint64_t> (InitialCapacity)) &&
+                       std::has_single_bit (static_cast<uint64_t> (MaxCapacity)),
+                   "capacities must be powers of two");
+    static_assert (InitialCapacity <= MaxCapacity);
+
+    class Ring {
+        public:
+        explicit Ring (int64_t capacity)
+            : d_mask (capacity - 1), d_slots (std::make_unique<std::atomic<T>[]> (capacity)) {
+        }
+
+        int64_t capacity () const {
+            return d_mask + 1;
+        }
+
+        void put (int64_t index, const T& value) {
+            d_slots[index & d_mask].store (value, std::memory_order_relaxed);
+        }
+
+        T get (int64_t index) const {
+            return d_slots[index & d_mask].load (std::memory_order_relaxed);
+        }
+
+        private:
+        int64_t d_mask;
+        std::unique_ptr<std::atomic<T>[]> d_slots;
+    };
+
+    public:
+    WorkStealingDeque () {
+        d_rings.push_back (std::make_unique<Ring> (InitialCapacity));
+        d_ring.store (d_rings.back ().get (), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque (WorkStealingDeque const&) = delete;
+
+    WorkStealingDeque& operator= (WorkStealingDeque const&) = delete;
+
+    // Owner only. Returns false when the deque holds MaxCapacity items.
+    bool push (const T& value) {
+        const int64_t bottom = d_bottom.index.load (std::memory_order_relaxed);
+        const int64_t top = d_top.index.load (std::memory_order_acquire);
+        Ring* ring = d_ring.load (std::memory_order_relaxed);
+        if (bottom - top >= ring->capacity ()) {
+            if (ring->capacity () == MaxCapacity) {
+                INPLACE_TRACE_INSTANT ("wsdeque.full", bottom - top);
+                return false;
+            }
+            ring = grow (ring, top, bottom);
+        }
+        ring->put (bottom, value);
+        std::atomic_thread_fence (std::memory_order_release);
+        d_bottom.index.store (bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner only. Takes the most recently pushed item.
+    std::optional<T> pop () {
+        const int64_t bottom = d_bottom.index.load (std::memory_order_relaxed) - 1;
+        Ring* ring = d_ring.load (std::memory_order_relaxed);
+        d_bottom.index.store (bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        int64_t top = d_top.index.load (std::memory_order_relaxed);
+        if (top > bottom) {
+            d_bottom.index.store (bottom + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        std::optional<T> value = ring->get (bottom);
+        if (top == bottom) {
+            // Last item: race the thieves for it through top.
+            if (!d_top.index.compare_exchange_strong (top, top + 1, std::memory_order_seq_cst,
+                                                      std::memory_order_relaxed)) {
+                value.reset ();
+            }
+            d_bottom.index.store (bottom + 1, std::memory_order_relaxed);
+        }
+        return value;
+    }
+
+    // Any thread. Takes the oldest item; returns nothing when the deque is empty or another thread
+    // took the item first.
+    std::optional<T> steal () {
+        int64_t top = d_top.index.load (std::memory_order_acquire);
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        const int64_t bottom = d_bottom.index.load (std::memory_order_acquire);
+        if (top >= bottom) {
+            return std::nullopt;
+        }
+        const T value = d_ring.load (std::memory_order_acquire)->get (top);
+        if (!d_top.index.compare_exchange_strong (top, top + 1, std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed)) {
+            INPLACE_TRACE_INSTANT ("wsdeque.stealLost", top);
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    // Approximate unless called by the owner with no thief active.
+    size_t size () const {
+        const int64_t bottom = d_bottom.index.load (std::memory_order_relaxed);
+        const int64_t top = d_top.index.load (std::memory_order_relaxed);
+        return bottom > top ? static_cast<size_t> (bottom - top) : 0;
+    }
+
+    bool empty () const {
+        return size () == 0;
+    }
+
+    int64_t capacity () const {
+        return d_ring.load (std::memory_order_relaxed)->capacity ();
+    }
+
+    static constexpr int64_t maxCapacity () {
+        return MaxCapacity;
+    }
+
+    private:
+    Ring* grow (Ring* ring, int64_t top, int64_t bottom) {
+        auto bigger = std::make_unique<Ring> (ring->capacity () * 2);
+        for (int64_t i = top; i < bottom; i++) {
+            bigger->put (i, ring->get (i));
+        }
+        INPLACE_TRACE_INSTANT ("wsdeque.grow", bigger->capacity ());
+        d_rings.push_back (std::move (bigger));
+        Ring* next = d_rings.back ().get ();
+        d_ring.store (next, std::memory_order_release);
+        return next;
+    }
+
+    // Thieves hammer d_top while the owner mostly touches d_bottom; keep them on separate lines.
+    RWTraits<int64_t> d_top;
+    RWTraits<int64_t> d_bottom;
+    std::atomic<Ring*> d_ring;
+    // Owner only: every ring ever used, the current one last.
+    std::vector<std::unique_ptr<Ring>> d_rings;
+};
+}  // namespace inplace
+
+#endif  // WORKSTEALINGDEQUE_HPP
@@ -3,11 +3,69 @@
 #include <TestHeader.hpp>
 #include <benchmark/benchmark.h>
 #include <iostream>
+#include <string>
 using namespace testSpace;
 using namespace std;
 using namespace benchmark;
 //BENCHMARK(testSpace::Test::testInplaceList);
 //BENCHMARK(testSpace::Test::benchMarkCache)->RangeMultiplier(2)->Range(1, 1 << 20);
 //BENCHMARK(testSpace::Test::testInplaceSPSCQueue)->Repetitions (10)->RangeMultiplier(2)->Range(1, 1 << 20);
+BENCHMARK(testSpace::Test::testInplaceSPSCQueue)->RangeMultiplier(8)->Range(1 << 8, 1 << 20);
+BENCHMARK(testSpace::Test::testInplaceSPSCQueueCachedCursor)->RangeMultiplier(8)->Range(1 << 8, 1 << 20);
 BENCHMARK(testSpace::Test::testInplaceMPMCCQueue)->Repetitions (10)->RangeMultiplier(2)->Range(1, 1<< 20);
-BENCHMARK_MAIN();
\ No newline at end of file
+BENCHMARK(testSpace::Test::testForkJoinMPMCPool)->UseRealTime();
+BENCHMARK(testSpace::Test::testForkJoinWorkStealing)->UseRealTime();
+BENCHMARK(testSpace::Test::testPingPongSPSC);
+BENCHMARK(testSpace::Test::testPingPongSPSCCachedCursor);
+BENCHMARK(testSpace::Test::testPingPongMPMC);
+BENCHMARK(testSpace::Test::testLockHandoffWaitStrategy1)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(testSpace::Test::testLockHandoffAdaptive)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(testSpace::Test::testQueueHandoffWaitStrategy1)->UseRealTime();
+BENCHMARK(testSpace::Test::testQueueHandoffAdaptive)->UseRealTime();
+BENCHMARK(testSpace::Test::testLockStdMutex)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testLockTTAS)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testLockTicket)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testLockMCS)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testLockRWExclusive)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testReadMostlyStdSharedMutex)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testReadMostlyRWSpinLock)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testSnapshotReadStdSharedMutex)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testSnapshotReadRWSpinLock)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testSnapshotReadSeqLock)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testSessionTableGlobalMutex)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testSessionTableSharded)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testReclaimEpoch)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testReclaimHazardPointer)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testReclaimLockedBaseline)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testAllocNewDelete)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(testSpace::Test::testAllocObjectPool)->ThreadRange(1, 16)->UseRealTime();
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    // --latency_csv_dir=<dir> and --queue_matrix are ours; drop them before the library reports
+    // unknown flags. The queue matrix runs for hours, so it is only registered on request.
+    const std::string csvFlag = "--latency_csv_dir=";
+    const std::string matrixFlag = "--queue_matrix";
+    bool queueMatrix = false;
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg.rfind(csvFlag, 0) == 0) {
+            testSpace::Test::setLatencyCsvDirectory(arg.substr(csvFlag.size()));
+        } else if (arg == matrixFlag) {
+            queueMatrix = true;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    if (queueMatrix) {
+        testSpace::Test::registerQueueMatrix();
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
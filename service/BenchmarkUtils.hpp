@@ -0,0 +1,57 @@
+#ifndef BENCHMARKUTILS_HPP
+#define BENCHMARKUTILS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace testSpace
+{
+    // Pins the calling thread to cpu `thread` modulo the number of cpus; a no-op off Linux.
+    inline void pinToCpu(size_t thread) {
+#if defined(__linux__)
+        const unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(thread % cpus, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)thread;
+#endif
+    }
+
+    // Restores the calling thread's cpu affinity when it goes out of scope.
+    class AffinityGuard {
+    public:
+        AffinityGuard() {
+#if defined(__linux__)
+            d_saved = pthread_getaffinity_np(pthread_self(), sizeof(d_set), &d_set) == 0;
+#endif
+        }
+
+        ~AffinityGuard() {
+#if defined(__linux__)
+            if (d_saved) {
+                pthread_setaffinity_np(pthread_self(), sizeof(d_set), &d_set);
+            }
+#endif
+        }
+
+        AffinityGuard(AffinityGuard const&) = delete;
+
+        AffinityGuard& operator=(AffinityGuard const&) = delete;
+
+    private:
+#if defined(__linux__)
+        cpu_set_t d_set;
+        bool d_saved = false;
+#endif
+    };
+}
+
+#endif //BENCHMARKUTILS_HPP
@@ -33,11 +33,14 @@ void Test::benchMarkCache (::benchmark::State& state) {
     }
 }
 
-void Test::testInplaceSPSCQueue (::benchmark::State& state) {
+namespace {
+// Shared harness for the SPSC benchmarks so that the queue modes are measured identically.
+template <class Queue>
+void runInplaceSPSCQueue (::benchmark::State& state) {
     const size_t size = state.range (0);
 
     while (state.KeepRunning ()) {
-        inplace::SPSCQueue<long, 1 << 5> spscQueue;
+        Queue spscQueue;
         std::vector<int64_t> writeVector;
         std::vector<int64_t> readVector;
         std::thread writer ([&spscQueue, &writeVector, size] {
@@ -103,6 +106,16 @@ void Test::testInplaceSPSCQueue (::benchmark::State& state) {
 
     }
     std::cout << std::endl;
+    state.SetItemsProcessed (state.iterations () * size);
+}
+}  // namespace
+
+void Test::testInplaceSPSCQueue (::benchmark::State& state) {
+    runInplaceSPSCQueue<inplace::SPSCQueue<long, 1 << 5>> (state);
+}
+
+void Test::testInplaceSPSCQueueCachedCursor (::benchmark::State& state) {
+    runInplaceSPSCQueue<inplace::SPSCQueue<long, 1 << 5, inplace::SPSCMode::CachedCursor>> (state);
 }
 
 
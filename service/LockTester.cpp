@@ -0,0 +1,129 @@
+#include <TestHeader.hpp>
+#include <SeqLock.hpp>
+#include <SpinLock.hpp>
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+
+using namespace testSpace;
+
+namespace {
+// Every benchmark thread increments a few shared counters under the same lock: a critical section
+// of a handful of instructions, the case these locks are meant to take over from std::mutex.
+template <class Lock>
+struct Contended {
+    Lock lock;
+    uint64_t counters[4] = {};
+};
+
+template <class Lock>
+void runLockContention (::benchmark::State& state) {
+    static Contended<Lock> shared;
+    for (auto _ : state) {
+        std::lock_guard guard (shared.lock);
+        for (uint64_t& counter : shared.counters) {
+            counter++;
+        }
+    }
+    state.SetItemsProcessed (state.iterations ());
+}
+
+// Nine readers for every writer.
+template <class Lock>
+void runReadMostly (::benchmark::State& state) {
+    static Contended<Lock> shared;
+    uint64_t seen = 0;
+    uint64_t round = 0;
+    for (auto _ : state) {
+        if (++round % 10 == 0) {
+            std::lock_guard guard (shared.lock);
+            shared.counters[0]++;
+        } else {
+            std::shared_lock guard (shared.lock);
+            seen += shared.counters[0];
+        }
+    }
+    ::benchmark::DoNotOptimize (seen);
+    state.SetItemsProcessed (state.iterations ());
+}
+
+// A 48-byte fee table read by every thread on every iteration; thread 0 also publishes a new one
+// every 1024 iterations.
+struct FeeTable {
+    uint64_t fees[6] = {};
+};
+
+template <class Lock>
+void runSnapshotRead (::benchmark::State& state) {
+    static Lock lock;
+    static FeeTable table;
+    uint64_t seen = 0;
+    uint64_t round = 0;
+    for (auto _ : state) {
+        if (state.thread_index () == 0 && ++round % 1024 == 0) {
+            std::lock_guard guard (lock);
+            table.fees[0] = round;
+        }
+        std::shared_lock guard (lock);
+        seen += table.fees[0];
+    }
+    ::benchmark::DoNotOptimize (seen);
+    state.SetItemsProcessed (state.iterations ());
+}
+
+void runSnapshotReadSeqLock (::benchmark::State& state) {
+    static inplace::SeqLock<FeeTable> table;
+    uint64_t seen = 0;
+    uint64_t round = 0;
+    for (auto _ : state) {
+        if (state.thread_index () == 0 && ++round % 1024 == 0) {
+            table.update ([round] (FeeTable& fees) { fees.fees[0] = round; });
+        }
+        seen += table.load ().fees[0];
+    }
+    ::benchmark::DoNotOptimize (seen);
+    state.SetItemsProcessed (state.iterations ());
+}
+}  // namespace
+
+void Test::testLockStdMutex (::benchmark::State& state) {
+    runLockContention<std::mutex> (state);
+}
+
+void Test::testLockTTAS (::benchmark::State& state) {
+    runLockContention<inplace::TTASSpinLock<>> (state);
+}
+
+void Test::testLockTicket (::benchmark::State& state) {
+    runLockContention<inplace::TicketSpinLock<>> (state);
+}
+
+void Test::testLockMCS (::benchmark::State& state) {
+    runLockContention<inplace::MCSSpinLock<>> (state);
+}
+
+void Test::testLockRWExclusive (::benchmark::State& state) {
+    runLockContention<inplace::RWSpinLock<>> (state);
+}
+
+void Test::testReadMostlyStdSharedMutex (::benchmark::State& state) {
+    runReadMostly<std::shared_mutex> (state);
+}
+
+void Test::testReadMostlyRWSpinLock (::benchmark::State& state) {
+    runReadMostly<inplace::RWSpinLock<>> (state);
+}
+
+void Test::testSnapshotReadStdSharedMutex (::benchmark::State& state) {
+    runSnapshotRead<std::shared_mutex> (state);
+}
+
+void Test::testSnapshotReadRWSpinLock (::benchmark::State& state) {
+    runSnapshotRead<inplace::RWSpinLock<>> (state);
+}
+
+void Test::testSnapshotReadSeqLock (::benchmark::State& state) {
+    runSnapshotReadSeqLock (state);
+}
@@ -0,0 +1,48 @@
+#include <TestHeader.hpp>
+#include <ObjectPool.hpp>
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+using namespace testSpace;
+
+// Message path allocation: every iteration creates a 256-byte message and frees the one created
+// Window iterations earlier, so each thread keeps a few messages in flight, with new/delete
+// against a process-wide ObjectPool that grows to fit.
+namespace {
+struct Message {
+    explicit Message (uint64_t sequence) : sequence (sequence) {
+    }
+
+    uint64_t sequence;
+    std::byte payload[248];
+};
+
+constexpr size_t Window = 32;
+
+template <class Pointer, class Make>
+void runMessages (::benchmark::State& state, Make&& make) {
+    std::array<Pointer, Window> inFlight;
+    uint64_t sequence = 0;
+    for (auto _ : state) {
+        Pointer& slot = inFlight[sequence % Window];
+        slot = make (sequence++);
+        ::benchmark::DoNotOptimize (slot->sequence);
+    }
+    state.SetItemsProcessed (state.iterations ());
+}
+}  // namespace
+
+void Test::testAllocNewDelete (::benchmark::State& state) {
+    runMessages<std::unique_ptr<Message>> (
+        state, [] (uint64_t sequence) { return std::make_unique<Message> (sequence); });
+}
+
+void Test::testAllocObjectPool (::benchmark::State& state) {
+    using Pool = inplace::ObjectPool<Message, 1024, 16>;
+    runMessages<Pool::Handle> (
+        state, [] (uint64_t sequence) { return Pool::shared ().acquire (sequence); });
+}
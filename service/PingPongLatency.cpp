@@ -0,0 +1,106 @@
+#include <TestHeader.hpp>
+#include <BenchmarkUtils.hpp>
+#include <LatencyHistogram.hpp>
+#include <MPMCQueue.hpp>
+#include <SPSCQueue.hpp>
+#include <SpinLock.hpp>
+#include <Tsc.hpp>
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <thread>
+
+using namespace testSpace;
+
+// Round trips between two threads pinned to different cpus: the benchmark thread sends its TSC
+// timestamp through one queue, the echo thread sends it back through another, and the benchmark
+// thread records now - timestamp. Each benchmark iteration is one round trip; the counters
+// report its percentiles in nanoseconds, and --latency_csv_dir=<dir> writes every histogram to
+// <dir>/<benchmark>.csv.
+namespace {
+constexpr int64_t PingPongCapacity = 1024;
+constexpr uint64_t StopMessage = std::numeric_limits<uint64_t>::max ();
+
+std::string& latencyCsvDirectory () {
+    static std::string directory;
+    return directory;
+}
+
+// Busy-waits on `poll`, yielding now and then so the benchmark still finishes when both threads
+// share a cpu.
+template <class Poll>
+void spinUntil (Poll&& poll) {
+    for (uint32_t spins = 1; !poll (); spins++) {
+        if (spins % 1024 == 0) {
+            std::this_thread::yield ();
+        } else {
+            inplace::cpuRelax ();
+        }
+    }
+}
+
+template <class Queue>
+void runPingPong (::benchmark::State& state, const char* name) {
+    Queue ping;
+    Queue pong;
+    std::thread echo ([&] {
+        pinToCpu (1);
+        uint64_t message = 0;
+        while (message != StopMessage) {
+            spinUntil ([&] { return ping.dequeue ([&] (const uint64_t& m) { message = m; }); });
+            spinUntil ([&] { return pong.enqueue (message); });
+        }
+    });
+
+    const auto& clock = inplace::TscClock::instance ();
+    inplace::LogLinearHistogram<> histogram;
+    {
+        AffinityGuard affinity;
+        pinToCpu (0);
+        for (auto _ : state) {
+            const uint64_t sent = inplace::readTsc ();
+            spinUntil ([&] { return ping.enqueue (sent); });
+            spinUntil ([&] { return pong.dequeue ([] (const uint64_t&) {}); });
+            const uint64_t now = inplace::readTsc ();
+            histogram.record (static_cast<uint64_t> (clock.toNanoseconds (now - sent) + 0.5));
+        }
+    }
+    spinUntil ([&] { return ping.enqueue (StopMessage); });
+    echo.join ();
+
+    state.counters["p50_ns"] = static_cast<double> (histogram.valueAtPercentile (50.0));
+    state.counters["p99_ns"] = static_cast<double> (histogram.valueAtPercentile (99.0));
+    state.counters["p99.9_ns"] = static_cast<double> (histogram.valueAtPercentile (99.9));
+    state.counters["p99.99_ns"] = static_cast<double> (histogram.valueAtPercentile (99.99));
+    state.counters["max_ns"] = static_cast<double> (histogram.max ());
+    state.counters["tsc_GHz"] = clock.ticksPerNanosecond ();
+
+    if (!latencyCsvDirectory ().empty ()) {
+        std::ofstream csv (latencyCsvDirectory () + "/" + name + ".csv");
+        histogram.writeCsv (csv);
+        if (!csv) {
+            state.SkipWithError ("could not write the latency histogram CSV");
+        }
+    }
+}
+}  // namespace
+
+void Test::setLatencyCsvDirectory (const std::string& directory) {
+    latencyCsvDirectory () = directory;
+}
+
+void Test::testPingPongSPSC (::benchmark::State& state) {
+    runPingPong<inplace::SPSCQueue<uint64_t, PingPongCapacity>> (state, "PingPongSPSC");
+}
+
+void Test::testPingPongSPSCCachedCursor (::benchmark::State& state) {
+    runPingPong<inplace::SPSCQueue<uint64_t, PingPongCapacity, inplace::SPSCMode::CachedCursor>> (
+        state, "PingPongSPSCCachedCursor");
+}
+
+void Test::testPingPongMPMC (::benchmark::State& state) {
+    runPingPong<inplace::MPMCQueue<uint64_t, PingPongCapacity>> (state, "PingPongMPMC");
+}
@@ -0,0 +1,233 @@
+#include <TestHeader.hpp>
+#include <BenchmarkUtils.hpp>
+#include <DistortedStruct.hpp>
+#include <MPMCQueue.hpp>
+#include <SPSCQueue.hpp>
+#include <SpinLock.hpp>
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace testSpace;
+
+// Throughput matrix over queue kind x payload x wait strategy (compile time) and capacity x
+// producers x consumers x pinning (run time). Each iteration pushes ItemsPerIteration payloads
+// through a fresh queue; only the transfer is timed (manual time), not thread start-up. Run a
+// slice with e.g. --benchmark_filter='Matrix/MPMC/Payload<64>/WaitStrategyYield'.
+namespace {
+constexpr uint64_t ItemsPerIteration = 1 << 16;
+
+template <size_t Bytes>
+struct Payload {
+    static_assert (Bytes >= sizeof (uint64_t));
+
+    explicit Payload (uint64_t sequence) {
+        std::memcpy (bytes.data (), &sequence, sizeof (sequence));
+    }
+
+    uint64_t sequence () const {
+        uint64_t sequence;
+        std::memcpy (&sequence, bytes.data (), sizeof (sequence));
+        return sequence;
+    }
+
+    std::array<std::byte, Bytes> bytes{};
+};
+
+template <class P>
+P makePayload (uint64_t sequence) {
+    return P (sequence);
+}
+
+template <>
+DistortedStruct makePayload<DistortedStruct> (uint64_t sequence) {
+    return DistortedStruct{ sequence, sequence, nullptr, "payload", { sequence } };
+}
+
+template <class P>
+uint64_t sequenceOf (const P& payload) {
+    return payload.sequence ();
+}
+
+template <>
+uint64_t sequenceOf<DistortedStruct> (const DistortedStruct& payload) {
+    return payload.x;
+}
+
+template <class Queue, class P, class Strategy>
+void runQueueMatrix (::benchmark::State& state) {
+    const auto capacity = static_cast<int64_t> (state.range (0));
+    const auto producers = static_cast<size_t> (state.range (1));
+    const auto consumers = static_cast<size_t> (state.range (2));
+    const bool pinned = state.range (3) != 0;
+    const uint64_t perProducer = ItemsPerIteration / producers;
+    const uint64_t items = perProducer * producers;
+
+    uint64_t checksum = 0;
+    for (auto _ : state) {
+        Queue queue (capacity);
+        std::atomic<size_t> ready = 0;
+        std::atomic<bool> go = false;
+        std::atomic<uint64_t> consumed = 0;
+        std::atomic<size_t> finished = 0;
+        std::atomic<uint64_t> sum = 0;
+        std::vector<std::thread> threads;
+
+        auto start = [&] (size_t thread) {
+            if (pinned) {
+                pinToCpu (thread);
+            }
+            ready.fetch_add (1);
+            while (!go.load (std::memory_order_acquire)) {
+                std::this_thread::yield ();
+            }
+        };
+        for (size_t p = 0; p < producers; p++) {
+            threads.emplace_back ([&, p] {
+                start (p);
+                for (uint64_t i = 0; i < perProducer; i++) {
+                    P payload = makePayload<P> (p * perProducer + i);
+                    Strategy strategy;
+                    while (!queue.enqueue (std::move (payload))) {
+                        inplace::backOff (strategy);
+                    }
+                }
+            });
+        }
+        for (size_t c = 0; c < consumers; c++) {
+            threads.emplace_back ([&, c] {
+                start (producers + c);
+                // Consumed counts are published in batches, and always before backing off, so the
+                // shared counter is neither contended nor stale when the queue runs dry.
+                uint64_t local = 0;
+                uint64_t localSum = 0;
+                Strategy strategy;
+                while (consumed.load (std::memory_order_relaxed) < items) {
+                    if (queue.dequeue ([&localSum] (const P& payload) {
+                            localSum += sequenceOf (payload);
+                        })) {
+                        if (++local == 256) {
+                            consumed.fetch_add (local, std::memory_order_relaxed);
+                            local = 0;
+                        }
+                        continue;
+                    }
+                    if (local != 0) {
+                        consumed.fetch_add (local, std::memory_order_relaxed);
+                        local = 0;
+                    }
+                    inplace::backOff (strategy);
+                }
+                sum.fetch_add (localSum, std::memory_order_relaxed);
+                finished.fetch_add (1, std::memory_order_release);
+            });
+        }
+
+        while (ready.load () != producers + consumers) {
+            std::this_thread::yield ();
+        }
+        const auto begin = std::chrono::steady_clock::now ();
+        go.store (true, std::memory_order_release);
+        while (finished.load (std::memory_order_acquire) != consumers) {
+            std::this_thread::yield ();
+        }
+        const auto end = std::chrono::steady_clock::now ();
+        for (auto& thread : threads) {
+            thread.join ();
+        }
+        state.SetIterationTime (std::chrono::duration<double> (end - begin).count ());
+        checksum += sum.load ();
+    }
+    ::benchmark::DoNotOptimize (checksum);
+
+    const auto total = static_cast<double> (state.iterations () * items);
+    state.counters["ops"] = ::benchmark::Counter (total, ::benchmark::Counter::kIsRate);
+    state.counters["bytes"] = ::benchmark::Counter (total * sizeof (P), ::benchmark::Counter::kIsRate,
+                                                    ::benchmark::Counter::kIs1024);
+}
+
+std::vector<int64_t> threadCounts () {
+    const int64_t max = std::max (2u, std::thread::hardware_concurrency ());
+    std::vector<int64_t> counts;
+    for (int64_t n = 1; n < max; n *= 2) {
+        counts.push_back (n);
+    }
+    counts.push_back (max);
+    return counts;
+}
+
+template <class Queue, class P, class Strategy>
+void registerOne (const std::string& name, bool multiThreaded,
+                  std::initializer_list<int64_t> capacities = { 64, 1024, 16384 }) {
+    auto* benchmark = ::benchmark::RegisterBenchmark (name.c_str (), runQueueMatrix<Queue, P, Strategy>);
+    benchmark->ArgNames ({ "capacity", "producers", "consumers", "pinned" })
+        ->UseManualTime ()
+        ->Unit (::benchmark::kMillisecond);
+    const std::vector<int64_t> single{ 1 };
+    const auto counts = multiThreaded ? threadCounts () : single;
+    for (int64_t capacity : capacities) {
+        for (int64_t producers : counts) {
+            for (int64_t consumers : counts) {
+                for (int64_t pinned : { 0, 1 }) {
+                    benchmark->Args ({ capacity, producers, consumers, pinned });
+                }
+            }
+        }
+    }
+}
+
+template <class P, class Strategy>
+void registerQueues (const std::string& payload, const std::string& strategy) {
+    using namespace inplace;
+    const std::string suffix = "/" + payload + "/" + strategy;
+    registerOne<SPSCQueue<P, DYNAMIC_CAPACITY, SPSCMode::SharedCounter>, P, Strategy> (
+        "Matrix/SPSC" + suffix, false);
+    registerOne<SPSCQueue<P, DYNAMIC_CAPACITY, SPSCMode::CachedCursor>, P, Strategy> (
+        "Matrix/SPSCCachedCursor" + suffix, false);
+    registerOne<MPMCQueue<P, DYNAMIC_CAPACITY, false, Strategy>, P, Strategy> ("Matrix/MPMC" + suffix,
+                                                                              true);
+}
+
+template <class P>
+void registerStrategies (const std::string& payload) {
+    registerQueues<P, inplace::WaitStrategy1> (payload, "WaitStrategy1");
+    registerQueues<P, inplace::WaitStrategyYield> (payload, "WaitStrategyYield");
+    registerQueues<P, inplace::WaitStrategyExponential> (payload, "WaitStrategyExponential");
+    registerQueues<P, inplace::WaitStrategyAdaptive> (payload, "WaitStrategyAdaptive");
+}
+// Layout/MPMC<layout>/<payload>: the MPMCQueue slot layouts side by side (see SlotArray.hpp).
+template <class P>
+void registerLayouts (const std::string& payload) {
+    using namespace inplace;
+    using Strategy = WaitStrategyAdaptive;
+    registerOne<MPMCQueue<P, DYNAMIC_CAPACITY, false, Strategy, NoQueueStats, PackedSlots>, P, Strategy> (
+        "Layout/MPMCPacked/" + payload, true, { 1024 });
+    registerOne<MPMCQueue<P, DYNAMIC_CAPACITY, false, Strategy, NoQueueStats, PaddedSlots<>>, P, Strategy> (
+        "Layout/MPMCPadded/" + payload, true, { 1024 });
+    registerOne<MPMCQueue<P, DYNAMIC_CAPACITY, false, Strategy, NoQueueStats, SwizzledSlots<>>, P,
+                Strategy> ("Layout/MPMCSwizzled/" + payload, true, { 1024 });
+}
+}  // namespace
+
+void Test::registerQueueMatrix () {
+    registerStrategies<Payload<8>> ("Payload<8>");
+    registerStrategies<Payload<64>> ("Payload<64>");
+    registerStrategies<Payload<512>> ("Payload<512>");
+    registerStrategies<Payload<4096>> ("Payload<4096>");
+    registerStrategies<DistortedStruct> ("DistortedStruct");
+
+    registerLayouts<Payload<8>> ("Payload<8>");
+    registerLayouts<Payload<16>> ("Payload<16>");
+    registerLayouts<Payload<32>> ("Payload<32>");
+    registerLayouts<Payload<64>> ("Payload<64>");
+    registerLayouts<Payload<256>> ("Payload<256>");
+}
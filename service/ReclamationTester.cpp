@@ -0,0 +1,152 @@
+#include <TestHeader.hpp>
+#include <EpochReclamation.hpp>
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace testSpace;
+
+// Treiber stack push + pop per iteration, the popped node freed through each reclamation scheme:
+// pinning the EpochDomain, protecting the head with a hazard pointer (epochs then never wait on
+// a reader), and a std::mutex around a std::vector as the locked baseline.
+namespace {
+struct Node {
+    uint64_t value;
+    Node* next;
+};
+
+// The domain outlives the stack: benchmark threads still hold hazard pointers into it when the
+// stack of a run is deleted.
+class ReclaimedStack {
+    public:
+    explicit ReclaimedStack (inplace::EpochDomain& domain) : d_domain (domain) {
+    }
+
+    ~ReclaimedStack () {
+        for (Node* node = d_head.load (); node != nullptr;) {
+            delete std::exchange (node, node->next);
+        }
+    }
+
+    void push (uint64_t value) {
+        Node* node = new Node{ value, d_head.load (std::memory_order_relaxed) };
+        while (!d_head.compare_exchange_weak (node->next, node, std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+        }
+    }
+
+    std::optional<uint64_t> popPinned () {
+        auto guard = d_domain.pin ();
+        Node* node = d_head.load (std::memory_order_acquire);
+        while (node != nullptr && !d_head.compare_exchange_weak (node, node->next,
+                                                                 std::memory_order_acquire,
+                                                                 std::memory_order_acquire)) {
+        }
+        return take (node);
+    }
+
+    std::optional<uint64_t> popProtected (inplace::EpochDomain::HazardPointer& hazard) {
+        Node* node = hazard.protect (d_head);
+        while (node != nullptr && !d_head.compare_exchange_weak (node, node->next,
+                                                                 std::memory_order_acquire,
+                                                                 std::memory_order_acquire)) {
+            node = hazard.protect (d_head);
+        }
+        std::optional<uint64_t> value = take (node);
+        hazard.reset ();
+        return value;
+    }
+
+    inplace::EpochDomain& domain () {
+        return d_domain;
+    }
+
+    private:
+    std::optional<uint64_t> take (Node* node) {
+        if (node == nullptr) {
+            return std::nullopt;
+        }
+        const uint64_t value = node->value;
+        d_domain.retire (node);
+        return value;
+    }
+
+    inplace::EpochDomain& d_domain;
+    std::atomic<Node*> d_head = nullptr;
+};
+
+class LockedStack {
+    public:
+    void push (uint64_t value) {
+        std::lock_guard lock (d_mutex);
+        d_values.push_back (value);
+    }
+
+    std::optional<uint64_t> pop () {
+        std::lock_guard lock (d_mutex);
+        if (d_values.empty ()) {
+            return std::nullopt;
+        }
+        const uint64_t value = d_values.back ();
+        d_values.pop_back ();
+        return value;
+    }
+
+    private:
+    std::mutex d_mutex;
+    std::vector<uint64_t> d_values;
+};
+
+template <class Stack, class Make, class Pop>
+void runStack (::benchmark::State& state, Stack*& shared, Make&& make, Pop&& pop) {
+    if (state.thread_index () == 0) {
+        shared = make ();
+    }
+    uint64_t sum = 0;
+    uint64_t pushed = 0;
+    for (auto _ : state) {
+        shared->push (pushed++);
+        if (auto value = pop (*shared)) {
+            sum += *value;
+        }
+    }
+    ::benchmark::DoNotOptimize (sum);
+    state.SetItemsProcessed (state.iterations ());
+    if (state.thread_index () == 0) {
+        if constexpr (std::is_same_v<Stack, ReclaimedStack>) {
+            state.counters["pending"] = static_cast<double> (shared->domain ().pendingCount ());
+        }
+        delete shared;
+        shared = nullptr;
+    }
+}
+}  // namespace
+
+void Test::testReclaimEpoch (::benchmark::State& state) {
+    static inplace::EpochDomain domain;
+    static ReclaimedStack* stack = nullptr;
+    runStack (
+        state, stack, [] { return new ReclaimedStack (domain); },
+        [] (ReclaimedStack& s) { return s.popPinned (); });
+}
+
+void Test::testReclaimHazardPointer (::benchmark::State& state) {
+    static inplace::EpochDomain domain;
+    static ReclaimedStack* stack = nullptr;
+    auto hazard = domain.hazardPointer ();
+    runStack (
+        state, stack, [] { return new ReclaimedStack (domain); },
+        [&hazard] (ReclaimedStack& s) { return s.popProtected (hazard); });
+}
+
+void Test::testReclaimLockedBaseline (::benchmark::State& state) {
+    static LockedStack* stack = nullptr;
+    runStack (
+        state, stack, [] { return new LockedStack (); }, [] (LockedStack& s) { return s.pop (); });
+}
@@ -0,0 +1,115 @@
+#include <TestHeader.hpp>
+#include <InplaceCommon.hpp>
+#include <SynchronizedStructure.h>
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace testSpace;
+
+namespace {
+// Session table traffic: 80% lookups, 15% in-place updates, 5% replace/erase, over 64K sessions.
+constexpr uint64_t Sessions = 1 << 16;
+
+// Random 64-bit ids: dense ids would let std::hash (the identity) give a single map a collision
+// free bucket array, which flatters the unsharded baseline.
+const std::vector<uint64_t>& sessionIds () {
+    static const std::vector<uint64_t> ids = [] {
+        std::mt19937_64 generator (Sessions);
+        std::vector<uint64_t> ids (Sessions);
+        for (uint64_t& id : ids) {
+            id = generator ();
+        }
+        return ids;
+    }();
+    return ids;
+}
+
+struct Session {
+    uint64_t user = 0;
+    uint64_t requests = 0;
+};
+
+// The baseline: one map behind one mutex.
+class GlobalMutexTable {
+    public:
+    std::optional<Session> find (uint64_t id) const {
+        std::lock_guard lock (d_mutex);
+        auto it = d_sessions.find (id);
+        return it == d_sessions.end () ? std::nullopt : std::optional<Session> (it->second);
+    }
+
+    template <class F>
+    bool visit (uint64_t id, F&& fn) {
+        std::lock_guard lock (d_mutex);
+        auto it = d_sessions.find (id);
+        if (it == d_sessions.end ()) {
+            return false;
+        }
+        fn (it->second);
+        return true;
+    }
+
+    bool insert_or_assign (uint64_t id, const Session& session) {
+        std::lock_guard lock (d_mutex);
+        return d_sessions.insert_or_assign (id, session).second;
+    }
+
+    bool erase (uint64_t id) {
+        std::lock_guard lock (d_mutex);
+        return d_sessions.erase (id) != 0;
+    }
+
+    private:
+    mutable std::mutex d_mutex;
+    std::unordered_map<uint64_t, Session> d_sessions;
+};
+
+using ShardedTable = SynchronizedStructure::SynchronizedStructure<uint64_t, Session>;
+
+template <class Table>
+void runSessionTable (::benchmark::State& state) {
+    static Table* table = nullptr;
+    const std::vector<uint64_t>& ids = sessionIds ();
+    if (state.thread_index () == 0) {
+        table = new Table ();
+        for (uint64_t id : ids) {
+            table->insert_or_assign (id, Session{ id, 0 });
+        }
+    }
+    uint64_t found = 0;
+    for (auto _ : state) {
+        const uint64_t random = inplace::fastRandom ();
+        const uint64_t id = ids[random % Sessions];
+        const uint64_t dice = (random >> 32) % 100;
+        if (dice < 80) {
+            found += table->find (id).has_value ();
+        } else if (dice < 95) {
+            table->visit (id, [] (Session& session) { session.requests++; });
+        } else if (dice < 98) {
+            table->insert_or_assign (id, Session{ id, 0 });
+        } else {
+            table->erase (id);
+        }
+    }
+    ::benchmark::DoNotOptimize (found);
+    state.SetItemsProcessed (state.iterations ());
+    if (state.thread_index () == 0) {
+        delete table;
+        table = nullptr;
+    }
+}
+}  // namespace
+
+void Test::testSessionTableGlobalMutex (::benchmark::State& state) {
+    runSessionTable<GlobalMutexTable> (state);
+}
+
+void Test::testSessionTableSharded (::benchmark::State& state) {
+    runSessionTable<ShardedTable> (state);
+}
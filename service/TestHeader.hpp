@@ -9,6 +9,7 @@
 #include <iostream>
 #include <thread>
 #include <bitset>
+#include <string>
 #include <SPSCQueue.hpp>
 
 namespace testSpace
@@ -17,7 +18,39 @@ namespace testSpace
     public:
         static void benchMarkCache(::benchmark::State& state);
         static void testInplaceSPSCQueue(::benchmark::State& state);
+        static void testInplaceSPSCQueueCachedCursor(::benchmark::State& state);
         static void testInplaceMPMCCQueue(::benchmark::State& state);
+        static void testForkJoinMPMCPool(::benchmark::State& state);
+        static void testForkJoinWorkStealing(::benchmark::State& state);
+        // Registers the Matrix/* queue throughput benchmarks (QueueBenchmarkMatrix.cpp); main only
+        // does so when given --queue_matrix.
+        static void registerQueueMatrix();
+        static void testPingPongSPSC(::benchmark::State& state);
+        static void testPingPongSPSCCachedCursor(::benchmark::State& state);
+        static void testPingPongMPMC(::benchmark::State& state);
+        static void testLockHandoffWaitStrategy1(::benchmark::State& state);
+        static void testLockHandoffAdaptive(::benchmark::State& state);
+        static void testQueueHandoffWaitStrategy1(::benchmark::State& state);
+        static void testQueueHandoffAdaptive(::benchmark::State& state);
+        static void testLockStdMutex(::benchmark::State& state);
+        static void testLockTTAS(::benchmark::State& state);
+        static void testLockTicket(::benchmark::State& state);
+        static void testLockMCS(::benchmark::State& state);
+        static void testLockRWExclusive(::benchmark::State& state);
+        static void testReadMostlyStdSharedMutex(::benchmark::State& state);
+        static void testReadMostlyRWSpinLock(::benchmark::State& state);
+        static void testSnapshotReadStdSharedMutex(::benchmark::State& state);
+        static void testSnapshotReadRWSpinLock(::benchmark::State& state);
+        static void testSnapshotReadSeqLock(::benchmark::State& state);
+        static void testReclaimEpoch(::benchmark::State& state);
+        static void testReclaimHazardPointer(::benchmark::State& state);
+        static void testReclaimLockedBaseline(::benchmark::State& state);
+        static void testSessionTableGlobalMutex(::benchmark::State& state);
+        static void testSessionTableSharded(::benchmark::State& state);
+        static void testAllocNewDelete(::benchmark::State& state);
+        static void testAllocObjectPool(::benchmark::State& state);
+        // Where the ping-pong benchmarks write their latency histograms; empty disables the dump.
+        static void setLatencyCsvDirectory(const std::string& directory);
         void SetUp(::benchmark::State& state) override;
 
         void TearDown(::benchmark::State& state) override;
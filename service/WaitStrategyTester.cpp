@@ -0,0 +1,85 @@
+#include <TestHeader.hpp>
+#include <MPMCQueue.hpp>
+#include <SpinLock.hpp>
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+using namespace testSpace;
+
+namespace {
+// Lock handoff: every benchmark thread takes the same SpinLock around a tiny critical section, so
+// most acquisitions wait for another thread and the cost is dominated by the wait strategy.
+template <class Strategy>
+void runLockHandoff (::benchmark::State& state) {
+    static std::atomic<int> lock = 0;
+    static uint64_t shared = 0;
+    for (auto _ : state) {
+        while (!inplace::SpinLock<Strategy>::YieldAfter (lock, 0, 1)) {
+        }
+        shared++;
+        lock.store (0, std::memory_order_release);
+    }
+    ::benchmark::DoNotOptimize (shared);
+    state.SetItemsProcessed (state.iterations ());
+}
+
+// Two producers and two consumers on a small MPMCQueue that is full or empty most of the time, so
+// slot handoffs inside the queue wait through `Strategy`.
+template <class Strategy>
+void runQueueHandoff (::benchmark::State& state) {
+    constexpr uint64_t Items = 1 << 15;
+    for (auto _ : state) {
+        inplace::MPMCQueue<uint64_t, 16, false, Strategy> queue;
+        std::atomic<uint64_t> consumed = 0;
+        std::thread threads[4];
+        for (int p = 0; p < 2; p++) {
+            threads[p] = std::thread ([&queue] {
+                for (uint64_t i = 0; i < Items / 2; i++) {
+                    Strategy strategy;
+                    while (!queue.enqueue (i)) {
+                        if (!strategy.wait ()) {
+                            strategy.reset ();
+                        }
+                    }
+                }
+            });
+        }
+        for (int c = 2; c < 4; c++) {
+            threads[c] = std::thread ([&queue, &consumed] {
+                Strategy strategy;
+                while (consumed.load (std::memory_order_relaxed) < Items) {
+                    if (queue.dequeue ([] (const uint64_t&) {})) {
+                        consumed.fetch_add (1, std::memory_order_relaxed);
+                        strategy.reset ();
+                    } else if (!strategy.wait ()) {
+                        strategy.reset ();
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join ();
+        }
+    }
+    state.SetItemsProcessed (state.iterations () * Items);
+}
+}  // namespace
+
+void Test::testLockHandoffWaitStrategy1 (::benchmark::State& state) {
+    runLockHandoff<inplace::WaitStrategy1> (state);
+}
+
+void Test::testLockHandoffAdaptive (::benchmark::State& state) {
+    runLockHandoff<inplace::WaitStrategyAdaptive> (state);
+}
+
+void Test::testQueueHandoffWaitStrategy1 (::benchmark::State& state) {
+    runQueueHandoff<inplace::WaitStrategy1> (state);
+}
+
+void Test::testQueueHandoffAdaptive (::benchmark::State& state) {
+    runQueueHandoff<inplace::WaitStrategyAdaptive> (state);
+}
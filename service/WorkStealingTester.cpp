@@ -0,0 +1,136 @@
+#include <TestHeader.hpp>
+#include <MPMCQueue.hpp>
+#include <WorkStealingDeque.hpp>
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace testSpace;
+
+namespace {
+// Fork/join workload: a task of depth d > 0 spawns two tasks of depth d - 1; leaves are counted.
+// Every spawn increments `pending` and every finished task decrements it, so the workers stop once
+// it drops to zero.
+constexpr int TreeDepth = 16;
+constexpr int Workers = 4;
+
+struct ForkJoinCounters {
+    std::atomic<int64_t> pending = 1;
+    std::atomic<int64_t> leaves = 0;
+};
+
+// Shared pool: every worker pushes to and pops from the same MPMCQueue.
+int64_t runMPMCPool () {
+    using Pool = inplace::MPMCQueue<int32_t, 1 << 12>;
+    auto pool = std::make_unique<Pool> ();
+    ForkJoinCounters counters;
+    pool->enqueue (TreeDepth);
+
+    auto work = [&pool, &counters] {
+        auto run = [&pool, &counters] (auto& self, int32_t depth) -> void {
+            if (depth == 0) {
+                counters.leaves.fetch_add (1, std::memory_order_relaxed);
+            } else {
+                for (int child = 0; child < 2; child++) {
+                    counters.pending.fetch_add (1, std::memory_order_relaxed);
+                    if (!pool->enqueue (depth - 1)) {
+                        self (self, depth - 1);
+                    }
+                }
+            }
+            counters.pending.fetch_sub (1, std::memory_order_acq_rel);
+        };
+        while (counters.pending.load (std::memory_order_acquire) != 0) {
+            int32_t depth = -1;
+            if (pool->dequeue ([&depth] (int32_t task) { depth = task; })) {
+                run (run, depth);
+            } else {
+                std::this_thread::yield ();
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < Workers; i++) {
+        threads.emplace_back (work);
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+    return counters.leaves.load ();
+}
+
+// One deque per worker: spawns go to the worker's own bottom, idle workers steal round-robin.
+int64_t runWorkStealing () {
+    using Deque = inplace::WorkStealingDeque<int32_t, 64>;
+    std::vector<std::unique_ptr<Deque>> deques;
+    for (int i = 0; i < Workers; i++) {
+        deques.push_back (std::make_unique<Deque> ());
+    }
+    ForkJoinCounters counters;
+    deques[0]->push (TreeDepth);
+
+    auto work = [&deques, &counters] (int self) {
+        Deque& own = *deques[self];
+        auto run = [&own, &counters] (auto& recurse, int32_t depth) -> void {
+            if (depth == 0) {
+                counters.leaves.fetch_add (1, std::memory_order_relaxed);
+            } else {
+                for (int child = 0; child < 2; child++) {
+                    counters.pending.fetch_add (1, std::memory_order_relaxed);
+                    if (!own.push (depth - 1)) {
+                        recurse (recurse, depth - 1);
+                    }
+                }
+            }
+            counters.pending.fetch_sub (1, std::memory_order_acq_rel);
+        };
+        int victim = self;
+        while (counters.pending.load (std::memory_order_acquire) != 0) {
+            auto task = own.pop ();
+            for (int i = 0; !task && i < Workers; i++) {
+                victim = (victim + 1) % Workers;
+                if (victim != self) {
+                    task = deques[victim]->steal ();
+                }
+            }
+            if (task) {
+                run (run, *task);
+            } else {
+                std::this_thread::yield ();
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < Workers; i++) {
+        threads.emplace_back (work, i);
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+    return counters.leaves.load ();
+}
+
+template <class Runner>
+void runForkJoin (::benchmark::State& state, Runner runner) {
+    for (auto _ : state) {
+        const int64_t leaves = runner ();
+        if (leaves != (int64_t{ 1 } << TreeDepth)) {
+            state.SkipWithError ("fork/join tree was not fully evaluated");
+            break;
+        }
+    }
+    state.SetItemsProcessed (state.iterations () * ((int64_t{ 2 } << TreeDepth) - 1));
+}
+}  // namespace
+
+void Test::testForkJoinMPMCPool (::benchmark::State& state) {
+    runForkJoin (state, runMPMCPool);
+}
+
+void Test::testForkJoinWorkStealing (::benchmark::State& state) {
+    runForkJoin (state, runWorkStealing);
+}
@@ -5,51 +5,37 @@
 
 #include <gtest/gtest.h>
 #include "SPSCQueue.hpp"
+#include "DistortedStruct.hpp"
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 
 using namespace inplace;
 
-struct DistortedStruct {
-    size_t x = 0;
-    size_t y = 0;
-    std::shared_ptr<int> d_ptr;
-    std::string vstr;
-    std::vector<size_t> vvec;
-
-    // DistortedStruct () = default;
-    //
-    // DistortedStruct (int a, int b, std::shared_ptr<int> d, std::string vs, std::vector<int> vec)
-    //     : x (a), y (b), d_ptr (d), vstr (vs), vvec (vec) {
-    // }
-
-    bool operator== (const DistortedStruct& other) const {
-        bool var = (x == other.x && y == other.y);
-        if (!var)
-            return false;
-        if (d_ptr != other.d_ptr) {
-            return false;
-        }
-        if (vstr != other.vstr) {
-            return false;
-        }
+// Payload without a default constructor that can only be moved, for the move-out dequeue paths.
+struct MoveOnlyPayload {
+    explicit MoveOnlyPayload (size_t value) : d_value (std::make_unique<size_t> (value)) {
+    }
 
-        if (vvec.size () != other.vvec.size ()) {
-            return false;
-        }
-        for (size_t i = 0; i < vvec.size (); i++) {
-            if (vvec[i] != other.vvec[i]) {
-                return false;
-            }
+    std::unique_ptr<size_t> d_value;
+};
+
+// Payload whose copy throws when `throws` is set, for the exception paths of the bulk enqueues.
+struct CopyThrowingPayload {
+    std::shared_ptr<int> ptr;
+    bool throws = false;
+
+    CopyThrowingPayload (std::shared_ptr<int> p, bool t) : ptr (std::move (p)), throws (t) {
+    }
+
+    CopyThrowingPayload (const CopyThrowingPayload& other) : ptr (other.ptr), throws (other.throws) {
+        if (throws) {
+            throw std::runtime_error ("copy");
         }
-        return true;
     }
-};
 
-inline std::ostream& operator<<(std::ostream& os, const DistortedStruct& obj) {
-    os << obj.x << " " << obj.y << " " << obj.d_ptr << " " << obj.vstr;
-    return os;
-}
+    CopyThrowingPayload (CopyThrowingPayload&&) noexcept = default;
+};
 
 #endif //COMMONTESTUTILS_HPP
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <CoroutineQueue.hpp>
+#include <MPMCQueue.hpp>
+#include <SPSCQueue.hpp>
+#include <ThreadPoolExecutor.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+using namespace inplace;
+
+namespace {
+template <class Queue>
+DetachedCoroutine consumeOne (Queue& queue, std::atomic<int64_t>& sum, std::atomic<int>& done) {
+    const int64_t value = co_await queue.pop ();
+    sum.fetch_add (value);
+    done.fetch_add (1);
+}
+
+template <class Queue>
+DetachedCoroutine produce (Queue& queue, int64_t count, std::atomic<int>& done) {
+    for (int64_t i = 1; i <= count; i++) {
+        co_await queue.push (i);
+    }
+    done.fetch_add (1);
+}
+}  // namespace
+
+TEST (CoroutineQueueTest, oneThreadMultiplexesManyConsumers) {
+    constexpr int Consumers = 2000;
+    RunLoopExecutor executor;
+    CoroutineQueue<MPMCQueue<int64_t, 16>, RunLoopExecutor> queue (executor);
+    std::atomic<int64_t> sum = 0;
+    std::atomic<int> consumed = 0;
+    std::atomic<int> produced = 0;
+
+    for (int i = 0; i < Consumers; i++) {
+        consumeOne (queue, sum, consumed);
+    }
+    EXPECT_EQ (queue.suspendedConsumers (), Consumers);
+
+    // The producer fills the queue, wakes consumers, and suspends whenever the queue is full.
+    produce (queue, Consumers, produced);
+    executor.drain ();
+    EXPECT_EQ (consumed.load (), Consumers);
+    EXPECT_EQ (produced.load (), 1);
+    EXPECT_EQ (sum.load (), int64_t{ Consumers } * (Consumers + 1) / 2);
+    EXPECT_EQ (queue.suspendedConsumers (), 0);
+    EXPECT_EQ (queue.suspendedProducers (), 0);
+}
+
+TEST (CoroutineQueueTest, readyOperationsDoNotSuspend) {
+    InlineExecutor executor;
+    CoroutineQueue<SPSCQueue<int64_t, 4>, InlineExecutor> queue (executor);
+    std::atomic<int> produced = 0;
+    produce (queue, 3, produced);
+    EXPECT_EQ (produced.load (), 1);
+    EXPECT_EQ (queue.suspendedProducers (), 0);
+
+    std::atomic<int64_t> sum = 0;
+    std::atomic<int> consumed = 0;
+    for (int i = 0; i < 3; i++) {
+        consumeOne (queue, sum, consumed);
+    }
+    EXPECT_EQ (consumed.load (), 3);
+    EXPECT_EQ (sum.load (), 6);
+    EXPECT_EQ (queue.tryPop (), std::nullopt);
+}
+
+TEST (CoroutineQueueTest, consumerIsResumedByAnotherThread) {
+    constexpr int64_t Count = 100000;
+    RunLoopExecutor executor;
+    CoroutineQueue<SPSCQueue<int64_t, 64, SPSCMode::CachedCursor>, RunLoopExecutor> queue (executor);
+    std::atomic<int64_t> received = 0;
+    std::atomic<bool> finished = false;
+
+    [] (auto& queue, std::atomic<int64_t>& received, std::atomic<bool>& finished) -> DetachedCoroutine {
+        for (int64_t i = 1; i <= Count; i++) {
+            const int64_t value = co_await queue.pop ();
+            EXPECT_EQ (value, i);
+            received.fetch_add (1, std::memory_order_relaxed);
+        }
+        finished.store (true);
+    }(queue, received, finished);
+
+    std::thread producer ([&queue] {
+        for (int64_t i = 1; i <= Count; i++) {
+            while (!queue.tryPush (i)) {
+                std::this_thread::yield ();
+            }
+        }
+    });
+    while (!finished.load ()) {
+        if (!executor.runOne ()) {
+            std::this_thread::yield ();
+        }
+    }
+    producer.join ();
+    EXPECT_EQ (received.load (), Count);
+}
+
+TEST (CoroutineQueueTest, threadPoolStress) {
+    // Coroutines on a multi-threaded executor: a waker may take a waiter off the list while it is
+    // still suspending on another worker. Every element must arrive exactly once.
+    constexpr int Producers = 4;
+    constexpr int Consumers = 4;
+    constexpr int64_t PerProducer = 20000;
+    constexpr int64_t Total = Producers * PerProducer;
+    datastructure::ThreadPoolOptions options;
+    options.workers = 4;
+    datastructure::ThreadPoolExecutor executor (options);
+    CoroutineQueue<MPMCQueue<int64_t, 4>, datastructure::ThreadPoolExecutor> queue (executor);
+    auto seen = std::make_unique<std::atomic<int>[]> (Total);
+    std::atomic<int> finished = 0;
+
+    auto produce = [] (auto& queue, int64_t first, std::atomic<int>& finished) -> DetachedCoroutine {
+        for (int64_t i = first; i < first + PerProducer; i++) {
+            co_await queue.push (i);
+        }
+        finished.fetch_add (1);
+    };
+    auto consume = [] (auto& queue, std::atomic<int>* seen,
+                       std::atomic<int>& finished) -> DetachedCoroutine {
+        for (int64_t i = 0; i < Total / Consumers; i++) {
+            const int64_t value = co_await queue.pop ();
+            seen[value].fetch_add (1, std::memory_order_relaxed);
+        }
+        finished.fetch_add (1);
+    };
+    for (int c = 0; c < Consumers; c++) {
+        executor.post ([&] { consume (queue, seen.get (), finished); });
+    }
+    for (int p = 0; p < Producers; p++) {
+        executor.post ([&, p] { produce (queue, p * PerProducer, finished); });
+    }
+    const auto deadline = std::chrono::steady_clock::now () + std::chrono::seconds (120);
+    while (finished.load () < Producers + Consumers &&
+           std::chrono::steady_clock::now () < deadline) {
+        std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    }
+    ASSERT_EQ (finished.load (), Producers + Consumers);
+    executor.shutdown ();
+    int64_t missing = 0;
+    for (int64_t i = 0; i < Total; i++) {
+        missing += seen[i].load () != 1;
+    }
+    EXPECT_EQ (missing, 0);
+    EXPECT_EQ (queue.suspendedConsumers (), 0);
+    EXPECT_EQ (queue.suspendedProducers (), 0);
+}
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include "DebugPrint.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace datastructure;
+
+namespace {
+struct Streamed {
+    int a = 0;
+};
+
+std::ostream& operator<< (std::ostream& os, const Streamed& s) {
+    return os << "Streamed{" << s.a << "}";
+}
+
+// Sends DebugPrint output to a temporary file for the lifetime of the object.
+class CapturedOutput {
+    public:
+    CapturedOutput () : d_file (std::tmpfile ()) {
+        DebugPrint::setOutput (fileno (d_file));
+    }
+
+    ~CapturedOutput () {
+        DebugPrint::setOutput (STDOUT_FILENO);
+        std::fclose (d_file);
+    }
+
+    std::vector<std::string> lines () {
+        DebugPrint::flush ();
+        std::string text;
+        std::rewind (d_file);
+        char buffer[4096];
+        while (size_t n = std::fread (buffer, 1, sizeof (buffer), d_file)) {
+            text.append (buffer, n);
+        }
+        std::vector<std::string> result;
+        std::istringstream is (text);
+        for (std::string line; std::getline (is, line);) {
+            result.push_back (line);
+        }
+        return result;
+    }
+
+    private:
+    std::FILE* d_file;
+};
+}  // namespace
+
+TEST (DebugPrintTest, formatsArgumentsOnTheBackend) {
+    CapturedOutput output;
+    const std::string owned = "owned";
+    DebugPrint::printLine ("int=", 42, " double=", 1.5, " char=", 'c', " bool=", true);
+    DebugPrint::printLine (owned, " ", std::string_view ("view"), " ", Streamed{ 7 });
+    DebugPrint::log<LogLevel::Error> ("error ", -3);
+
+    const auto lines = output.lines ();
+    ASSERT_EQ (lines.size (), 3);
+    EXPECT_EQ (lines[0], "int=42 double=1.5 char=c bool=1");
+    EXPECT_EQ (lines[1], "owned view Streamed{7}");
+    EXPECT_EQ (lines[2], "error -3");
+}
+
+TEST (DebugPrintTest, truncatesOversizedRecords) {
+    CapturedOutput output;
+    DebugPrint::printLine (std::string (1000, 'x'), " never shown");
+    const auto lines = output.lines ();
+    ASSERT_EQ (lines.size (), 1);
+    EXPECT_EQ (lines[0], std::string (LogRecord::PayloadSize - sizeof (uint16_t), 'x'));
+}
+
+TEST (DebugPrintTest, disabledLevelsAreNotEvaluated) {
+    static_assert (!DebugPrint::enabled (LogLevel::Trace));
+    static_assert (DebugPrint::enabled (LogLevel::Debug));
+    CapturedOutput output;
+    int evaluated = 0;
+    DEBUGPRINT_LOG (LogLevel::Trace, "trace ", ++evaluated);
+    DEBUGPRINT_LOG (LogLevel::Info, "info ", ++evaluated);
+    EXPECT_EQ (evaluated, 1);
+    const auto lines = output.lines ();
+    ASSERT_EQ (lines.size (), 1);
+    EXPECT_EQ (lines[0], "info 1");
+}
+
+TEST (DebugPrintTest, keepsPerThreadOrderUnderLoad) {
+    constexpr int Threads = 4;
+    // More lines than a thread's queue holds, so producers also exercise the full-queue path.
+    constexpr int PerThread = 3 * static_cast<int> (datastructure::AsyncLogger::QueueCapacity);
+    CapturedOutput output;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < Threads; t++) {
+        threads.emplace_back ([t] {
+            for (int i = 0; i < PerThread; i++) {
+                DebugPrint::printLine (t, " ", i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+
+    const auto lines = output.lines ();
+    ASSERT_EQ (lines.size (), Threads * PerThread);
+    std::vector<int> next (Threads, 0);
+    for (const auto& line : lines) {
+        std::istringstream is (line);
+        int t = 0;
+        int i = 0;
+        is >> t >> i;
+        ASSERT_EQ (i, next[t]) << "thread " << t;
+        next[t]++;
+    }
+}
+
+TEST (DebugPrintTest, exitedThreadsGiveUpTheirQueues) {
+    CapturedOutput output;
+    DebugPrint::printLine ("main");
+    const size_t queues = AsyncLogger::instance ().queueCount ();
+    for (int round = 0; round < 8; round++) {
+        std::thread ([round] { DebugPrint::printLine ("round ", round); }).join ();
+    }
+    // Everything the exited threads logged is still written before their queues go.
+    const auto lines = output.lines ();
+    ASSERT_EQ (lines.size (), 9);
+    EXPECT_EQ (lines.back (), "round 7");
+    EXPECT_EQ (AsyncLogger::instance ().queueCount (), queues);
+}
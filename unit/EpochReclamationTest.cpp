@@ -0,0 +1,317 @@
+#include <gtest/gtest.h>
+
+#include <EpochReclamation.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+using namespace inplace;
+
+namespace {
+std::atomic<int> freed = 0;
+
+struct Counted {
+    ~Counted () {
+        freed.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    uint64_t value = 0;
+};
+
+void collectRounds (EpochDomain& domain) {
+    for (int round = 0; round < 3; round++) {
+        domain.collect ();
+    }
+}
+
+// Treiber stack whose popped nodes go through the domain.
+class Stack {
+    struct Node {
+        uint64_t value;
+        Node* next;
+    };
+
+    public:
+    explicit Stack (EpochDomain& domain) : d_domain (domain) {
+    }
+
+    ~Stack () {
+        for (Node* node = d_head.load (); node != nullptr;) {
+            delete std::exchange (node, node->next);
+        }
+    }
+
+    void push (uint64_t value) {
+        Node* node = new Node{ value, d_head.load (std::memory_order_relaxed) };
+        while (!d_head.compare_exchange_weak (node->next, node, std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+        }
+    }
+
+    bool pop (uint64_t& value) {
+        auto guard = d_domain.pin ();
+        Node* node = d_head.load (std::memory_order_acquire);
+        while (node != nullptr && !d_head.compare_exchange_weak (node, node->next,
+                                                                 std::memory_order_acquire,
+                                                                 std::memory_order_acquire)) {
+        }
+        if (node == nullptr) {
+            return false;
+        }
+        value = node->value;
+        d_domain.retire (node);
+        return true;
+    }
+
+    private:
+    EpochDomain& d_domain;
+    std::atomic<Node*> d_head = nullptr;
+};
+}  // namespace
+
+TEST (EpochReclamationTest, freesAfterTheGracePeriod) {
+    freed = 0;
+    EpochDomain domain;
+    {
+        auto guard = domain.pin ();
+        auto nested = domain.pin ();
+        domain.retire (new Counted ());
+        collectRounds (domain);
+        // Pinned at the retirement epoch, the caller itself holds it back.
+        EXPECT_EQ (freed.load (), 0);
+        EXPECT_EQ (domain.pendingCount (), 1);
+    }
+    collectRounds (domain);
+    EXPECT_EQ (freed.load (), 1);
+    EXPECT_EQ (domain.retiredCount (), 1);
+    EXPECT_EQ (domain.reclaimedCount (), 1);
+    EXPECT_GE (domain.epoch (), 2);
+}
+
+TEST (EpochReclamationTest, pinnedThreadHoldsBackOthers) {
+    freed = 0;
+    EpochDomain domain;
+    std::atomic<bool> pinned = false;
+    std::atomic<bool> release = false;
+    std::thread reader ([&] {
+        auto guard = domain.pin ();
+        pinned = true;
+        while (!release) {
+            std::this_thread::yield ();
+        }
+    });
+    while (!pinned) {
+        std::this_thread::yield ();
+    }
+    domain.retire (new Counted ());
+    collectRounds (domain);
+    EXPECT_EQ (freed.load (), 0);
+    release = true;
+    reader.join ();
+    collectRounds (domain);
+    EXPECT_EQ (freed.load (), 1);
+}
+
+TEST (EpochReclamationTest, hazardPointerOutlivesTheEpoch) {
+    freed = 0;
+    EpochDomain domain;
+    std::atomic<Counted*> shared = new Counted{ .value = 42 };
+    std::atomic<bool> held = false;
+    std::atomic<bool> done = false;
+    std::atomic<uint64_t> seen = 0;
+    std::thread reader ([&] {
+        // No pin: only the hazard pointer keeps the node alive.
+        auto hazard = domain.hazardPointer ();
+        Counted* node = hazard.protect (shared);
+        held = true;
+        while (!done) {
+            std::this_thread::yield ();
+        }
+        seen = node->value;
+        hazard.reset ();
+    });
+    while (!held) {
+        std::this_thread::yield ();
+    }
+    domain.retire (shared.exchange (nullptr));
+    collectRounds (domain);
+    EXPECT_EQ (freed.load (), 0);
+    EXPECT_EQ (domain.pendingCount (), 1);
+    done = true;
+    reader.join ();
+    EXPECT_EQ (seen.load (), 42);
+    collectRounds (domain);
+    EXPECT_EQ (freed.load (), 1);
+}
+
+TEST (EpochReclamationTest, hazardSlotsRunOut) {
+    EpochDomain domain;
+    std::vector<EpochDomain::HazardPointer> hazards;
+    for (size_t i = 0; i < EpochDomain::HazardSlots; i++) {
+        hazards.push_back (domain.hazardPointer ());
+    }
+    EXPECT_THROW ((void)domain.hazardPointer (), std::length_error);
+    hazards.pop_back ();
+    EXPECT_NO_THROW ((void)domain.hazardPointer ());
+}
+
+TEST (EpochReclamationTest, exitedThreadsHandOverTheirRetirements) {
+    freed = 0;
+    {
+        EpochDomain domain;
+        std::thread retirer ([&] {
+            for (int i = 0; i < 10; i++) {
+                domain.retire (new Counted ());
+            }
+        });
+        retirer.join ();
+        EXPECT_EQ (freed.load (), 0);
+        collectRounds (domain);
+        EXPECT_EQ (freed.load (), 10);
+
+        // The record of the exited thread is recycled by the next one.
+        std::thread next ([&] { domain.retire (new Counted ()); });
+        next.join ();
+    }
+    // The rest goes when the domain does.
+    EXPECT_EQ (freed.load (), 11);
+}
+
+TEST (EpochReclamationTest, orphansFreeInEpochOrder) {
+    freed = 0;
+    EpochDomain domain;
+    std::atomic<bool> retired = false;
+    std::atomic<bool> exit = false;
+    // Retires early and exits last, so its node lands behind a newer one among the orphans.
+    std::thread early ([&] {
+        domain.retire (new Counted ());
+        retired = true;
+        while (!exit) {
+            std::this_thread::yield ();
+        }
+    });
+    while (!retired) {
+        std::this_thread::yield ();
+    }
+    collectRounds (domain);
+    std::thread late ([&] { domain.retire (new Counted ()); });
+    late.join ();
+    exit = true;
+    early.join ();
+    // One more epoch frees the early node, not yet the late one.
+    domain.collect ();
+    EXPECT_EQ (freed.load (), 1);
+    collectRounds (domain);
+    EXPECT_EQ (freed.load (), 2);
+}
+
+TEST (EpochReclamationTest, threadDropsRecordsOfDestroyedDomains) {
+    std::thread user ([] {
+        for (int i = 0; i < 100; i++) {
+            EpochDomain domain;
+            auto guard = domain.pin ();
+        }
+        // Only the last domain's entry is left until the thread uses another domain.
+        EXPECT_LE (EpochDomain::threadRecordCount (), 1);
+    });
+    user.join ();
+}
+
+TEST (EpochReclamationTest, stackStress) {
+    EpochDomain domain;
+    constexpr uint64_t PerThread = 20000;
+    constexpr int Threads = 4;
+    std::atomic<uint64_t> popped = 0;
+    std::atomic<uint64_t> sum = 0;
+    {
+        Stack stack (domain);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < Threads; t++) {
+            threads.emplace_back ([&, t] {
+                uint64_t localSum = 0;
+                uint64_t localPopped = 0;
+                for (uint64_t i = 0; i < PerThread; i++) {
+                    stack.push (t * PerThread + i);
+                    uint64_t value;
+                    if (stack.pop (value)) {
+                        localSum += value;
+                        localPopped++;
+                    }
+                }
+                sum += localSum;
+                popped += localPopped;
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join ();
+        }
+        uint64_t value;
+        while (stack.pop (value)) {
+            sum += value;
+            popped++;
+        }
+    }
+    const uint64_t total = Threads * PerThread;
+    EXPECT_EQ (popped.load (), total);
+    EXPECT_EQ (sum.load (), total * (total - 1) / 2);
+    EXPECT_EQ (domain.retiredCount (), total);
+    // Quiescent now: what the exited threads left behind goes too.
+    collectRounds (domain);
+    EXPECT_EQ (domain.pendingCount (), 0);
+}
+
+TEST (EpochReclamationTest, hazardStress) {
+    // Readers protect the current node while this thread keeps replacing and retiring it; a retired
+    // node is only marked dead, so a reader can tell whether one was reclaimed under it.
+    struct Node {
+        std::atomic<bool> dead = false;
+        uint64_t value = 0;
+    };
+    std::mutex graveyardMutex;
+    std::vector<std::unique_ptr<Node>> buried;
+    static std::vector<std::unique_ptr<Node>>* graveyard = nullptr;
+    static std::mutex* graveyardLock = nullptr;
+    graveyard = &buried;
+    graveyardLock = &graveyardMutex;
+    // Declared last: its destructor still buries what is pending.
+    EpochDomain domain;
+    auto bury = [] (void* node) {
+        static_cast<Node*> (node)->dead.store (true, std::memory_order_relaxed);
+        std::lock_guard lock (*graveyardLock);
+        graveyard->emplace_back (static_cast<Node*> (node));
+    };
+
+    std::atomic<Node*> current = new Node ();
+    std::atomic<bool> done = false;
+    std::atomic<uint64_t> violations = 0;
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; r++) {
+        readers.emplace_back ([&] {
+            auto hazard = domain.hazardPointer ();
+            while (!done.load (std::memory_order_relaxed)) {
+                Node* node = hazard.protect (current);
+                for (int i = 0; i < 16; i++) {
+                    if (node->dead.load (std::memory_order_relaxed)) {
+                        violations.fetch_add (1, std::memory_order_relaxed);
+                    }
+                }
+                hazard.reset ();
+            }
+        });
+    }
+    for (uint64_t i = 0; i < 20000; i++) {
+        Node* fresh = new Node ();
+        fresh->value = i;
+        domain.retire (current.exchange (fresh), bury);
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join ();
+    }
+    EXPECT_EQ (violations.load (), 0);
+    EXPECT_GT (domain.reclaimedCount (), 0);
+    delete current.load ();
+}
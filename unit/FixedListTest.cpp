@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <FixedList.h>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+using namespace inplace;
+
+namespace {
+template <class List>
+std::vector<int> contents (List& list) {
+    std::vector<int> values;
+    list.for_each ([&values] (auto, int& value) { values.push_back (value); });
+    return values;
+}
+}  // namespace
+
+TEST (FixedListTest, pushUnlinkAndMove) {
+    FixedList<int, 4> list;
+    EXPECT_EQ (list.capacity (), 4);
+    auto two = list.push_back (2);
+    auto one = list.push_front (1);
+    auto three = list.emplace_back (3);
+    ASSERT_TRUE (one && two && three);
+    EXPECT_EQ (contents (list), (std::vector<int>{ 1, 2, 3 }));
+    EXPECT_EQ (list.front (), one);
+    EXPECT_EQ (list.back (), three);
+
+    EXPECT_EQ (list.move_to_front (*three), true);
+    EXPECT_EQ (contents (list), (std::vector<int>{ 3, 1, 2 }));
+    EXPECT_EQ (list.move_to_back (*three), true);
+    EXPECT_EQ (contents (list), (std::vector<int>{ 1, 2, 3 }));
+
+    EXPECT_EQ (list.unlink (*two), true);
+    EXPECT_EQ (list.unlink (*two), false);
+    EXPECT_EQ (list.get (*two), nullptr);
+    EXPECT_EQ (*list.get (*one), 1);
+    EXPECT_EQ (list.visit (*three, [] (int& value) { value = 30; }), true);
+    EXPECT_EQ (contents (list), (std::vector<int>{ 1, 30 }));
+    EXPECT_EQ (list.size (), 2);
+
+    int popped = 0;
+    EXPECT_EQ (list.pop_back ([&popped] (int& value) { popped = value; }), true);
+    EXPECT_EQ (popped, 30);
+    EXPECT_EQ (list.pop_front ([&popped] (int& value) { popped = value; }), true);
+    EXPECT_EQ (popped, 1);
+    EXPECT_EQ (list.pop_front ([] (int&) { FAIL (); }), false);
+    EXPECT_EQ (list.empty (), true);
+    EXPECT_EQ (list.front (), std::nullopt);
+}
+
+TEST (FixedListTest, fullListAndReusedNodes) {
+    FixedList<std::string, 2> list;
+    auto a = list.push_back ("a");
+    auto b = list.push_back ("b");
+    EXPECT_EQ (list.full (), true);
+    EXPECT_EQ (list.push_back ("c"), std::nullopt);
+
+    // The freed node is handed out again; the old handle stays dead.
+    ASSERT_TRUE (list.unlink (*a));
+    auto c = list.push_front ("c");
+    ASSERT_TRUE (c);
+    EXPECT_NE (c, a);
+    EXPECT_EQ (list.get (*a), nullptr);
+    EXPECT_EQ (list.move_to_back (*a), false);
+    EXPECT_EQ (*list.get (*c), "c");
+    EXPECT_EQ (*list.get (*b), "b");
+}
+
+TEST (FixedListTest, destroysElements) {
+    auto tracker = std::make_shared<int> (0);
+    {
+        FixedList<std::shared_ptr<int>, 8> list;
+        for (int i = 0; i < 5; i++) {
+            list.push_back (tracker);
+        }
+        list.pop_front ([] (std::shared_ptr<int>&) {});
+        list.unlink (*list.back ());
+        EXPECT_EQ (tracker.use_count (), 4);
+    }
+    EXPECT_EQ (tracker.use_count (), 1);
+}
+
+TEST (FixedListTest, throwingPopFreesTheNode) {
+    auto tracker = std::make_shared<int> (0);
+    FixedList<std::shared_ptr<int>, 2> list;
+    for (int round = 0; round < 4; round++) {
+        ASSERT_TRUE (list.push_back (tracker));
+        ASSERT_TRUE (list.push_back (tracker));
+        EXPECT_THROW (list.pop_front ([] (std::shared_ptr<int>&) { throw std::runtime_error ("pop"); }),
+                      std::runtime_error);
+        EXPECT_THROW (list.pop_back ([] (std::shared_ptr<int>&) { throw std::runtime_error ("pop"); }),
+                      std::runtime_error);
+        // Both elements are destroyed and both nodes are free again.
+        EXPECT_EQ (tracker.use_count (), 1);
+        EXPECT_EQ (list.empty (), true);
+    }
+}
+
+TEST (FixedListTest, lruCache) {
+    // Allocation-free LRU: the list keeps recency, the map points into it.
+    struct Entry {
+        int key = 0;
+        int value = 0;
+    };
+    FixedList<Entry, 3> recency;
+    std::unordered_map<int, FixedList<Entry, 3>::Handle> index;
+    auto put = [&] (int key, int value) {
+        if (recency.full ()) {
+            recency.pop_back ([&index] (Entry& evicted) { index.erase (evicted.key); });
+        }
+        index[key] = *recency.push_front (Entry{ key, value });
+    };
+    auto get = [&] (int key) {
+        auto it = index.find (key);
+        if (it == index.end ()) {
+            return -1;
+        }
+        recency.move_to_front (it->second);
+        return recency.get (it->second)->value;
+    };
+    put (1, 10);
+    put (2, 20);
+    put (3, 30);
+    EXPECT_EQ (get (1), 10);
+    put (4, 40);
+    EXPECT_EQ (get (2), -1);
+    EXPECT_EQ (get (3), 30);
+    EXPECT_EQ (get (1), 10);
+    EXPECT_EQ (get (4), 40);
+}
+
+TEST (FixedListTest, concurrentInsertAndUnlink) {
+    constexpr size_t Capacity = 64;
+    constexpr int Rounds = 20000;
+    ConcurrentFixedList<int, Capacity> list;
+    std::atomic<int> failedInserts = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back ([&, t] {
+            std::vector<ConcurrentFixedList<int, Capacity>::Handle> mine;
+            for (int i = 0; i < Rounds; i++) {
+                auto handle = (i % 2 == 0) ? list.push_back (t) : list.push_front (t);
+                if (!handle) {
+                    failedInserts.fetch_add (1, std::memory_order_relaxed);
+                } else {
+                    mine.push_back (*handle);
+                }
+                if (mine.size () > 8 || (!handle && !mine.empty ())) {
+                    // Every handle is ours alone, so it must still be live.
+                    EXPECT_EQ (list.move_to_front (mine.back ()), true);
+                    EXPECT_EQ (list.unlink (mine.front ()), true);
+                    mine.erase (mine.begin ());
+                }
+                if (!mine.empty ()) {
+                    list.visit (mine.back (), [t] (int& value) { EXPECT_EQ (value, t); });
+                }
+            }
+            for (auto handle : mine) {
+                EXPECT_EQ (list.unlink (handle), true);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+    EXPECT_EQ (list.size (), 0);
+    EXPECT_EQ (contents (list).size (), 0);
+    // Every node went back to the free-list.
+    for (size_t i = 0; i < Capacity; i++) {
+        ASSERT_TRUE (list.push_back (static_cast<int> (i)));
+    }
+    EXPECT_EQ (list.push_back (0), std::nullopt);
+}
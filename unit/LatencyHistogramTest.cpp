@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <LatencyHistogram.hpp>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace inplace;
+
+TEST (LatencyHistogramTest, bucketsBoundTheirValues) {
+    using Histogram = LogLinearHistogram<7>;
+    const std::vector<uint64_t> values{ 0,    1,     127,     128,         129,
+                                        255,  256,   1000,    12345,       1 << 20,
+                                        987654321ULL, std::numeric_limits<uint64_t>::max () };
+    for (uint64_t value : values) {
+        const size_t bucket = Histogram::bucketOf (value);
+        ASSERT_LT (bucket, Histogram::BucketCount);
+        EXPECT_LE (Histogram::lowestValueOf (bucket), value);
+        EXPECT_GE (Histogram::highestValueOf (bucket), value);
+        // Relative precision of 2^-6 at every magnitude.
+        const uint64_t width = Histogram::highestValueOf (bucket) - Histogram::lowestValueOf (bucket);
+        EXPECT_LE (width, Histogram::lowestValueOf (bucket) / 64);
+    }
+    EXPECT_EQ (Histogram::bucketOf (std::numeric_limits<uint64_t>::max ()),
+               Histogram::BucketCount - 1);
+    for (size_t bucket = 1; bucket < Histogram::BucketCount; bucket++) {
+        ASSERT_EQ (Histogram::lowestValueOf (bucket), Histogram::highestValueOf (bucket - 1) + 1);
+    }
+}
+
+TEST (LatencyHistogramTest, percentiles) {
+    LogLinearHistogram<> histogram;
+    EXPECT_EQ (histogram.valueAtPercentile (50.0), 0);
+    EXPECT_EQ (histogram.min (), 0);
+    for (uint64_t value = 1; value <= 100; value++) {
+        histogram.record (value);
+    }
+    EXPECT_EQ (histogram.count (), 100);
+    EXPECT_EQ (histogram.min (), 1);
+    EXPECT_EQ (histogram.max (), 100);
+    EXPECT_DOUBLE_EQ (histogram.mean (), 50.5);
+    // Below 2^7 every value has its own bucket, so these are exact.
+    EXPECT_EQ (histogram.valueAtPercentile (50.0), 50);
+    EXPECT_EQ (histogram.valueAtPercentile (99.0), 99);
+    EXPECT_EQ (histogram.valueAtPercentile (100.0), 100);
+    EXPECT_EQ (histogram.valueAtPercentile (0.0), 1);
+
+    histogram.record (1'000'000, 10);
+    const uint64_t tail = histogram.valueAtPercentile (99.99);
+    EXPECT_GE (tail, 1'000'000);
+    EXPECT_LE (tail, 1'000'000 + 1'000'000 / 64);
+    EXPECT_EQ (histogram.valueAtPercentile (100.0), 1'000'000);
+}
+
+TEST (LatencyHistogramTest, mergeAndReset) {
+    LogLinearHistogram<> a;
+    LogLinearHistogram<> b;
+    a.record (10);
+    b.record (5000, 3);
+    a.merge (b);
+    EXPECT_EQ (a.count (), 4);
+    EXPECT_EQ (a.min (), 10);
+    EXPECT_EQ (a.max (), 5000);
+    EXPECT_EQ (a.sum (), 15010);
+    a.reset ();
+    EXPECT_EQ (a.count (), 0);
+    EXPECT_EQ (a.max (), 0);
+    EXPECT_EQ (a.valueAtPercentile (99.0), 0);
+}
+
+TEST (LatencyHistogramTest, writesCsv) {
+    LogLinearHistogram<> histogram;
+    histogram.record (3);
+    histogram.record (3);
+    histogram.record (7);
+    std::ostringstream os;
+    histogram.writeCsv (os);
+    EXPECT_EQ (os.str (), "lowest,highest,count,cumulative_percentile\n"
+                          "3,3,2,66.6667\n"
+                          "7,7,1,100\n");
+}
+
+TEST (LatencyHistogramTest, concurrentRecording) {
+    ConcurrentLogLinearHistogram<> histogram;
+    constexpr uint64_t PerThread = 10000;
+    std::vector<std::thread> threads;
+    for (uint64_t t = 0; t < 4; t++) {
+        threads.emplace_back ([&histogram, t] {
+            for (uint64_t i = 0; i < PerThread; i++) {
+                histogram.record (t * PerThread + i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+    EXPECT_EQ (histogram.count (), 4 * PerThread);
+    EXPECT_EQ (histogram.min (), 0);
+    EXPECT_EQ (histogram.max (), 4 * PerThread - 1);
+
+    LogLinearHistogram<> copy;
+    copy.merge (histogram);
+    EXPECT_EQ (copy.count (), histogram.count ());
+    EXPECT_EQ (copy.valueAtPercentile (50.0), histogram.valueAtPercentile (50.0));
+}
@@ -5,9 +5,13 @@
 #include <CommonTestUtils.hpp>
 #include <MPMCQueue.hpp>
 #include <Signal.hpp>
+#include <atomic>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
 #include <type_traits>
+#include <vector>
 using namespace inplace;
 
 
@@ -570,4 +574,430 @@ TEST (MPMCQueueTest, DISABLED_4P4CTestOnSmallQ) {
     for (size_t i = 0; i < size; i++) {
         EXPECT_EQ (ALLElements[i], ReadElements[i]);
     }
-}
\ No newline at end of file
+}
+TEST (MPMCQueueTest, bulkEnqueueDequeue) {
+    constexpr const size_t QSize = 8;
+    inplace::MPMCQueue<DistortedStruct, QSize, false> q;
+    std::vector<DistortedStruct> vecWriter;
+    std::vector<DistortedStruct> vecReader;
+    for (size_t i = 0; i < 2 * QSize; i++) {
+        vecWriter.push_back (DistortedStruct{ i, i, std::make_shared<int> (i), "ak", { i } });
+    }
+
+    EXPECT_EQ (q.enqueueBulk (std::span (vecWriter).first (5)), 5);
+    EXPECT_EQ (q.dequeueBulk (5, [&vecReader](std::span<DistortedStruct> batch) {
+        vecReader.insert (vecReader.end (), batch.begin (), batch.end ());
+    }), 5);
+
+    EXPECT_EQ (q.enqueueBulk (std::span (vecWriter).subspan (5)), QSize);
+    EXPECT_EQ (q.full (), true);
+    EXPECT_EQ (q.enqueueBulk (std::span (vecWriter).subspan (5)), 0);
+
+    EXPECT_EQ (q.dequeueBulk (64, [&vecReader](std::span<DistortedStruct> batch) {
+        vecReader.insert (vecReader.end (), batch.begin (), batch.end ());
+    }), QSize);
+    EXPECT_EQ (q.empty (), true);
+    EXPECT_EQ (q.dequeueBulk (64, [](std::span<DistortedStruct>) {}), 0);
+
+    EXPECT_EQ (vecReader.size (), 5 + QSize);
+    for (size_t i = 0; i < vecReader.size (); i++) {
+        EXPECT_EQ (vecReader.at (i), vecWriter.at (i));
+    }
+}
+
+TEST (MPMCQueueTest, bulkEnqueueSkipsAfterAThrowingCopy) {
+    auto ptr = std::make_shared<int> (1);
+    std::vector<CopyThrowingPayload> batch;
+    batch.reserve (3);
+    batch.emplace_back (ptr, false);
+    batch.emplace_back (ptr, false);
+    batch.emplace_back (ptr, true);
+    {
+        MPMCQueue<CopyThrowingPayload, 8> q;
+        EXPECT_THROW (q.enqueueBulk (batch), std::runtime_error);
+        // The copies made before the throw are delivered, and the queue keeps working.
+        EXPECT_EQ (q.enqueue (CopyThrowingPayload (ptr, false)), true);
+        size_t read = 0;
+        while (q.dequeue ([&read] (const CopyThrowingPayload&) { read++; })) {
+        }
+        EXPECT_EQ (read, 3);
+        EXPECT_EQ (q.empty (), true);
+        EXPECT_EQ (q.enqueueBulk (std::span (batch).first (2)), 2);
+        EXPECT_EQ (ptr.use_count (), 6);
+    }
+    EXPECT_EQ (ptr.use_count (), 4);
+}
+
+TEST (MPMCQueueTest, waitTimesOutAndWakes) {
+    inplace::MPMCQueue<size_t, 2, false, WaitStrategy1, NoQueueStats, PackedSlots, Blocking> q;
+    const auto begin = std::chrono::steady_clock::now ();
+    EXPECT_EQ (q.dequeueWait (std::chrono::milliseconds (20), [](const size_t&) {}), false);
+    EXPECT_GE (std::chrono::steady_clock::now () - begin, std::chrono::milliseconds (20));
+
+    size_t read = 0;
+    std::thread reader ([&q, &read] {
+        EXPECT_EQ (q.dequeueWait (std::chrono::seconds (10), [&read](const size_t& x) {
+            read = x;
+        }), true);
+    });
+    std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    EXPECT_EQ (q.enqueueWait (std::chrono::seconds (1), 42ul), true);
+    reader.join ();
+    EXPECT_EQ (read, 42);
+
+    std::thread stopped ([&q] {
+        EXPECT_EQ (q.dequeueWait (std::chrono::seconds (10), [](const size_t&) {}), false);
+    });
+    std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    q.stop ();
+    stopped.join ();
+}
+
+TEST (MPMCQueueTest, racingWaitsHonourTheTimeout) {
+    // Producers race for the last slot of a queue nobody drains. Only one may get it; the others
+    // must time out rather than take an index and wait for a consumer.
+    constexpr int Producers = 8;
+    for (int round = 0; round < 20; round++) {
+        inplace::MPMCQueue<size_t, 1, false, WaitStrategy1, NoQueueStats, PackedSlots, Blocking> q;
+        std::atomic<int> finished = 0;
+        std::atomic<int> enqueued = 0;
+        std::vector<std::thread> producers;
+        for (int p = 0; p < Producers; p++) {
+            producers.emplace_back ([&q, &finished, &enqueued, p] {
+                if (q.enqueueWait (std::chrono::milliseconds (5), static_cast<size_t> (p))) {
+                    enqueued.fetch_add (1);
+                }
+                finished.fetch_add (1);
+            });
+        }
+        const auto deadline = std::chrono::steady_clock::now () + std::chrono::seconds (5);
+        while (finished.load () < Producers && std::chrono::steady_clock::now () < deadline) {
+            std::this_thread::sleep_for (std::chrono::milliseconds (1));
+        }
+        EXPECT_EQ (finished.load (), Producers);
+        // Releases the waits that ignored their timeout.
+        q.stop ();
+        for (auto& producer : producers) {
+            producer.join ();
+        }
+        EXPECT_EQ (enqueued.load (), 1);
+    }
+}
+
+TEST (MPMCQueueTest, racingDequeuesDoNotWait) {
+    // Consumers race for the only element. One gets it; the others must report an empty queue
+    // rather than take an index and wait for a producer.
+    constexpr int Consumers = 8;
+    for (int round = 0; round < 20; round++) {
+        MPMCQueue<size_t, 4> q;
+        ASSERT_EQ (q.enqueue (size_t{ 1 }), true);
+        std::atomic<int> finished = 0;
+        std::atomic<int> dequeued = 0;
+        std::vector<std::thread> consumers;
+        for (int c = 0; c < Consumers; c++) {
+            consumers.emplace_back ([&q, &finished, &dequeued] {
+                if (q.tryDequeue ().has_value ()) {
+                    dequeued.fetch_add (1);
+                }
+                finished.fetch_add (1);
+            });
+        }
+        const auto deadline = std::chrono::steady_clock::now () + std::chrono::seconds (5);
+        while (finished.load () < Consumers && std::chrono::steady_clock::now () < deadline) {
+            std::this_thread::sleep_for (std::chrono::milliseconds (1));
+        }
+        EXPECT_EQ (finished.load (), Consumers);
+        // Releases the dequeues that waited for a producer.
+        q.stop ();
+        for (auto& consumer : consumers) {
+            consumer.join ();
+        }
+        EXPECT_EQ (dequeued.load (), 1);
+    }
+}
+
+TEST (MPMCQueueTest, stoppedBulkEnqueueReturns) {
+    // The open claim holds slot 0, so the batch stops at slot 0 on the second lap, and its
+    // commit waits for the claim. stop () releases both waits.
+    MPMCQueue<size_t, 2> q;
+    auto claim = q.tryClaim ();
+    ASSERT_TRUE (claim);
+    std::thread bulk ([&q] {
+        EXPECT_EQ (q.enqueueBulk (std::vector<size_t>{ 1, 2 }), 1);
+    });
+    std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    q.stop ();
+    bulk.join ();
+}
+
+namespace {
+// Counts how often the queue backs off through its wait strategy.
+struct CountingWaitStrategy {
+    static inline std::atomic<size_t> waits = 0;
+
+    bool wait () {
+        waits.fetch_add (1, std::memory_order_relaxed);
+        std::this_thread::yield ();
+        return true;
+    }
+
+    void reset () {
+    }
+};
+}  // namespace
+
+TEST (MPMCQueueTest, commitWaitDoesNotBackOffThroughStrategy) {
+    // The enqueue takes slot 1 straight away and then waits for the open claim on slot 0 to
+    // commit. That wait spins and yields; it never goes through the (possibly sleeping) Strategy.
+    MPMCQueue<size_t, 4, false, CountingWaitStrategy> q;
+    CountingWaitStrategy::waits = 0;
+    auto claim = q.tryClaim ();
+    ASSERT_TRUE (claim);
+    std::thread producer ([&q] {
+        EXPECT_EQ (q.enqueue (size_t{ 2 }), true);
+    });
+    std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    claim.emplace (size_t{ 1 });
+    claim.commit ();
+    producer.join ();
+    EXPECT_EQ (CountingWaitStrategy::waits.load (), 0);
+    EXPECT_EQ (q.tryDequeue (), std::optional<size_t> (1));
+    EXPECT_EQ (q.tryDequeue (), std::optional<size_t> (2));
+}
+
+TEST (MPMCQueueTest, dynamicCapacity) {
+    MPMCQueue<DistortedStruct, DYNAMIC_CAPACITY> q (35, { HugePages::Transparent, true });
+    EXPECT_EQ (q.capacity (), 35);
+    std::vector<DistortedStruct> vecWriter;
+    std::vector<DistortedStruct> vecReader;
+    for (size_t i = 0; i < 35; i++) {
+        vecWriter.push_back (DistortedStruct{ i, i, std::make_shared<int> (i), "ak", { i } });
+        EXPECT_EQ (q.enqueue (vecWriter.back ()), true);
+    }
+    EXPECT_EQ (q.full (), true);
+    EXPECT_EQ (q.enqueue (vecWriter.back ()), false);
+    while (!q.empty ()) {
+        EXPECT_EQ (q.dequeue ([&vecReader](const auto& x) { vecReader.push_back (x); }), true);
+    }
+    EXPECT_EQ (vecReader, vecWriter);
+}
+
+TEST (MPMCQueueTest, claimAndPeekInPlace) {
+    MPMCQueue<DistortedStruct, 2> q;
+    auto slot = q.tryClaim ();
+    ASSERT_TRUE (slot);
+    slot.emplace (DistortedStruct{ 1, 1, std::make_shared<int> (1), "ak", { 1 } });
+    slot.commit ();
+    {
+        auto abandoned = q.tryClaim ();
+        ASSERT_TRUE (abandoned);
+    }
+    EXPECT_EQ (q.full (), true);
+    EXPECT_FALSE (q.tryClaim ());
+
+    auto view = q.tryPeek ();
+    ASSERT_TRUE (view);
+    EXPECT_EQ (view->x, 1);
+    view.release ();
+    // The abandoned claim is stepped over, not delivered.
+    EXPECT_FALSE (q.tryPeek ());
+    EXPECT_EQ (q.empty (), true);
+}
+
+TEST (MPMCQueueTest, abandonedClaimsAreSkipped) {
+    // No default constructor needed: nothing is published for an abandoned claim.
+    MPMCQueue<MoveOnlyPayload, 4> q;
+    {
+        auto abandoned = q.tryClaim ();
+        ASSERT_TRUE (abandoned);
+    }
+    auto slot = q.tryClaim ();
+    ASSERT_TRUE (slot);
+    slot.emplace (1);
+    slot.commit ();
+    {
+        auto abandoned = q.tryClaim ();
+        ASSERT_TRUE (abandoned);
+    }
+    EXPECT_EQ (q.enqueue (MoveOnlyPayload (2)), true);
+    EXPECT_EQ (q.dequeue ([](const MoveOnlyPayload& x) { EXPECT_EQ (*x.d_value, 1); }), true);
+    EXPECT_EQ (q.dequeue ([](const MoveOnlyPayload& x) { EXPECT_EQ (*x.d_value, 2); }), true);
+    EXPECT_EQ (q.empty (), true);
+
+    // A batch drops skipped slots; one of nothing but skipped slots goes on to the next.
+    for (size_t i = 0; i < 3; i++) {
+        auto abandoned = q.tryClaim ();
+        ASSERT_TRUE (abandoned);
+    }
+    EXPECT_EQ (q.enqueue (MoveOnlyPayload (3)), true);
+    std::vector<size_t> read;
+    EXPECT_EQ (q.dequeueBulk (2, [&read](std::span<MoveOnlyPayload> batch) {
+        for (auto& x : batch) {
+            read.push_back (*x.d_value);
+        }
+    }), 1);
+    EXPECT_EQ (read, std::vector<size_t>{ 3 });
+    EXPECT_EQ (q.empty (), true);
+    EXPECT_EQ (q.dequeueBulk (2, [](std::span<MoveOnlyPayload>) {}), 0);
+}
+
+TEST (MPMCQueueTest, droppedClaimDestroysItsElement) {
+    auto ptr = std::make_shared<int> (1);
+    {
+        MPMCQueue<std::shared_ptr<int>, 4> q;
+        {
+            auto slot = q.tryClaim ();
+            ASSERT_TRUE (slot);
+            slot.emplace (ptr);
+            EXPECT_EQ (ptr.use_count (), 2);
+        }
+        EXPECT_EQ (ptr.use_count (), 1);
+        {
+            auto slot = q.tryClaim ();
+            ASSERT_TRUE (slot);
+            ::new (slot.ptr ()) std::shared_ptr<int> (ptr);
+            slot.constructed ();
+        }
+        EXPECT_EQ (ptr.use_count (), 1);
+        auto slot = q.tryClaim ();
+        ASSERT_TRUE (slot);
+        slot.emplace (ptr);
+        slot.commit ();
+        EXPECT_EQ (ptr.use_count (), 2);
+    }
+    EXPECT_EQ (ptr.use_count (), 1);
+}
+
+TEST (MPMCQueueTest, destroysRemainingElements) {
+    auto ptr = std::make_shared<int> (1);
+    {
+        MPMCQueue<std::string, 8> strings;
+        MPMCQueue<std::shared_ptr<int>, 8> pointers;
+        // Leave elements on both sides of the wrap-around.
+        for (int i = 0; i < 6; i++) {
+            EXPECT_EQ (strings.enqueue (std::string (100, 'a')), true);
+            EXPECT_EQ (pointers.enqueue (ptr), true);
+        }
+        for (int i = 0; i < 4; i++) {
+            EXPECT_EQ (strings.dequeue ([](const std::string&) {}), true);
+            EXPECT_EQ (pointers.dequeue ([](const std::shared_ptr<int>&) {}), true);
+        }
+        for (int i = 0; i < 5; i++) {
+            EXPECT_EQ (strings.enqueue (std::string (100, 'b')), true);
+            EXPECT_EQ (pointers.enqueue (ptr), true);
+        }
+        EXPECT_EQ (ptr.use_count (), 8);
+    }
+    EXPECT_EQ (ptr.use_count (), 1);
+}
+
+TEST (MPMCQueueTest, tryDequeueMovesOut) {
+    MPMCQueue<MoveOnlyPayload, 2> q;
+    EXPECT_EQ (q.enqueue (MoveOnlyPayload (1)), true);
+    EXPECT_EQ (q.enqueue (MoveOnlyPayload (2)), true);
+    auto first = q.tryDequeue ();
+    ASSERT_TRUE (first.has_value ());
+    EXPECT_EQ (*first->d_value, 1);
+    MoveOnlyPayload second (0);
+    EXPECT_EQ (q.tryDequeue (second), true);
+    EXPECT_EQ (*second.d_value, 2);
+    EXPECT_FALSE (q.tryDequeue ().has_value ());
+}
+
+TEST (MPMCQueueTest, statsPolicyCounts) {
+    MPMCQueue<size_t, 4, false, WaitStrategy1, QueueStats<>> q;
+    std::vector<size_t> batch{ 1, 2, 3, 4, 5 };
+    EXPECT_EQ (q.enqueueBulk (batch), 4);
+    EXPECT_EQ (q.enqueue (size_t{ 6 }), false);
+    EXPECT_EQ (q.dequeueBulk (8, [](std::span<size_t>) {}), 4);
+    EXPECT_EQ (q.dequeue ([](const size_t&) {}), false);
+
+    const auto stats = q.stats ();
+    EXPECT_EQ (stats.enqueued, 4);
+    EXPECT_EQ (stats.dequeued, 4);
+    EXPECT_EQ (stats.fullRejections, 1);
+    EXPECT_EQ (stats.emptyRejections, 1);
+    EXPECT_EQ (stats.highWaterMark, 4);
+}
+
+TEST (MPMCQueueTest, adaptiveWaitStrategyPolicy) {
+    using Queue = MPMCQueue<size_t, 8, false, WaitStrategyAdaptive>;
+    Queue q;
+    constexpr size_t Count = 20000;
+    std::thread producer ([&q] {
+        for (size_t i = 1; i <= Count; i++) {
+            while (!q.enqueue (i)) {
+                std::this_thread::yield ();
+            }
+        }
+    });
+    size_t sum = 0;
+    for (size_t received = 0; received < Count;) {
+        if (q.dequeue ([&sum] (const size_t& value) { sum += value; })) {
+            received++;
+        } else {
+            std::this_thread::yield ();
+        }
+    }
+    producer.join ();
+    EXPECT_EQ (sum, Count * (Count + 1) / 2);
+}
+
+namespace {
+template <class Layout, class Node>
+void expectPermutation (int64_t capacity) {
+    std::vector<bool> seen (capacity, false);
+    for (int64_t slot = 0; slot < capacity; slot++) {
+        const int64_t position = Layout::template position<Node> (slot, capacity);
+        ASSERT_GE (position, 0);
+        ASSERT_LT (position, capacity);
+        ASSERT_FALSE (seen[position]);
+        seen[position] = true;
+    }
+}
+
+template <class Layout>
+void expectFifoAcrossLaps () {
+    MPMCQueue<size_t, 37, false, WaitStrategy1, NoQueueStats, Layout> q;
+    size_t next = 0;
+    for (size_t lap = 0; lap < 5; lap++) {
+        for (size_t i = 0; i < 30; i++) {
+            ASSERT_EQ (q.enqueue (lap * 30 + i), true);
+        }
+        for (size_t i = 0; i < 30; i++) {
+            ASSERT_EQ (q.dequeue ([&next] (const size_t& value) { EXPECT_EQ (value, next++); }), true);
+        }
+    }
+    MPMCQueue<size_t, DYNAMIC_CAPACITY, false, WaitStrategy1, NoQueueStats, Layout> dynamic (37);
+    for (size_t i = 0; i < 37; i++) {
+        ASSERT_EQ (dynamic.enqueue (i), true);
+    }
+    EXPECT_EQ (dynamic.enqueue (size_t{ 37 }), false);
+    for (size_t i = 0; i < 37; i++) {
+        ASSERT_EQ (dynamic.tryDequeue (), std::optional<size_t> (i));
+    }
+}
+}  // namespace
+
+TEST (MPMCQueueTest, slotLayouts) {
+    using Node = MPMCNode<size_t>;
+    for (int64_t capacity : { 1, 2, 3, 8, 37, 64, 1000 }) {
+        expectPermutation<PackedSlots, Node> (capacity);
+        expectPermutation<PaddedSlots<>, Node> (capacity);
+        expectPermutation<SwizzledSlots<>, Node> (capacity);
+        expectPermutation<SwizzledSlots<256>, MPMCNode<char>> (capacity);
+    }
+    // Neighbouring slots land on different lines.
+    constexpr int64_t PerLine = CACHE_LINE_SIZE / sizeof (Node);
+    if constexpr (PerLine > 1) {
+        const int64_t first = SwizzledSlots<>::position<Node> (0, 64);
+        const int64_t second = SwizzledSlots<>::position<Node> (1, 64);
+        EXPECT_NE (first / PerLine, second / PerLine);
+    }
+    static_assert (alignof (PaddedSlots<>::Cell<Node>) == CACHE_LINE_SIZE);
+    static_assert (sizeof (PackedSlots::Cell<Node>) == sizeof (Node));
+
+    expectFifoAcrossLaps<PackedSlots> ();
+    expectFifoAcrossLaps<PaddedSlots<>> ();
+    expectFifoAcrossLaps<SwizzledSlots<>> ();
+}
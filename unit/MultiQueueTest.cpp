@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include <MultiQueue.hpp>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+using namespace inplace;
+
+namespace {
+// Orders by priority only, so that equal priorities can be told apart by their payload.
+struct ByPriority {
+    bool operator() (const std::pair<int, int>& a, const std::pair<int, int>& b) const {
+        return a.first < b.first;
+    }
+};
+
+template <class Queue>
+void expectEveryElementOnce (Queue& queue) {
+    constexpr int Threads = 4;
+    constexpr int PerThread = 20000;
+    std::vector<std::atomic<int>> seen (Threads * PerThread);
+    std::atomic<int> consumed = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < Threads; t++) {
+        threads.emplace_back ([&queue, t] {
+            for (int i = 0; i < PerThread; i++) {
+                while (!queue.enqueue (t * PerThread + i)) {
+                    std::this_thread::yield ();
+                }
+            }
+        });
+        threads.emplace_back ([&queue, &seen, &consumed] {
+            while (consumed.load () < Threads * PerThread) {
+                if (!queue.dequeue ([&seen] (const int& value) { seen[value].fetch_add (1); })) {
+                    std::this_thread::yield ();
+                    continue;
+                }
+                consumed.fetch_add (1);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+    for (size_t i = 0; i < seen.size (); i++) {
+        ASSERT_EQ (seen[i].load (), 1) << "value " << i;
+    }
+    EXPECT_EQ (queue.empty (), true);
+}
+
+// Priority whose construction throws when asked to.
+struct ThrowingPriority {
+    int value = 0;
+
+    ThrowingPriority (int v, bool throws) : value (v) {
+        if (throws) {
+            throw std::runtime_error ("construct");
+        }
+    }
+
+    bool operator< (const ThrowingPriority& other) const {
+        return value < other.value;
+    }
+};
+
+// A construction that throws must not use up capacity.
+template <class Queue>
+void expectThrowingEnqueueKeepsCapacity (Queue& queue) {
+    for (int i = 0; i < 4; i++) {
+        EXPECT_THROW (queue.enqueue (i, true), std::runtime_error);
+    }
+    EXPECT_EQ (queue.empty (), true);
+    EXPECT_EQ (queue.enqueue (1, false), true);
+    EXPECT_EQ (queue.enqueue (2, false), true);
+    EXPECT_EQ (queue.full (), true);
+    EXPECT_EQ (queue.tryDequeue ()->value, 2);
+    EXPECT_EQ (queue.tryDequeue ()->value, 1);
+}
+}  // namespace
+
+TEST (MultiQueueTest, skipListIsExactAndStable) {
+    SkipListPriorityQueue<std::pair<int, int>, 1000, ByPriority> queue;
+    std::vector<int> priorities (500);
+    std::iota (priorities.begin (), priorities.end (), 0);
+    std::shuffle (priorities.begin (), priorities.end (), std::mt19937 (7));
+    for (int i = 0; i < 500; i++) {
+        EXPECT_EQ (queue.enqueue (priorities[i] / 2, i), true);
+    }
+    EXPECT_EQ (queue.size (), 500);
+
+    std::pair<int, int> previous{ 1000, -1 };
+    std::vector<int> firstSeen (250, -1);
+    for (int i = 0; i < 500; i++) {
+        auto element = queue.tryDequeue ();
+        ASSERT_TRUE (element.has_value ());
+        EXPECT_LE (element->first, previous.first);
+        if (element->first == previous.first) {
+            // Equal priorities leave in insertion order.
+            EXPECT_GT (element->second, previous.second);
+        }
+        previous = *element;
+    }
+    EXPECT_EQ (queue.tryDequeue (), std::nullopt);
+}
+
+TEST (MultiQueueTest, skipListHonoursCapacityAndCompare) {
+    SkipListPriorityQueue<int, 3, std::greater<int>> queue;
+    EXPECT_EQ (queue.enqueue (5), true);
+    EXPECT_EQ (queue.enqueue (1), true);
+    EXPECT_EQ (queue.enqueue (3), true);
+    EXPECT_EQ (queue.enqueue (4), false);
+    EXPECT_EQ (queue.full (), true);
+    EXPECT_EQ (queue.tryDequeue (), 1);
+    EXPECT_EQ (queue.tryDequeue (), 3);
+    EXPECT_EQ (queue.tryDequeue (), 5);
+    EXPECT_EQ (queue.dequeue ([] (const int&) {}), false);
+}
+
+TEST (MultiQueueTest, throwingEnqueueKeepsCapacity) {
+    MultiQueue<ThrowingPriority, 2> relaxed (1, 1);
+    expectThrowingEnqueueKeepsCapacity (relaxed);
+    SkipListPriorityQueue<ThrowingPriority, 2> exact;
+    expectThrowingEnqueueKeepsCapacity (exact);
+}
+
+TEST (MultiQueueTest, relaxedQueueReturnsEverythingRoughlyInOrder) {
+    MultiQueue<int, 4096> queue (1, 2);
+    EXPECT_EQ (queue.heapCount (), 2);
+    for (int i = 0; i < 4096; i++) {
+        EXPECT_EQ (queue.enqueue (i), true);
+    }
+    EXPECT_EQ (queue.enqueue (0), false);
+
+    // With two heaps, popping the better of both tops is exact on a single thread.
+    int previous = 4096;
+    for (int i = 0; i < 4096; i++) {
+        auto value = queue.tryDequeue ();
+        ASSERT_TRUE (value.has_value ());
+        EXPECT_LT (*value, previous);
+        previous = *value;
+    }
+    EXPECT_EQ (queue.tryDequeue (), std::nullopt);
+}
+
+TEST (MultiQueueTest, relaxedQueueUnderContention) {
+    ConcurrentPriorityQueue<int, 1 << 10, PriorityQueueMode::Relaxed> queue (8);
+    expectEveryElementOnce (queue);
+}
+
+TEST (MultiQueueTest, skipListUnderContention) {
+    ConcurrentPriorityQueue<int, 1 << 10, PriorityQueueMode::Exact> queue;
+    expectEveryElementOnce (queue);
+}
@@ -1,8 +1,12 @@
 
 
 #include <MyFunction.h>
+#include "DebugPrint.h"
 #include <gtest/gtest.h>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
 using namespace datastructure;
 
@@ -18,6 +22,10 @@ class TestData {
     void operator() () { DebugPrint::printLine ("TestData::operator()()"); }
 };
 
+// Destroyed after the main thread has handed back its pool magazines.
+MyFunction<std::size_t ()> staticFunction;
+MyFunction<std::size_t ()> otherStaticFunction;
+
 int g(const int & x) {
     std::cout << x << std::endl;
     return x;
@@ -75,3 +83,36 @@ TEST (MyFunctionTest, testCopyFunctionWithLambda) {
     mf ();
     mf2 ();
 }
+
+TEST (MyFunctionTest, testPooledFunctorsOutgrowThePool) {
+    // Not trivially copyable, so stored out of line: pooled at first, then allocated with new once
+    // the shared pool is exhausted.
+    auto counter = std::make_shared<int> (0);
+    MyFunction increment ([counter] () { return ++*counter; });
+    {
+        std::vector<MyFunction<int ()>> copies;
+        for (int i = 0; i < 5000; i++) {
+            copies.push_back (increment);
+        }
+        EXPECT_EQ (counter.use_count (), 5002);
+        for (auto& copy : copies) {
+            copy ();
+        }
+        MyFunction moved = std::move (copies.back ());
+        copies.pop_back ();
+        EXPECT_EQ (moved (), 5001);
+    }
+    EXPECT_EQ (counter.use_count (), 2);
+    EXPECT_EQ (increment (), 5002);
+}
+
+TEST (MyFunctionTest, testStaticFunctionOutlivesThreadMagazines) {
+    // Stored out of line; their pooled storage is freed during static destruction. Two functor
+    // types, so two pools: the thread's cached last pool covers only one of them.
+    staticFunction = MyFunction<std::size_t ()> (
+        [text = std::string (100, 'x')] () { return text.size (); });
+    otherStaticFunction = MyFunction<std::size_t ()> (
+        [text = std::string (50, 'y')] () { return text.size () * 2; });
+    EXPECT_EQ (staticFunction (), 100);
+    EXPECT_EQ (otherStaticFunction (), 100);
+}
@@ -0,0 +1,219 @@
+#include <gtest/gtest.h>
+
+#include <ObjectPool.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace inplace;
+
+namespace {
+struct Message {
+    Message (int id, std::string text) : id (id), text (std::move (text)) {
+    }
+
+    int id;
+    std::string text;
+};
+}  // namespace
+
+TEST (ObjectPoolTest, acquireAndRelease) {
+    ObjectPool<Message, 4> pool;
+    EXPECT_EQ (pool.capacity (), 4);
+    std::vector<ObjectPool<Message, 4>::Handle> held;
+    for (int i = 0; i < 4; i++) {
+        auto message = pool.acquire (i, "message " + std::to_string (i));
+        ASSERT_TRUE (message);
+        EXPECT_EQ (pool.owns (message.get ()), true);
+        held.push_back (std::move (message));
+    }
+    EXPECT_EQ (held[2]->text, "message 2");
+    // Exhausted: a fixed pool does not grow.
+    EXPECT_EQ (pool.acquire (4, "late"), nullptr);
+    EXPECT_EQ (pool.slabCount (), 1);
+
+    // The released slot is handed out again.
+    Message* slot = held[1].get ();
+    held.erase (held.begin () + 1);
+    auto again = pool.acquire (5, "again");
+    EXPECT_EQ (again.get (), slot);
+    EXPECT_EQ (again->id, 5);
+
+    Message outside (0, "");
+    EXPECT_EQ (pool.owns (&outside), false);
+}
+
+TEST (ObjectPoolTest, destroysObjects) {
+    auto tracker = std::make_shared<int> (0);
+    ObjectPool<std::shared_ptr<int>, 8> pool;
+    {
+        auto a = pool.acquire (tracker);
+        auto b = pool.acquire (tracker);
+        std::shared_ptr<int>* raw = pool.create (tracker);
+        EXPECT_EQ (tracker.use_count (), 4);
+        pool.destroy (raw);
+        EXPECT_EQ (tracker.use_count (), 3);
+    }
+    EXPECT_EQ (tracker.use_count (), 1);
+}
+
+TEST (ObjectPoolTest, failedConstructionReturnsTheSlot) {
+    struct Throwing {
+        explicit Throwing (bool fail) {
+            if (fail) {
+                throw std::runtime_error ("construction failed");
+            }
+        }
+    };
+    ObjectPool<Throwing, 1> pool;
+    EXPECT_THROW ((void)pool.acquire (true), std::runtime_error);
+    EXPECT_NE (pool.acquire (false), nullptr);
+}
+
+TEST (ObjectPoolTest, growsBySlabs) {
+    ObjectPool<uint64_t, 4, 3> pool;
+    EXPECT_EQ (pool.slabCount (), 1);
+    std::vector<ObjectPool<uint64_t, 4, 3>::Handle> held;
+    for (uint64_t i = 0; i < 12; i++) {
+        held.push_back (pool.acquire (i));
+        ASSERT_TRUE (held.back ());
+    }
+    EXPECT_EQ (pool.slabCount (), 3);
+    EXPECT_EQ (pool.capacity (), 12);
+    EXPECT_EQ (pool.acquire (12), nullptr);
+    for (uint64_t i = 0; i < 12; i++) {
+        EXPECT_EQ (*held[i], i);
+        EXPECT_EQ (pool.owns (held[i].get ()), true);
+    }
+    uint64_t outside = 0;
+    EXPECT_EQ (pool.owns (&outside), false);
+    // Releasing objects of every slab does not shrink the pool.
+    held.clear ();
+    EXPECT_EQ (pool.slabCount (), 3);
+    EXPECT_NE (pool.acquire (0), nullptr);
+}
+
+TEST (ObjectPoolTest, respectsAlignment) {
+    struct alignas (64) Line {
+        char bytes[40];
+    };
+    ObjectPool<Line, 8, 2> pool;
+    std::vector<ObjectPool<Line, 8, 2>::Handle> held;
+    for (int i = 0; i < 16; i++) {
+        held.push_back (pool.acquire ());
+        ASSERT_TRUE (held.back ());
+        EXPECT_EQ (reinterpret_cast<uintptr_t> (held.back ().get ()) % 64, 0);
+    }
+}
+
+TEST (ObjectPoolTest, exitedThreadsReturnTheirMagazines) {
+    // The slots the first thread freed last sit in its magazine until it exits; then the second
+    // thread gets all of them.
+    constexpr size_t Capacity = 64;
+    ObjectPool<int, Capacity> pool;
+    std::thread first ([&pool] {
+        std::vector<ObjectPool<int, Capacity>::Handle> held;
+        for (int i = 0; i < static_cast<int> (Capacity); i++) {
+            held.push_back (pool.acquire (i));
+        }
+    });
+    first.join ();
+    std::thread second ([&pool] {
+        std::vector<ObjectPool<int, Capacity>::Handle> held;
+        for (int i = 0; i < static_cast<int> (Capacity); i++) {
+            held.push_back (pool.acquire (i));
+            EXPECT_TRUE (held.back ());
+        }
+        EXPECT_EQ (pool.acquire (0), nullptr);
+    });
+    second.join ();
+}
+
+TEST (ObjectPoolTest, producerAndConsumerTradeMagazines) {
+    // One thread only allocates, the other only frees: the producer's magazine is refilled with
+    // the consumer's full ones, and a fixed pool never runs dry with few objects in flight.
+    constexpr size_t Capacity = 64;
+    constexpr int Messages = 50000;
+    using Pool = ObjectPool<int, Capacity>;
+    Pool pool;
+    std::mutex mutex;
+    std::deque<Pool::Handle> inFlight;
+    std::atomic<int> exhausted = 0;
+    std::thread producer ([&] {
+        for (int i = 0; i < Messages;) {
+            {
+                std::lock_guard lock (mutex);
+                if (inFlight.size () >= 8) {
+                    continue;
+                }
+            }
+            auto message = pool.acquire (i);
+            if (!message) {
+                exhausted.fetch_add (1, std::memory_order_relaxed);
+                continue;
+            }
+            std::lock_guard lock (mutex);
+            inFlight.push_back (std::move (message));
+            i++;
+        }
+    });
+    int expected = 0;
+    while (expected < Messages) {
+        Pool::Handle message;
+        {
+            std::lock_guard lock (mutex);
+            if (inFlight.empty ()) {
+                continue;
+            }
+            message = std::move (inFlight.front ());
+            inFlight.pop_front ();
+        }
+        EXPECT_EQ (*message, expected++);
+    }
+    producer.join ();
+    EXPECT_EQ (exhausted.load (), 0);
+}
+
+TEST (ObjectPoolTest, concurrentAcquireAndRelease) {
+    constexpr size_t SlotsPerSlab = 64;
+    constexpr int Rounds = 20000;
+    constexpr int Threads = 4;
+    using Pool = ObjectPool<uint64_t, SlotsPerSlab, 4>;
+    Pool pool;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < Threads; t++) {
+        threads.emplace_back ([&pool, t] {
+            std::vector<Pool::Handle> held;
+            for (int i = 0; i < Rounds; i++) {
+                const uint64_t stamp = (uint64_t (t) << 32) | static_cast<uint64_t> (i);
+                if (auto object = pool.acquire (stamp)) {
+                    held.push_back (std::move (object));
+                }
+                if (held.size () > static_cast<size_t> (i % 48)) {
+                    // Nobody else may have written to an object we hold.
+                    EXPECT_EQ (*held.front () >> 32, static_cast<uint64_t> (t));
+                    held.erase (held.begin ());
+                }
+            }
+            for (auto& object : held) {
+                EXPECT_EQ (*object >> 32, static_cast<uint64_t> (t));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+    // Every slot is free again, wherever it was parked.
+    const size_t slabs = pool.slabCount ();
+    std::vector<Pool::Handle> all;
+    for (size_t i = 0; i < slabs * SlotsPerSlab; i++) {
+        all.push_back (pool.acquire (i));
+        ASSERT_TRUE (all.back ());
+    }
+    EXPECT_EQ (pool.slabCount (), slabs);
+}
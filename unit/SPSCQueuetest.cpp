@@ -1,12 +1,19 @@
 #include <gtest/gtest.h>
 #include "SPSCQueue.hpp"
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <CommonTestUtils.hpp>
 #include <Signal.hpp>
 using namespace inplace;
 
+namespace {
+template <class Queue>
+concept WaitingQueue = requires (Queue q, void (*read) (const size_t&)) {
+    q.dequeueWait (std::chrono::milliseconds (1), read);
+};
+}  // namespace
 
 TEST (SPSCQueueTest, enqueue) {
     inplace::SPSCQueue<DistortedStruct, 35> q;
@@ -139,4 +146,325 @@ TEST (SPSCQueueTest, DISABLED_threadedWrite) {
         EXPECT_EQ (vecReader.at (i).d_ptr, vecWriter.at (i).d_ptr);
     }
 
-}
\ No newline at end of file
+}
+TEST (SPSCQueueTest, bulkEnqueueDequeue) {
+    constexpr const size_t QSize = 8;
+    inplace::SPSCQueue<DistortedStruct, QSize> q;
+    std::vector<DistortedStruct> vecWriter;
+    std::vector<DistortedStruct> vecReader;
+    for (size_t i = 0; i < 2 * QSize; i++) {
+        vecWriter.push_back (DistortedStruct{ i, i, std::make_shared<int> (i), "ak", { i } });
+    }
+
+    // Move the cursors so that the next batch wraps around the ring.
+    EXPECT_EQ (q.enqueueBulk (std::span (vecWriter).first (5)), 5);
+    EXPECT_EQ (q.dequeueBulk (5, [&vecReader](std::span<DistortedStruct> batch) {
+        vecReader.insert (vecReader.end (), batch.begin (), batch.end ());
+    }), 5);
+
+    EXPECT_EQ (q.enqueueBulk (std::span (vecWriter).subspan (5)), QSize);
+    EXPECT_EQ (q.full (), true);
+    EXPECT_EQ (q.enqueueBulk (std::span (vecWriter).subspan (5)), 0);
+
+    size_t calls = 0;
+    EXPECT_EQ (q.dequeueBulk (64, [&vecReader, &calls](std::span<DistortedStruct> batch) {
+        calls++;
+        for (auto& x : batch) {
+            vecReader.push_back (std::move (x));
+        }
+    }), QSize);
+    EXPECT_EQ (calls, 2);
+    EXPECT_EQ (q.empty (), true);
+    EXPECT_EQ (q.dequeueBulk (64, [](std::span<DistortedStruct>) {}), 0);
+
+    EXPECT_EQ (vecReader.size (), 5 + QSize);
+    for (size_t i = 0; i < vecReader.size (); i++) {
+        EXPECT_EQ (vecReader.at (i), vecWriter.at (i));
+    }
+}
+
+TEST (SPSCQueueTest, cachedCursorEnqueue) {
+    inplace::SPSCQueue<DistortedStruct, 35, SPSCMode::CachedCursor> q;
+    std::vector<DistortedStruct> vecWriter;
+    std::vector<DistortedStruct> vecReader;
+    for (size_t i = 0; i < 36; i++) {
+        vecWriter.push_back (DistortedStruct{ i, i, std::make_shared<int> (i), "ak", { i } });
+        EXPECT_EQ (q.enqueue (vecWriter.back ()), i < 35);
+    }
+    vecWriter.pop_back ();
+
+    EXPECT_EQ (q.size (), 35);
+    EXPECT_EQ (q.full (), true);
+
+    while (!q.empty ()) {
+        EXPECT_EQ (q.dequeue ([&vecReader](auto& x) { vecReader.push_back (x); }), true);
+    }
+    EXPECT_EQ (q.dequeue ([&vecReader](auto& x) { vecReader.push_back (x); }), false);
+
+    EXPECT_EQ (vecReader.size (), vecWriter.size ());
+    for (size_t i = 0; i < vecReader.size (); i++) {
+        EXPECT_EQ (vecReader.at (i), vecWriter.at (i));
+    }
+}
+
+TEST (SPSCQueueTest, cachedCursorThreaded) {
+    constexpr const size_t size = 1 << 20;
+    inplace::SPSCQueue<size_t, 1 << 5, SPSCMode::CachedCursor> q;
+    std::vector<size_t> readVector;
+    readVector.reserve (size);
+
+    std::thread writer ([&q] {
+        for (size_t i = 0; i < size; i++) {
+            while (!q.enqueue (i)) {
+                std::this_thread::yield ();
+            }
+        }
+    });
+    std::thread reader ([&q, &readVector] {
+        while (readVector.size () < size) {
+            if (!q.dequeue ([&readVector](const size_t& x) { readVector.push_back (x); })) {
+                std::this_thread::yield ();
+            }
+        }
+    });
+    writer.join ();
+    reader.join ();
+
+    EXPECT_EQ (q.empty (), true);
+    for (size_t i = 0; i < size; i++) {
+        ASSERT_EQ (readVector[i], i);
+    }
+}
+
+TEST (SPSCQueueTest, waitTimesOut) {
+    inplace::SPSCQueue<size_t, 2, SPSCMode::SharedCounter, NoQueueStats, Blocking> q;
+    const auto begin = std::chrono::steady_clock::now ();
+    EXPECT_EQ (q.dequeueWait (std::chrono::milliseconds (20), [](const size_t&) {}), false);
+    EXPECT_GE (std::chrono::steady_clock::now () - begin, std::chrono::milliseconds (20));
+
+    EXPECT_EQ (q.enqueueWait (std::chrono::milliseconds (1), 1ul), true);
+    EXPECT_EQ (q.enqueueWait (std::chrono::milliseconds (1), 2ul), true);
+    EXPECT_EQ (q.enqueueWait (std::chrono::milliseconds (20), 3ul), false);
+}
+
+TEST (SPSCQueueTest, waitWakesParkedThreads) {
+    constexpr const size_t size = 1 << 12;
+    inplace::SPSCQueue<size_t, 4, SPSCMode::CachedCursor, NoQueueStats, Blocking> q;
+    std::vector<size_t> readVector;
+
+    std::thread reader ([&q, &readVector] {
+        for (size_t i = 0; i < size; i++) {
+            EXPECT_EQ (q.template dequeueWait<ParkImmediately> (
+                           std::chrono::seconds (10),
+                           [&readVector](const size_t& x) { readVector.push_back (x); }),
+                       true);
+        }
+    });
+    std::thread writer ([&q] {
+        for (size_t i = 0; i < size; i++) {
+            if (i % 512 == 0) {
+                std::this_thread::sleep_for (std::chrono::milliseconds (1));
+            }
+            EXPECT_EQ (q.template enqueueWait<ParkImmediately> (std::chrono::seconds (10), i), true);
+        }
+    });
+    writer.join ();
+    reader.join ();
+
+    ASSERT_EQ (readVector.size (), size);
+    for (size_t i = 0; i < size; i++) {
+        EXPECT_EQ (readVector[i], i);
+    }
+}
+
+TEST (SPSCQueueTest, dynamicCapacity) {
+    SPSCQueue<size_t, DYNAMIC_CAPACITY> q (1000);
+    EXPECT_EQ (q.capacity (), 1000);
+    for (size_t lap = 0; lap < 3; lap++) {
+        for (size_t i = 0; i < 1000; i++) {
+            EXPECT_EQ (q.enqueue (i), true);
+        }
+        EXPECT_EQ (q.full (), true);
+        EXPECT_EQ (q.enqueue (size_t{ 0 }), false);
+        for (size_t i = 0; i < 1000; i++) {
+            size_t read = 0;
+            EXPECT_EQ (q.dequeue ([&read](auto& x) { read = x; }), true);
+            EXPECT_EQ (read, i);
+        }
+        EXPECT_EQ (q.empty (), true);
+    }
+    EXPECT_THROW ((SPSCQueue<size_t, DYNAMIC_CAPACITY> (0)), std::invalid_argument);
+}
+
+TEST (SPSCQueueTest, claimAndPeekInPlace) {
+    SPSCQueue<DistortedStruct, 4> q;
+    auto ptr = std::make_shared<int> (3);
+    for (size_t i = 0; i < 4; i++) {
+        auto slot = q.tryClaim ();
+        ASSERT_TRUE (slot);
+        new (slot.ptr ()) DistortedStruct{ i, i, ptr, "ak", { i } };
+        slot.commit ();
+    }
+    EXPECT_FALSE (q.tryClaim ());
+    EXPECT_EQ (ptr.use_count (), 5);
+
+    {
+        // A claim abandoned before commit () is never published.
+        auto view = q.tryPeek ();
+        ASSERT_TRUE (view);
+        EXPECT_EQ (view->x, 0);
+        view.release ();
+        auto slot = q.tryClaim ();
+        ASSERT_TRUE (slot);
+    }
+    EXPECT_EQ (q.size (), 3);
+
+    for (size_t i = 1; i < 4; i++) {
+        auto view = q.tryPeek ();
+        ASSERT_TRUE (view);
+        EXPECT_EQ ((*view).y, i);
+    }
+    EXPECT_FALSE (q.tryPeek ());
+    EXPECT_EQ (ptr.use_count (), 1);
+}
+
+TEST (SPSCQueueTest, droppedClaimDestroysItsElement) {
+    auto ptr = std::make_shared<int> (1);
+    {
+        SPSCQueue<std::shared_ptr<int>, 4> q;
+        {
+            auto slot = q.tryClaim ();
+            ASSERT_TRUE (slot);
+            slot.emplace (ptr);
+            EXPECT_EQ (ptr.use_count (), 2);
+        }
+        EXPECT_EQ (ptr.use_count (), 1);
+        {
+            auto slot = q.tryClaim ();
+            ASSERT_TRUE (slot);
+            ::new (slot.ptr ()) std::shared_ptr<int> (ptr);
+            slot.constructed ();
+        }
+        EXPECT_EQ (ptr.use_count (), 1);
+        auto slot = q.tryClaim ();
+        ASSERT_TRUE (slot);
+        slot.emplace (ptr);
+        slot.commit ();
+        EXPECT_EQ (ptr.use_count (), 2);
+    }
+    EXPECT_EQ (ptr.use_count (), 1);
+}
+
+TEST (SPSCQueueTest, tryDequeueMovesOut) {
+    SPSCQueue<DistortedStruct, 4> q;
+    auto ptr = std::make_shared<int> (1);
+    EXPECT_EQ (q.enqueue (DistortedStruct{ 1, 1, ptr, std::string (64, 'a'), { 1, 2, 3 } }), true);
+    EXPECT_EQ (q.enqueue (DistortedStruct{ 2, 2, ptr, "b", { 4 } }), true);
+    EXPECT_EQ (ptr.use_count (), 3);
+
+    auto first = q.tryDequeue ();
+    ASSERT_TRUE (first.has_value ());
+    EXPECT_EQ (first->vstr, std::string (64, 'a'));
+    EXPECT_EQ (first->vvec.size (), 3);
+    DistortedStruct second;
+    EXPECT_EQ (q.tryDequeue (second), true);
+    EXPECT_EQ (second.x, 2);
+    // Moved, not copied: the queue no longer holds a reference.
+    EXPECT_EQ (ptr.use_count (), 3);
+    EXPECT_FALSE (q.tryDequeue ().has_value ());
+    EXPECT_EQ (q.tryDequeue (second), false);
+
+    SPSCQueue<MoveOnlyPayload, 2> moveOnly;
+    EXPECT_EQ (moveOnly.enqueue (MoveOnlyPayload (7)), true);
+    auto payload = moveOnly.tryDequeue ();
+    ASSERT_TRUE (payload.has_value ());
+    EXPECT_EQ (*payload->d_value, 7);
+}
+
+TEST (SPSCQueueTest, destroysRemainingElements) {
+    auto ptr = std::make_shared<int> (1);
+    {
+        SPSCQueue<std::string, 8> strings;
+        SPSCQueue<std::shared_ptr<int>, 8> pointers;
+        // Leave elements on both sides of the wrap-around.
+        for (int i = 0; i < 6; i++) {
+            EXPECT_EQ (strings.enqueue (std::string (100, 'a')), true);
+            EXPECT_EQ (pointers.enqueue (ptr), true);
+        }
+        for (int i = 0; i < 4; i++) {
+            EXPECT_EQ (strings.dequeue ([](const std::string&) {}), true);
+            EXPECT_EQ (pointers.dequeue ([](const std::shared_ptr<int>&) {}), true);
+        }
+        for (int i = 0; i < 5; i++) {
+            EXPECT_EQ (strings.enqueue (std::string (100, 'b')), true);
+            EXPECT_EQ (pointers.enqueue (ptr), true);
+        }
+        EXPECT_EQ (ptr.use_count (), 8);
+    }
+    EXPECT_EQ (ptr.use_count (), 1);
+}
+
+TEST (SPSCQueueTest, bulkEnqueueUndoesAThrowingCopy) {
+    struct Payload {
+        std::shared_ptr<int> ptr;
+        bool throws = false;
+
+        Payload (std::shared_ptr<int> p, bool t) : ptr (std::move (p)), throws (t) {}
+
+        Payload (const Payload& other) : ptr (other.ptr), throws (other.throws) {
+            if (throws) {
+                throw std::runtime_error ("copy");
+            }
+        }
+
+        Payload (Payload&&) noexcept = default;
+    };
+    auto ptr = std::make_shared<int> (1);
+    std::vector<Payload> batch;
+    batch.reserve (3);
+    batch.emplace_back (ptr, false);
+    batch.emplace_back (ptr, false);
+    batch.emplace_back (ptr, true);
+    SPSCQueue<Payload, 8> q;
+    EXPECT_THROW (q.enqueueBulk (batch), std::runtime_error);
+    EXPECT_EQ (ptr.use_count (), 4);
+    EXPECT_EQ (q.empty (), true);
+    EXPECT_EQ (q.enqueueBulk (std::span (batch).first (2)), 2);
+    EXPECT_EQ (ptr.use_count (), 6);
+}
+
+TEST (SPSCQueueTest, blockingIsOptIn) {
+    // Without the Blocking policy there are no parkers to notify and no waiting calls to make.
+    static_assert (std::is_empty_v<QueueParker<NonBlocking>>);
+    static_assert (sizeof (SPSCQueue<size_t, 4>) <
+                   sizeof (SPSCQueue<size_t, 4, SPSCMode::SharedCounter, NoQueueStats, Blocking>));
+    static_assert (!WaitingQueue<SPSCQueue<size_t, 4>>);
+    static_assert (
+        WaitingQueue<SPSCQueue<size_t, 4, SPSCMode::SharedCounter, NoQueueStats, Blocking>>);
+}
+
+TEST (SPSCQueueTest, statsPolicyCounts) {
+    static_assert (std::is_empty_v<NoQueueStats>);
+    SPSCQueue<size_t, 4, SPSCMode::SharedCounter, QueueStats<>, Blocking> q;
+    for (size_t i = 0; i < 5; i++) {
+        q.enqueue (i);
+    }
+    EXPECT_EQ (q.dequeue ([](auto&) {}), true);
+    EXPECT_EQ (q.enqueueWait<ParkImmediately> (std::chrono::milliseconds (1), size_t{ 9 }), true);
+    EXPECT_EQ (q.enqueueWait<ParkImmediately> (std::chrono::milliseconds (1), size_t{ 9 }), false);
+    while (q.dequeue ([](auto&) {})) {
+    }
+
+    const auto stats = q.stats ();
+    EXPECT_EQ (stats.enqueued, 5);
+    EXPECT_EQ (stats.dequeued, 5);
+    // One direct rejection plus at least one attempt before and after parking in enqueueWait.
+    EXPECT_GE (stats.fullRejections, 3);
+    EXPECT_EQ (stats.emptyRejections, 1);
+    EXPECT_EQ (stats.highWaterMark, 4);
+    EXPECT_GE (stats.parks, 1);
+    // Occupancies after the enqueues were 1, 2, 3, 4 and 4.
+    EXPECT_EQ (stats.occupancy[QueueStatsSnapshot::bucketOf (1)], 1);
+    EXPECT_EQ (stats.occupancy[QueueStatsSnapshot::bucketOf (2)], 2);
+    EXPECT_EQ (stats.occupancy[QueueStatsSnapshot::bucketOf (4)], 2);
+}
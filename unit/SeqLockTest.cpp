@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <SeqLock.hpp>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+using namespace inplace;
+
+namespace {
+// 20 bytes: not a whole number of words. Every field of a published value is equal, so a reader
+// can tell a torn copy.
+struct Limits {
+    uint32_t fields[5];
+
+    explicit Limits (uint32_t value = 0) {
+        for (uint32_t& field : fields) {
+            field = value;
+        }
+    }
+
+    bool consistent () const {
+        for (uint32_t field : fields) {
+            if (field != fields[0]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+}  // namespace
+
+TEST (SeqLockTest, storeAndLoad) {
+    SeqLock<Limits> lock (Limits (7));
+    EXPECT_EQ (alignof (SeqLock<Limits>), CACHE_LINE_SIZE);
+    EXPECT_EQ (lock.load ().fields[4], 7);
+    EXPECT_EQ (lock.version (), 0);
+
+    lock.store (Limits (9));
+    EXPECT_EQ (lock.version (), 2);
+    Limits copy;
+    EXPECT_EQ (lock.tryLoad (copy), true);
+    EXPECT_EQ (copy.fields[0], 9);
+    EXPECT_EQ (copy.consistent (), true);
+
+    lock.update ([] (Limits& limits) { limits = Limits (limits.fields[0] + 1); });
+    EXPECT_EQ (lock.peek ().fields[3], 10);
+    EXPECT_EQ (lock.version (), 4);
+}
+
+TEST (SeqLockTest, readersNeverSeeTornValues) {
+    SeqLock<Limits> lock;
+    constexpr uint32_t Updates = 20000;
+    std::atomic<bool> done = false;
+    std::atomic<uint64_t> torn = 0;
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; r++) {
+        readers.emplace_back ([&] {
+            uint32_t last = 0;
+            while (!done.load (std::memory_order_relaxed)) {
+                const Limits limits = lock.load ();
+                // Values only grow: a reader must never go back in time either.
+                if (!limits.consistent () || limits.fields[0] < last) {
+                    torn.fetch_add (1, std::memory_order_relaxed);
+                }
+                last = limits.fields[0];
+            }
+        });
+    }
+    for (uint32_t i = 1; i <= Updates; i++) {
+        lock.store (Limits (i));
+    }
+    done.store (true);
+    for (auto& reader : readers) {
+        reader.join ();
+    }
+    EXPECT_EQ (torn.load (), 0);
+    EXPECT_EQ (lock.version (), 2 * Updates);
+}
@@ -0,0 +1,491 @@
+#include <gtest/gtest.h>
+
+#include <CommonTestUtils.hpp>
+#include <SequencedMPMCQueue.hpp>
+#include <chrono>
+#include <memory>
+#include <array>
+#include <numeric>
+#include <system_error>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+using namespace inplace;
+
+TEST (SequencedMPMCQueueTest, enqueue) {
+    constexpr const size_t QSize = 35;
+    SequencedMPMCQueue<DistortedStruct, QSize> q;
+    std::vector<DistortedStruct> vecWriter;
+    std::vector<DistortedStruct> vecReader;
+    for (size_t i = 0; i < QSize; i++) {
+        vecWriter.push_back (DistortedStruct{ i, i, std::make_shared<int> (i), "ak", { i } });
+        EXPECT_EQ (q.enqueue (vecWriter.back ()), true);
+    }
+
+    EXPECT_EQ (q.size (), QSize);
+    EXPECT_EQ (q.full (), true);
+    EXPECT_EQ (q.enqueue (vecWriter.back ()), false);
+
+    while (!q.empty ()) {
+        auto elem = q.dequeue ([&vecReader](const auto& x) {
+            vecReader.push_back (x);
+        });
+        EXPECT_EQ (elem, true);
+    }
+    EXPECT_EQ (q.dequeue ([](const auto&) {}), false);
+
+    EXPECT_EQ (vecReader.size (), vecWriter.size ());
+    for (size_t i = 0; i < vecReader.size (); i++) {
+        EXPECT_EQ (vecReader.at (i), vecWriter.at (i));
+    }
+}
+
+TEST (SequencedMPMCQueueTest, enqueueSizeOF1) {
+    SequencedMPMCQueue<DistortedStruct, 1> q;
+    for (size_t lap = 0; lap < 4; lap++) {
+        auto obj = DistortedStruct{ lap, lap, std::make_shared<int> (lap), "ak", { lap } };
+        EXPECT_EQ (q.enqueue (obj), true);
+        EXPECT_EQ (q.full (), true);
+        EXPECT_EQ (q.enqueue (obj), false);
+
+        DistortedStruct read;
+        EXPECT_EQ (q.dequeue ([&read](const auto& x) { read = x; }), true);
+        EXPECT_EQ (read, obj);
+        EXPECT_EQ (q.empty (), true);
+        EXPECT_EQ (q.dequeue ([](const auto&) {}), false);
+    }
+}
+
+TEST (SequencedMPMCQueueTest, destroysRemainingElements) {
+    auto ptr = std::make_shared<int> (7);
+    {
+        SequencedMPMCQueue<DistortedStruct, 8> q;
+        for (size_t i = 0; i < 5; i++) {
+            q.enqueue (DistortedStruct{ i, i, ptr, "ak", { i } });
+        }
+        EXPECT_EQ (ptr.use_count (), 6);
+        EXPECT_EQ (q.dequeue ([](const auto&) {}), true);
+        EXPECT_EQ (ptr.use_count (), 5);
+    }
+    EXPECT_EQ (ptr.use_count (), 1);
+}
+
+TEST (SequencedMPMCQueueTest, bulkEnqueueDequeue) {
+    constexpr const size_t QSize = 8;
+    SequencedMPMCQueue<DistortedStruct, QSize> q;
+    std::vector<DistortedStruct> vecWriter;
+    std::vector<DistortedStruct> vecReader;
+    for (size_t i = 0; i < 2 * QSize; i++) {
+        vecWriter.push_back (DistortedStruct{ i, i, std::make_shared<int> (i), "ak", { i } });
+    }
+
+    EXPECT_EQ (q.enqueueBulk (std::span (vecWriter).first (5)), 5);
+    EXPECT_EQ (q.dequeueBulk (5, [&vecReader](std::span<DistortedStruct> batch) {
+        vecReader.insert (vecReader.end (), batch.begin (), batch.end ());
+    }), 5);
+
+    EXPECT_EQ (q.enqueueBulk (std::span (vecWriter).subspan (5)), QSize);
+    EXPECT_EQ (q.full (), true);
+    EXPECT_EQ (q.enqueueBulk (std::span (vecWriter).subspan (5)), 0);
+
+    size_t calls = 0;
+    EXPECT_EQ (q.dequeueBulk (64, [&vecReader, &calls](std::span<DistortedStruct> batch) {
+        calls++;
+        for (auto& x : batch) {
+            vecReader.push_back (std::move (x));
+        }
+    }), QSize);
+    EXPECT_EQ (calls, 2);
+    EXPECT_EQ (q.empty (), true);
+
+    EXPECT_EQ (vecReader.size (), 5 + QSize);
+    for (size_t i = 0; i < vecReader.size (); i++) {
+        EXPECT_EQ (vecReader.at (i), vecWriter.at (i));
+    }
+}
+
+TEST (SequencedMPMCQueueTest, bulk4P4CTest) {
+    constexpr const size_t Size = 1 << 16;
+    constexpr const size_t Batch = 16;
+    SequencedMPMCQueue<size_t, 1 << 8> q;
+    std::vector<std::atomic<int>> seen (Size);
+    std::atomic<size_t> writeIndex = 0;
+    std::atomic<size_t> readCount = 0;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back ([&q, &writeIndex] () {
+            auto first = writeIndex.fetch_add (Batch, std::memory_order_acq_rel);
+            while (first < Size) {
+                std::vector<size_t> batch (Batch);
+                std::iota (batch.begin (), batch.end (), first);
+                std::span<size_t> pending (batch);
+                while (!pending.empty ()) {
+                    pending = pending.subspan (q.enqueueBulk (pending));
+                }
+                first = writeIndex.fetch_add (Batch, std::memory_order_acq_rel);
+            }
+        });
+        threads.emplace_back ([&q, &seen, &readCount] () {
+            while (readCount.load (std::memory_order_acquire) < Size) {
+                readCount.fetch_add (q.dequeueBulk (Batch, [&seen](std::span<size_t> batch) {
+                    for (auto value : batch) {
+                        seen[value].fetch_add (1, std::memory_order_relaxed);
+                    }
+                }), std::memory_order_acq_rel);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+
+    EXPECT_EQ (readCount.load (), Size);
+    for (size_t i = 0; i < Size; i++) {
+        EXPECT_EQ (seen[i].load (), 1) << "at " << i;
+    }
+}
+
+TEST (SequencedMPMCQueueTest, bulkEnqueueSkipsAfterAThrowingCopy) {
+    auto ptr = std::make_shared<int> (1);
+    std::vector<CopyThrowingPayload> batch;
+    batch.reserve (3);
+    batch.emplace_back (ptr, false);
+    batch.emplace_back (ptr, false);
+    batch.emplace_back (ptr, true);
+    {
+        SequencedMPMCQueue<CopyThrowingPayload, 8> q;
+        EXPECT_THROW (q.enqueueBulk (batch), std::runtime_error);
+        // The copies made before the throw are delivered, and the queue keeps working.
+        EXPECT_EQ (q.enqueue (CopyThrowingPayload (ptr, false)), true);
+        size_t read = 0;
+        while (q.dequeue ([&read] (const CopyThrowingPayload&) { read++; })) {
+        }
+        EXPECT_EQ (read, 3);
+        EXPECT_EQ (q.empty (), true);
+        EXPECT_EQ (q.enqueueBulk (std::span (batch).first (2)), 2);
+        EXPECT_EQ (ptr.use_count (), 6);
+    }
+    EXPECT_EQ (ptr.use_count (), 4);
+}
+
+TEST (SequencedMPMCQueueTest, waitWakesParkedThreads) {
+    constexpr const size_t Size = 1 << 12;
+    SequencedMPMCQueue<size_t, 4, NoQueueStats, Blocking> q;
+    std::vector<std::atomic<int>> seen (Size);
+    std::atomic<size_t> writeIndex = 0;
+
+    EXPECT_EQ (q.dequeueWait (std::chrono::milliseconds (5), [](const size_t&) {}), false);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 2; i++) {
+        threads.emplace_back ([&q, &seen] () {
+            for (size_t read = 0; read < Size / 2; read++) {
+                EXPECT_EQ (q.template dequeueWait<ParkImmediately> (
+                               std::chrono::seconds (10),
+                               [&seen](const size_t& x) { seen[x].fetch_add (1); }),
+                           true);
+            }
+        });
+        threads.emplace_back ([&q, &writeIndex] () {
+            auto index = writeIndex.fetch_add (1);
+            while (index < Size) {
+                EXPECT_EQ (q.template enqueueWait<ParkImmediately> (std::chrono::seconds (10),
+                                                                    index),
+                           true);
+                index = writeIndex.fetch_add (1);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+    for (size_t i = 0; i < Size; i++) {
+        EXPECT_EQ (seen[i].load (), 1) << "at " << i;
+    }
+}
+
+namespace {
+template <size_t Size, int64_t QSize>
+void runProducersConsumers (int writerSize, int readerSize) {
+    SequencedMPMCQueue<DistortedStruct, QSize> mpmcQueue;
+    std::vector<DistortedStruct> ALLElements (Size);
+    std::vector<DistortedStruct> ReadElements (Size);
+    std::atomic<size_t> writeIndex = 0;
+    std::atomic<size_t> readCount = 0;
+
+    std::vector<std::thread> writers;
+    for (int i = 0; i < writerSize; i++) {
+        writers.emplace_back ([&writeIndex, &mpmcQueue, &ALLElements] () {
+            auto index = writeIndex.fetch_add (1, std::memory_order_acq_rel);
+            while (index < Size) {
+                auto obj = DistortedStruct{ index, index, std::make_shared<int> (index), "abc",
+                                            { index } };
+                ALLElements[index] = obj;
+                while (!mpmcQueue.enqueue (std::move (obj))) {
+                    std::this_thread::yield ();
+                }
+                index = writeIndex.fetch_add (1, std::memory_order_acq_rel);
+            }
+        });
+    }
+    std::vector<std::thread> readers;
+    for (int i = 0; i < readerSize; i++) {
+        readers.emplace_back ([&mpmcQueue, &ReadElements, &readCount] () {
+            while (readCount.load (std::memory_order_acquire) < Size) {
+                if (!mpmcQueue.dequeue ([&ReadElements](const auto& input) {
+                        ReadElements[input.x] = input;
+                    })) {
+                    std::this_thread::yield ();
+                    continue;
+                }
+                readCount.fetch_add (1, std::memory_order_acq_rel);
+            }
+        });
+    }
+
+    for (auto& writer : writers) {
+        writer.join ();
+    }
+    for (auto& reader : readers) {
+        reader.join ();
+    }
+
+    EXPECT_EQ (readCount.load (), Size);
+    EXPECT_EQ (mpmcQueue.empty (), true);
+    for (size_t i = 0; i < Size; i++) {
+        EXPECT_EQ (ALLElements[i], ReadElements[i]) << "at " << i;
+    }
+}
+}  // namespace
+
+TEST (SequencedMPMCQueueTest, 2P1CTest) {
+    runProducersConsumers<1 << 15, 1 << 10> (2, 1);
+}
+
+TEST (SequencedMPMCQueueTest, 4P4CTest) {
+    runProducersConsumers<1 << 15, 1 << 5> (4, 4);
+}
+
+TEST (SequencedMPMCQueueTest, 10P4CTest) {
+    runProducersConsumers<1 << 17, 1 << 10> (10, 4);
+}
+
+TEST (SequencedMPMCQueueTest, 4P4CTestOnSmallQ) {
+    runProducersConsumers<1 << 15, 2> (4, 4);
+}
+
+TEST (SequencedMPMCQueueTest, dynamicCapacity) {
+    constexpr const int64_t QSize = 1 << 20;
+    SequencedMPMCQueue<size_t, DYNAMIC_CAPACITY> q (QSize, { HugePages::Transparent, true });
+    EXPECT_EQ (q.capacity (), QSize);
+    std::vector<size_t> values (QSize);
+    std::iota (values.begin (), values.end (), 0);
+    EXPECT_EQ (q.enqueueBulk (values), QSize);
+    EXPECT_EQ (q.full (), true);
+
+    size_t expected = 0;
+    EXPECT_EQ (q.dequeueBulk (QSize, [&expected](std::span<size_t> batch) {
+        for (auto value : batch) {
+            EXPECT_EQ (value, expected++);
+        }
+    }), QSize);
+    EXPECT_EQ (q.empty (), true);
+}
+
+TEST (SequencedMPMCQueueTest, explicitHugePages) {
+    // Explicit huge pages come from a pool the administrator reserves; an empty pool is reported
+    // as std::system_error rather than silently falling back to small pages.
+    try {
+        SequencedMPMCQueue<size_t, DYNAMIC_CAPACITY> q (1024, { HugePages::Explicit, true });
+        EXPECT_EQ (q.enqueue (size_t{ 7 }), true);
+        EXPECT_EQ (q.dequeue ([](const size_t& x) { EXPECT_EQ (x, 7); }), true);
+    } catch (const std::system_error&) {
+        SUCCEED ();
+    }
+}
+
+TEST (SequencedMPMCQueueTest, claimAndPeekThreaded) {
+    constexpr const size_t Size = 1 << 14;
+    SequencedMPMCQueue<std::array<size_t, 32>, 16> q;
+    std::vector<std::atomic<int>> seen (Size);
+    std::atomic<size_t> writeIndex = 0;
+    std::atomic<size_t> readCount = 0;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 2; i++) {
+        threads.emplace_back ([&q, &writeIndex] () {
+            auto index = writeIndex.fetch_add (1);
+            while (index < Size) {
+                if (index % 5 == 0) {
+                    // Dropped claims are skipped by the readers below.
+                    auto abandoned = q.tryClaim ();
+                }
+                auto slot = q.tryClaim ();
+                if (!slot) {
+                    std::this_thread::yield ();
+                    continue;
+                }
+                auto* message = new (slot.ptr ()) std::array<size_t, 32>;
+                message->fill (index);
+                slot.commit ();
+                index = writeIndex.fetch_add (1);
+            }
+        });
+        threads.emplace_back ([&q, &seen, &readCount] () {
+            while (readCount.load () < Size) {
+                auto view = q.tryPeek ();
+                if (!view) {
+                    std::this_thread::yield ();
+                    continue;
+                }
+                EXPECT_EQ (view->front (), view->back ());
+                seen[view->front ()].fetch_add (1);
+                view.release ();
+                readCount.fetch_add (1);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+    for (size_t i = 0; i < Size; i++) {
+        EXPECT_EQ (seen[i].load (), 1) << "at " << i;
+    }
+}
+
+TEST (SequencedMPMCQueueTest, abandonedClaimsAreSkipped) {
+    // No default constructor needed: nothing is published for an abandoned claim.
+    SequencedMPMCQueue<MoveOnlyPayload, 4> q;
+    {
+        auto abandoned = q.tryClaim ();
+        ASSERT_TRUE (abandoned);
+    }
+    auto slot = q.tryClaim ();
+    ASSERT_TRUE (slot);
+    slot.emplace (1);
+    slot.commit ();
+    {
+        auto abandoned = q.tryClaim ();
+        ASSERT_TRUE (abandoned);
+    }
+    EXPECT_EQ (q.enqueue (MoveOnlyPayload (2)), true);
+    {
+        auto view = q.tryPeek ();
+        ASSERT_TRUE (view);
+        EXPECT_EQ (*view->d_value, 1);
+    }
+    EXPECT_EQ (q.dequeue ([](const MoveOnlyPayload& x) { EXPECT_EQ (*x.d_value, 2); }), true);
+    EXPECT_EQ (q.empty (), true);
+    EXPECT_FALSE (q.tryPeek ());
+
+    // A batch leaves skipped slots out of its spans; one of nothing but skipped slots goes on to
+    // the next run.
+    std::vector<size_t> read;
+    auto collect = [&read](std::span<MoveOnlyPayload> batch) {
+        for (auto& x : batch) {
+            read.push_back (*x.d_value);
+        }
+    };
+    EXPECT_EQ (q.enqueue (MoveOnlyPayload (3)), true);
+    {
+        auto abandoned = q.tryClaim ();
+        ASSERT_TRUE (abandoned);
+    }
+    EXPECT_EQ (q.enqueue (MoveOnlyPayload (4)), true);
+    EXPECT_EQ (q.dequeueBulk (4, collect), 2);
+    EXPECT_EQ (read, (std::vector<size_t>{ 3, 4 }));
+    for (size_t i = 0; i < 4; i++) {
+        auto abandoned = q.tryClaim ();
+        ASSERT_TRUE (abandoned);
+    }
+    EXPECT_EQ (q.dequeueBulk (4, collect), 0);
+    EXPECT_EQ (q.enqueue (MoveOnlyPayload (5)), true);
+    EXPECT_EQ (q.dequeueBulk (4, collect), 1);
+    EXPECT_EQ (read, (std::vector<size_t>{ 3, 4, 5 }));
+    EXPECT_EQ (q.empty (), true);
+}
+
+TEST (SequencedMPMCQueueTest, droppedClaimDestroysItsElement) {
+    auto ptr = std::make_shared<int> (1);
+    {
+        SequencedMPMCQueue<std::shared_ptr<int>, 4> q;
+        {
+            auto slot = q.tryClaim ();
+            ASSERT_TRUE (slot);
+            slot.emplace (ptr);
+            EXPECT_EQ (ptr.use_count (), 2);
+        }
+        EXPECT_EQ (ptr.use_count (), 1);
+        {
+            auto slot = q.tryClaim ();
+            ASSERT_TRUE (slot);
+            ::new (slot.ptr ()) std::shared_ptr<int> (ptr);
+            slot.constructed ();
+        }
+        EXPECT_EQ (ptr.use_count (), 1);
+        auto slot = q.tryClaim ();
+        ASSERT_TRUE (slot);
+        slot.emplace (ptr);
+        slot.commit ();
+        EXPECT_EQ (ptr.use_count (), 2);
+    }
+    EXPECT_EQ (ptr.use_count (), 1);
+}
+
+TEST (SequencedMPMCQueueTest, tryDequeueMovesOut) {
+    SequencedMPMCQueue<MoveOnlyPayload, 2> q;
+    for (size_t lap = 0; lap < 3; lap++) {
+        EXPECT_EQ (q.enqueue (MoveOnlyPayload (lap)), true);
+        EXPECT_EQ (q.enqueue (MoveOnlyPayload (lap + 1)), true);
+        EXPECT_EQ (q.enqueue (MoveOnlyPayload (0)), false);
+        auto first = q.tryDequeue ();
+        ASSERT_TRUE (first.has_value ());
+        EXPECT_EQ (*first->d_value, lap);
+        MoveOnlyPayload second (0);
+        EXPECT_EQ (q.tryDequeue (second), true);
+        EXPECT_EQ (*second.d_value, lap + 1);
+        EXPECT_FALSE (q.tryDequeue ().has_value ());
+    }
+}
+
+TEST (SequencedMPMCQueueTest, statsPolicyCountsAcrossThreads) {
+    constexpr const size_t PerThread = 1 << 12;
+    SequencedMPMCQueue<size_t, 8, QueueStats<>> q;
+    std::atomic<size_t> readCount = 0;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 2; i++) {
+        threads.emplace_back ([&q] () {
+            for (size_t n = 0; n < PerThread; n++) {
+                while (!q.enqueue (n)) {
+                    std::this_thread::yield ();
+                }
+            }
+        });
+        threads.emplace_back ([&q, &readCount] () {
+            while (readCount.load () < 2 * PerThread) {
+                if (q.dequeue ([](const size_t&) {})) {
+                    readCount.fetch_add (1);
+                } else {
+                    std::this_thread::yield ();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+
+    const auto stats = q.stats ();
+    EXPECT_EQ (stats.enqueued, 2 * PerThread);
+    EXPECT_EQ (stats.dequeued, 2 * PerThread);
+    EXPECT_LE (stats.highWaterMark, 8);
+    uint64_t histogramTotal = 0;
+    for (auto count : stats.occupancy) {
+        histogramTotal += count;
+    }
+    EXPECT_EQ (histogramTotal, 2 * PerThread);
+}
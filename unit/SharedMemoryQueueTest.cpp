@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <SharedMemoryQueue.hpp>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace inplace;
+
+namespace {
+struct Sample {
+    uint64_t sequence;
+    double value;
+};
+
+std::string uniqueName (const char* test) {
+    return std::string ("/inplace-") + test + "-" + std::to_string (::getpid ());
+}
+}  // namespace
+
+TEST (SharedMemoryQueueTest, createAndAttachByName) {
+    const auto name = uniqueName ("named");
+    auto producer = SharedSPSCQueue<Sample, 8>::create (name);
+    auto consumer = SharedSPSCQueue<Sample, 8>::attach (name);
+    EXPECT_EQ (producer.header ().capacity, 8);
+    EXPECT_EQ (std::string (reinterpret_cast<const char*> (&producer.header ().magic), 8),
+               "IPCQUEUE");
+    EXPECT_EQ (consumer.header ().elementSize, sizeof (Sample));
+    EXPECT_NE (&producer.queue (), &consumer.queue ());
+
+    for (uint64_t i = 0; i < 8; i++) {
+        EXPECT_EQ (producer->enqueue (Sample{ i, i * 0.5 }), true);
+    }
+    EXPECT_EQ (producer->enqueue (Sample{ 8, 4.0 }), false);
+    for (uint64_t i = 0; i < 8; i++) {
+        auto sample = consumer->tryDequeue ();
+        ASSERT_TRUE (sample.has_value ());
+        EXPECT_EQ (sample->sequence, i);
+        EXPECT_EQ (sample->value, i * 0.5);
+    }
+    EXPECT_EQ (consumer->empty (), true);
+}
+
+TEST (SharedMemoryQueueTest, anonymousRegionAttachesByDescriptor) {
+    auto owner = SharedMPMCQueue<Sample, 4>::createAnonymous ();
+    auto peer = SharedMPMCQueue<Sample, 4>::attach (owner.fd ());
+    EXPECT_EQ (owner->enqueue (Sample{ 1, 1.0 }), true);
+    EXPECT_EQ (peer->size (), 1);
+    EXPECT_EQ (peer->dequeue ([] (const Sample& s) { EXPECT_EQ (s.sequence, 1); }), true);
+    EXPECT_EQ (peer.peerAlive (), true);
+}
+
+TEST (SharedMemoryQueueTest, mismatchedLayoutIsRejected) {
+    const auto name = uniqueName ("mismatch");
+    using Owner = SharedSPSCQueue<Sample, 8>;
+    using Larger = SharedSPSCQueue<Sample, 16>;
+    using OtherKind = SharedMPMCQueue<Sample, 8>;
+    auto owner = Owner::create (name);
+    EXPECT_THROW (Larger::attach (name), std::runtime_error);
+    EXPECT_THROW (OtherKind::attach (name), std::runtime_error);
+    EXPECT_THROW (Owner::create (name), std::system_error);
+}
+
+TEST (SharedMemoryQueueTest, crashedPeerIsDetected) {
+    auto parent = SharedSPSCQueue<Sample, 64>::createAnonymous ();
+    EXPECT_EQ (parent.peerAlive (), false);
+
+    const pid_t child = ::fork ();
+    ASSERT_GE (child, 0);
+    if (child == 0) {
+        // The child attaches, produces and dies without detaching.
+        auto producer = SharedSPSCQueue<Sample, 64>::attach (parent.fd ());
+        for (uint64_t i = 0; i < 10; i++) {
+            producer->enqueue (Sample{ i, 0.0 });
+        }
+        ::_exit (0);
+    }
+    int status = 0;
+    ASSERT_EQ (::waitpid (child, &status, 0), child);
+
+    uint64_t received = 0;
+    while (auto sample = parent->tryDequeue ()) {
+        EXPECT_EQ (sample->sequence, received++);
+    }
+    EXPECT_EQ (received, 10);
+    EXPECT_EQ (parent.peerAlive (), false);
+    EXPECT_EQ (parent.reapDeadPeers (), 1);
+    EXPECT_EQ (parent.reapDeadPeers (), 0);
+}
@@ -0,0 +1,274 @@
+#include <gtest/gtest.h>
+
+#include <Parking.hpp>
+#include <SpinLock.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+using namespace inplace;
+
+TEST (SpinLockTest, waitStrategyTimesOut) {
+    // WaitStrategy<MaxSpin, maxDelay, adder, yieldTimed, multiplier, maxTimeInMicroSec>
+    WaitStrategy<1000, 10, 0, 100, 1, 2000> strategy;
+    const auto begin = std::chrono::steady_clock::now ();
+    size_t rounds = 0;
+    while (strategy.wait ()) {
+        rounds++;
+        ASSERT_LT (std::chrono::steady_clock::now () - begin, std::chrono::seconds (5));
+    }
+    EXPECT_GT (rounds, 0);
+    EXPECT_GE (std::chrono::steady_clock::now () - begin, std::chrono::microseconds (2000));
+
+    strategy.reset ();
+    EXPECT_EQ (strategy.wait (), true);
+}
+
+TEST (SpinLockTest, parkingWaitStrategyGivesUpAfterSpinning) {
+    ParkingWaitStrategy<4, 2> strategy;
+    size_t rounds = 0;
+    while (strategy.wait ()) {
+        rounds++;
+    }
+    EXPECT_EQ (rounds, 6);
+    EXPECT_EQ (ParkImmediately{}.wait (), false);
+}
+
+TEST (SpinLockTest, parkerTimesOut) {
+    Parker parker;
+    const auto begin = std::chrono::steady_clock::now ();
+    bool result = parkUntil<ParkImmediately> (
+        parker, Parker::deadlineAfter (std::chrono::milliseconds (20)), [] { return false; });
+    EXPECT_EQ (result, false);
+    EXPECT_GE (std::chrono::steady_clock::now () - begin, std::chrono::milliseconds (20));
+    EXPECT_EQ (parker.waiters (), 0);
+}
+
+TEST (SpinLockTest, parkerWakesOnNotify) {
+    Parker parker;
+    std::atomic<bool> ready = false;
+    std::thread notifier ([&parker, &ready] {
+        std::this_thread::sleep_for (std::chrono::milliseconds (10));
+        ready.store (true, std::memory_order_release);
+        parker.notify ();
+    });
+    const auto begin = std::chrono::steady_clock::now ();
+    bool result = parkUntil<ParkImmediately> (
+        parker, Parker::deadlineAfter (std::chrono::seconds (10)),
+        [&ready] { return ready.load (std::memory_order_acquire); });
+    notifier.join ();
+    EXPECT_EQ (result, true);
+    EXPECT_LT (std::chrono::steady_clock::now () - begin, std::chrono::seconds (5));
+    EXPECT_EQ (parker.waiters (), 0);
+}
+
+TEST (SpinLockTest, deadlineAfterSaturates) {
+    EXPECT_EQ (Parker::deadlineAfter (std::chrono::hours::max ()),
+               Parker::Clock::time_point::max ());
+    const auto expired = Parker::deadlineAfter (std::chrono::seconds (-1));
+    EXPECT_LE (expired, Parker::Clock::now ());
+}
+
+namespace {
+struct ShortWaitSite {};
+struct LongWaitSite {};
+}  // namespace
+
+TEST (SpinLockTest, firstWaitCalibratesTheTscInTheBackground) {
+    // Nothing calibrates during static initialization, and the first wait of a new site does not
+    // spin through CalibrationPeriod: it times itself with steady_clock until the clock is ready.
+    struct FirstWaitSite {};
+    const auto begin = std::chrono::steady_clock::now ();
+    {
+        AdaptiveWaitStrategy<1000000, 1000000, FirstWaitSite> strategy;
+        EXPECT_EQ (strategy.wait (), true);
+    }
+    EXPECT_LT (std::chrono::steady_clock::now () - begin, TscClock::CalibrationPeriod);
+    while (TscClock::calibrated () == nullptr) {
+        ASSERT_LT (std::chrono::steady_clock::now () - begin, std::chrono::seconds (10));
+        std::this_thread::yield ();
+    }
+    EXPECT_EQ (TscClock::calibrated (), &TscClock::instance ());
+}
+
+TEST (SpinLockTest, adaptiveWaitStrategySpinsYieldsThenGivesUp) {
+    static_assert (SpinLockWaitStrategy<WaitStrategyAdaptive>);
+    using Strategy = AdaptiveWaitStrategy<1000, 1000>;
+    Strategy strategy;
+    const auto begin = std::chrono::steady_clock::now ();
+    size_t rounds = 0;
+    while (strategy.wait ()) {
+        rounds++;
+        ASSERT_LT (std::chrono::steady_clock::now () - begin, std::chrono::seconds (5));
+    }
+    EXPECT_GT (rounds, 0);
+    strategy.reset ();
+    EXPECT_EQ (strategy.wait (), true);
+}
+
+TEST (SpinLockTest, adaptiveWaitStrategyLearnsPerSite) {
+    using Short = AdaptiveWaitStrategy<20000, 200000, ShortWaitSite>;
+    using Long = AdaptiveWaitStrategy<20000, 200000, LongWaitSite>;
+    const uint64_t initialSpin = Short::spinBudgetCycles ();
+    EXPECT_EQ (Long::spinBudgetCycles (), initialSpin);
+
+    // Waits that run through both phases and then park for a while push the average up.
+    for (int i = 0; i < 32; i++) {
+        Long strategy;
+        while (strategy.wait ()) {
+        }
+        std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    }
+    // Waits that end after a single round pull it down.
+    for (int i = 0; i < 32; i++) {
+        Short strategy;
+        EXPECT_EQ (strategy.wait (), true);
+    }
+
+    EXPECT_LT (Long::spinBudgetCycles (), initialSpin);
+    EXPECT_LT (Long::yieldBudgetCycles (), Short::yieldBudgetCycles ());
+    EXPECT_LT (Short::recentWaitCycles (), Long::recentWaitCycles ());
+    EXPECT_LE (Short::spinBudgetCycles (), initialSpin);
+
+    // Histories are per thread.
+    uint64_t fresh = 0;
+    std::thread ([&fresh] { fresh = Long::spinBudgetCycles (); }).join ();
+    EXPECT_EQ (fresh, initialSpin);
+}
+
+TEST (SpinLockTest, adaptiveWaitStrategyAsSpinLockPolicy) {
+    std::atomic<int> lock = 1;
+    std::thread releaser ([&lock] {
+        std::this_thread::sleep_for (std::chrono::milliseconds (5));
+        lock.store (0, std::memory_order_release);
+    });
+    while (!SpinLock<WaitStrategyAdaptive>::YieldAfter (lock, 0, 1)) {
+    }
+    releaser.join ();
+    EXPECT_EQ (lock.load (), 1);
+
+    Parker parker;
+    std::atomic<bool> ready = false;
+    std::thread notifier ([&parker, &ready] {
+        std::this_thread::sleep_for (std::chrono::milliseconds (10));
+        ready.store (true, std::memory_order_release);
+        parker.notify ();
+    });
+    using Spin = AdaptiveWaitStrategy<1000, 1000>;
+    const bool result = parkUntil<Spin> (parker, Parker::deadlineAfter (std::chrono::seconds (10)),
+                                         [&ready] { return ready.load (std::memory_order_acquire); });
+    notifier.join ();
+    EXPECT_EQ (result, true);
+}
+
+template <class Lock>
+class SpinLockTypesTest : public ::testing::Test {};
+
+using SpinLockTypes = ::testing::Types<TTASSpinLock<>, TicketSpinLock<>, MCSSpinLock<>, RWSpinLock<>,
+                                       TTASSpinLock<WaitStrategyYield>>;
+TYPED_TEST_SUITE (SpinLockTypesTest, SpinLockTypes);
+
+TYPED_TEST (SpinLockTypesTest, mutualExclusion) {
+    TypeParam lock;
+    // Non-atomic read-modify-write: lost updates show up if two threads get in at once.
+    uint64_t counter = 0;
+    constexpr uint64_t PerThread = 20000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back ([&lock, &counter] {
+            for (uint64_t i = 0; i < PerThread; i++) {
+                std::lock_guard guard (lock);
+                counter = counter + 1;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+    EXPECT_EQ (counter, 4 * PerThread);
+}
+
+TYPED_TEST (SpinLockTypesTest, tryLock) {
+    TypeParam lock;
+    EXPECT_EQ (lock.try_lock (), true);
+    bool acquiredElsewhere = true;
+    std::thread ([&lock, &acquiredElsewhere] { acquiredElsewhere = lock.try_lock (); }).join ();
+    EXPECT_EQ (acquiredElsewhere, false);
+    lock.unlock ();
+    {
+        std::unique_lock guard (lock, std::try_to_lock);
+        EXPECT_EQ (guard.owns_lock (), true);
+    }
+    EXPECT_EQ (lock.try_lock (), true);
+    lock.unlock ();
+}
+
+TEST (SpinLockTest, scopedLockOverSeveralKinds) {
+    TTASSpinLock<> a;
+    TicketSpinLock<> b;
+    MCSSpinLock<> c;
+    MCSSpinLock<> d;
+    {
+        // Nested MCS locks on one thread each need their own node.
+        std::scoped_lock guard (a, b, c, d);
+        EXPECT_EQ (c.try_lock (), false);
+    }
+    EXPECT_EQ (c.try_lock (), true);
+    EXPECT_EQ (d.try_lock (), true);
+    d.unlock ();
+    c.unlock ();
+}
+
+TEST (SpinLockTest, ticketLockIsFifo) {
+    TicketSpinLock<> lock;
+    lock.lock ();
+    std::vector<int> order;
+    std::vector<std::thread> threads;
+    std::atomic<int> queued = 0;
+    for (int t = 0; t < 4; t++) {
+        // Start the waiters one at a time so their tickets follow t.
+        threads.emplace_back ([&lock, &order, &queued, t] {
+            queued.fetch_add (1);
+            std::lock_guard guard (lock);
+            order.push_back (t);
+        });
+        while (queued.load () != t + 1) {
+            std::this_thread::yield ();
+        }
+        std::this_thread::sleep_for (std::chrono::milliseconds (5));
+    }
+    lock.unlock ();
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+    EXPECT_EQ (order, (std::vector<int>{ 0, 1, 2, 3 }));
+}
+
+TEST (SpinLockTest, rwLockSharesReadersAndPrefersWriters) {
+    RWSpinLock<> lock;
+    std::shared_lock first (lock);
+    {
+        std::shared_lock second (lock);
+        EXPECT_EQ (lock.readers (), 2);
+    }
+    EXPECT_EQ (lock.try_lock (), false);
+
+    std::atomic<bool> written = false;
+    std::thread writer ([&lock, &written] {
+        std::lock_guard guard (lock);
+        written.store (true);
+    });
+    // Once the writer waits, new readers are turned away even though only readers are inside.
+    while (lock.try_lock_shared ()) {
+        lock.unlock_shared ();
+        std::this_thread::yield ();
+    }
+    EXPECT_EQ (written.load (), false);
+    first.unlock ();
+    writer.join ();
+    EXPECT_EQ (written.load (), true);
+    EXPECT_EQ (lock.try_lock_shared (), true);
+    lock.unlock_shared ();
+}
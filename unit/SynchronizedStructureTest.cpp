@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+
+#include <SynchronizedStructure.h>
+#include <atomic>
+#include <map>
+#include <ranges>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+template <class... Args>
+using ShardedMap = SynchronizedStructure::SynchronizedStructure<Args...>;
+
+TEST (SynchronizedStructureTest, basicOperations) {
+    ShardedMap<int, std::string> map (5);
+    EXPECT_EQ (map.shardCount (), 8);
+    EXPECT_EQ (map.empty (), true);
+    EXPECT_EQ (map.insert_or_assign (1, "one"), true);
+    EXPECT_EQ (map.insert_or_assign (2, std::string ("two")), true);
+    EXPECT_EQ (map.insert_or_assign (1, "uno"), false);
+    EXPECT_EQ (map.find (1), std::optional<std::string> ("uno"));
+    EXPECT_EQ (map.find (3), std::nullopt);
+    EXPECT_EQ (map.contains (2), true);
+    EXPECT_EQ (map.size (), 2);
+
+    EXPECT_EQ (map.visit (2, [] (std::string& value) { value += "!"; }), true);
+    EXPECT_EQ (map.visit (3, [] (std::string&) { FAIL (); }), false);
+    const auto& constMap = map;
+    std::string seen;
+    EXPECT_EQ (constMap.visit (2, [&seen] (const std::string& value) { seen = value; }), true);
+    EXPECT_EQ (seen, "two!");
+
+    EXPECT_EQ (map.erase (1), true);
+    EXPECT_EQ (map.erase (1), false);
+    EXPECT_EQ (map.size (), 1);
+    map.clear ();
+    EXPECT_EQ (map.empty (), true);
+}
+
+TEST (SynchronizedStructureTest, forEachVisitsEveryShard) {
+    ShardedMap<int, int> map (16);
+    for (int i = 0; i < 1000; i++) {
+        map.insert_or_assign (i, i);
+    }
+    map.for_each ([] (const int&, int& value) { value *= 2; });
+    long sum = 0;
+    size_t count = 0;
+    std::as_const (map).for_each ([&sum, &count] (const int& key, const int& value) {
+        EXPECT_EQ (value, 2 * key);
+        sum += value;
+        count++;
+    });
+    EXPECT_EQ (count, 1000);
+    EXPECT_EQ (sum, 999 * 1000);
+
+    // Keys spread over all shards.
+    std::vector<size_t> perShard (map.shardCount ());
+    for (int i = 0; i < 1000; i++) {
+        perShard[map.shardIndex (i)]++;
+    }
+    for (size_t count : perShard) {
+        EXPECT_GT (count, 0);
+    }
+}
+
+TEST (SynchronizedStructureTest, insertManyGroupsByShard) {
+    ShardedMap<int, std::string, std::map<int, std::string>, std::shared_mutex> map (4);
+    map.insert_or_assign (7, "old");
+    std::vector<std::pair<int, std::string>> batch{
+        { 1, "a" }, { 7, "b" }, { 2, "c" }, { 1, "d" }, { 9, "e" },
+    };
+    // 1, 2 and 9 are new; the second 1 and the 7 replace.
+    EXPECT_EQ (map.insert_many (batch), 3);
+    EXPECT_EQ (map.find (1), std::optional<std::string> ("d"));
+    EXPECT_EQ (map.find (7), std::optional<std::string> ("b"));
+    EXPECT_EQ (map.size (), 4);
+
+    auto generated = std::views::iota (100, 110) |
+                     std::views::transform ([] (int i) { return std::pair (i, std::to_string (i)); });
+    EXPECT_EQ (map.insert_many (generated), 10);
+    EXPECT_EQ (map.find (105), std::optional<std::string> ("105"));
+}
+
+TEST (SynchronizedStructureTest, concurrentSessions) {
+    ShardedMap<uint64_t, uint64_t> sessions;
+    constexpr uint64_t PerThread = 5000;
+    std::vector<std::thread> threads;
+    for (uint64_t t = 0; t < 4; t++) {
+        threads.emplace_back ([&sessions, t] {
+            for (uint64_t i = 0; i < PerThread; i++) {
+                const uint64_t id = t * PerThread + i;
+                sessions.insert_or_assign (id, 0);
+                sessions.visit (id, [] (uint64_t& hits) { hits++; });
+                // Everybody also touches a shared hot session.
+                if (!sessions.visit (uint64_t{ 1 } << 40, [] (uint64_t& hits) { hits++; })) {
+                    sessions.insert_or_assign (uint64_t{ 1 } << 40, 0);
+                }
+                if (i % 2 == 0) {
+                    sessions.erase (id);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+    EXPECT_EQ (sessions.size (), 4 * PerThread / 2 + 1);
+    sessions.for_each ([] (const uint64_t& id, uint64_t& hits) {
+        if (id != uint64_t{ 1 } << 40) {
+            EXPECT_EQ (hits, 1);
+            EXPECT_EQ (id % 2, 1);
+        }
+    });
+}
+
+TEST (SynchronizedStructureTest, readOptimizedMode) {
+    using SynchronizedStructure::ReadOptimized;
+    ShardedMap<int, double, ReadOptimized> fees (4);
+    EXPECT_EQ (fees.capacity (), 4);
+    EXPECT_EQ (fees.insert_or_assign (1, 0.5), true);
+    EXPECT_EQ (fees.insert_or_assign (1, 0.25), false);
+    EXPECT_EQ (fees.insert_many (std::vector<std::pair<int, double>>{ { 2, 1.0 }, { 3, 1.5 } }), 2);
+    EXPECT_EQ (fees.find (1), std::optional<double> (0.25));
+    EXPECT_EQ (fees.find (4), std::nullopt);
+    EXPECT_EQ (fees.visit (2, [] (double& fee) { fee *= 2; }), true);
+    EXPECT_EQ (std::as_const (fees).find (2), std::optional<double> (2.0));
+
+    EXPECT_EQ (fees.erase (3), true);
+    EXPECT_EQ (fees.contains (3), false);
+    EXPECT_EQ (fees.size (), 2);
+    // The tombstone is reused, and the table holds exactly `capacity` keys.
+    fees.insert_or_assign (3, 3.0);
+    fees.insert_or_assign (4, 4.0);
+    EXPECT_THROW (fees.insert_or_assign (5, 5.0), std::length_error);
+
+    double total = 0;
+    std::as_const (fees).for_each ([&total] (const int&, const double& fee) { total += fee; });
+    EXPECT_EQ (total, 0.25 + 2.0 + 3.0 + 4.0);
+    fees.clear ();
+    EXPECT_EQ (fees.empty (), true);
+    EXPECT_EQ (fees.find (1), std::nullopt);
+}
+
+TEST (SynchronizedStructureTest, readOptimizedErasesShortenProbeChains) {
+    // Every key hashes to the same slot, so the keys form one probe chain in insertion order.
+    struct SameSlot {
+        size_t operator() (int) const {
+            return 0;
+        }
+    };
+    ShardedMap<int, int, SynchronizedStructure::ReadOptimized, inplace::RWSpinLock<>, SameSlot>
+        table (8);
+    for (int key = 1; key <= 4; key++) {
+        table.insert_or_assign (key, key);
+    }
+    // Erasing from the middle of the chain leaves tombstones for the keys behind them.
+    EXPECT_EQ (table.erase (2), true);
+    EXPECT_EQ (table.erase (3), true);
+    EXPECT_EQ (table.tombstones (), 2);
+    EXPECT_EQ (table.find (4), std::optional<int> (4));
+    // Erasing its end clears the chain back to the last live key.
+    EXPECT_EQ (table.erase (4), true);
+    EXPECT_EQ (table.tombstones (), 0);
+    EXPECT_EQ (table.find (1), std::optional<int> (1));
+    EXPECT_EQ (table.find (4), std::nullopt);
+
+    // Churn through many more keys than the table holds: no tombstones pile up.
+    for (int key = 100; key < 10000; key++) {
+        EXPECT_EQ (table.insert_or_assign (key, key), true);
+        EXPECT_EQ (table.erase (key), true);
+    }
+    EXPECT_EQ (table.tombstones (), 0);
+    EXPECT_EQ (table.size (), 1);
+
+    // A reused tombstone is no longer counted.
+    table.insert_or_assign (2, 2);
+    table.insert_or_assign (3, 3);
+    EXPECT_EQ (table.erase (2), true);
+    EXPECT_EQ (table.tombstones (), 1);
+    table.insert_or_assign (5, 5);
+    EXPECT_EQ (table.tombstones (), 0);
+    EXPECT_EQ (table.find (3), std::optional<int> (3));
+    EXPECT_EQ (table.find (5), std::optional<int> (5));
+}
+
+TEST (SynchronizedStructureTest, readOptimizedConcurrentReaders) {
+    struct Limit {
+        uint64_t maxQty;
+        uint64_t maxNotional;
+    };
+    ShardedMap<uint32_t, Limit, SynchronizedStructure::ReadOptimized> limits (256);
+    constexpr uint32_t Symbols = 200;
+    for (uint32_t symbol = 0; symbol < Symbols; symbol++) {
+        limits.insert_or_assign (symbol, Limit{ 1, 100 });
+    }
+    std::atomic<bool> done = false;
+    std::atomic<uint64_t> bad = 0;
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; r++) {
+        readers.emplace_back ([&, r] {
+            uint32_t symbol = r;
+            while (!done.load (std::memory_order_relaxed)) {
+                symbol = (symbol + 7) % Symbols;
+                const auto limit = limits.find (symbol);
+                if (!limit || limit->maxNotional != limit->maxQty * 100) {
+                    bad.fetch_add (1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (uint64_t round = 2; round < 50; round++) {
+        for (uint32_t symbol = 0; symbol < Symbols; symbol++) {
+            limits.visit (symbol, [round] (Limit& limit) { limit = Limit{ round, round * 100 }; });
+        }
+    }
+    done.store (true);
+    for (auto& reader : readers) {
+        reader.join ();
+    }
+    EXPECT_EQ (bad.load (), 0);
+    EXPECT_EQ (limits.find (Symbols - 1)->maxQty, 49);
+}
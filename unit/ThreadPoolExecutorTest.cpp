@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <ThreadPoolExecutor.h>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+using namespace datastructure;
+
+namespace {
+ThreadPoolOptions withWorkers (size_t workers, std::vector<int> cpus = {}) {
+    ThreadPoolOptions options;
+    options.workers = workers;
+    options.cpus = std::move (cpus);
+    return options;
+}
+}  // namespace
+
+TEST (ThreadPoolExecutorTest, submitReturnsResultsAndExceptions) {
+    ThreadPoolExecutor pool (withWorkers (2));
+    auto answer = pool.submit ([] { return 42; });
+    auto failure = pool.submit ([]() -> int { throw std::runtime_error ("boom"); });
+    EXPECT_EQ (answer.get (), 42);
+    EXPECT_THROW (failure.get (), std::runtime_error);
+}
+
+TEST (ThreadPoolExecutorTest, bulkSubmitKeepsOrderOfFutures) {
+    ThreadPoolExecutor pool (withWorkers (3));
+    std::vector<std::function<int ()>> jobs;
+    for (int i = 0; i < 100; i++) {
+        jobs.push_back ([i] { return i * i; });
+    }
+    auto futures = pool.bulkSubmit (jobs);
+    ASSERT_EQ (futures.size (), 100);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ (futures[i].get (), i * i);
+    }
+}
+
+TEST (ThreadPoolExecutorTest, shutdownDrainsNestedWork) {
+    std::atomic<int> leaves = 0;
+    std::vector<WorkerStats> stats;
+    {
+        ThreadPoolExecutor pool (withWorkers (4));
+        // Binary tree of posts, deeper than a single local queue holds.
+        struct Spawner {
+            ThreadPoolExecutor* pool;
+            std::atomic<int>* leaves;
+            int depth;
+            void operator() () const {
+                if (depth == 0) {
+                    leaves->fetch_add (1);
+                    return;
+                }
+                pool->post (Spawner{ pool, leaves, depth - 1 });
+                pool->post (Spawner{ pool, leaves, depth - 1 });
+            }
+        };
+        pool.post (Spawner{ &pool, &leaves, 12 });
+        pool.shutdown ();
+        EXPECT_THROW (pool.post ([] {}), std::runtime_error);
+        stats = pool.stats ();
+    }
+    EXPECT_EQ (leaves.load (), 1 << 12);
+    ASSERT_EQ (stats.size (), 4);
+    const uint64_t executed = std::accumulate (stats.begin (), stats.end (), uint64_t{ 0 },
+                                               [] (uint64_t sum, const WorkerStats& s) {
+                                                   return sum + s.executed;
+                                               });
+    EXPECT_EQ (executed, (2u << 12) - 1);
+}
+
+TEST (ThreadPoolExecutorTest, postedExceptionsAreCounted) {
+    ThreadPoolExecutor pool (withWorkers (1));
+    pool.post ([] { throw std::runtime_error ("ignored"); });
+    pool.post ([] {});
+    pool.shutdown ();
+    const auto stats = pool.stats ();
+    EXPECT_EQ (stats[0].executed, 2);
+    EXPECT_EQ (stats[0].failed, 1);
+    EXPECT_EQ (stats[0].queued, 2);
+}
+
+TEST (ThreadPoolExecutorTest, workersArePinned) {
+    ThreadPoolExecutor pool (withWorkers (2, { 0 }));
+    auto cpu = pool.submit ([] { return sched_getcpu (); });
+    EXPECT_EQ (cpu.get (), 0);
+    EXPECT_EQ (pool.currentWorker (), -1);
+    auto index = pool.submit ([&pool] { return pool.currentWorker (); });
+    EXPECT_GE (index.get (), 0);
+}
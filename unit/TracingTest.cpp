@@ -0,0 +1,130 @@
+// Tracing is compiled in for this translation unit only; the payload types below are local so no
+// queue instantiation is shared with the untraced test files.
+#ifndef INPLACE_TRACING
+#define INPLACE_TRACING
+#endif
+
+#include <gtest/gtest.h>
+
+#include <MyFunction.h>
+#include <SPSCQueue.hpp>
+#include <Tracing.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+using namespace inplace;
+
+namespace {
+struct TracedPayload {
+    int value = 0;
+};
+
+std::string exportTrace () {
+    std::ostringstream os;
+    {
+        ChromeTraceWriter writer (os);
+    }
+    return os.str ();
+}
+
+size_t countOf (const std::string& text, const std::string& needle) {
+    size_t count = 0;
+    for (auto pos = text.find (needle); pos != std::string::npos; pos = text.find (needle, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+}  // namespace
+
+TEST (TracingTest, exportsChromeJson) {
+    exportTrace ();
+    setTraceThreadName ("main");
+    {
+        INPLACE_TRACE_SCOPE ("test.scope");
+        INPLACE_TRACE_INSTANT ("test.instant", 7, 8);
+        INPLACE_TRACE_COUNTER ("test.counter", 42);
+    }
+    std::thread other ([] {
+        setTraceThreadName ("other");
+        INPLACE_TRACE_INSTANT ("test.instant");
+    });
+    other.join ();
+
+    const auto json = exportTrace ();
+    EXPECT_EQ (json.rfind ("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0);
+    EXPECT_EQ (json.substr (json.size () - 4), "\n]}\n");
+    EXPECT_EQ (countOf (json, "\"name\":\"test.scope\",\"ph\":\"B\""), 1);
+    EXPECT_EQ (countOf (json, "\"name\":\"test.scope\",\"ph\":\"E\""), 1);
+    EXPECT_EQ (countOf (json, "\"name\":\"test.instant\",\"ph\":\"i\""), 2);
+    EXPECT_EQ (countOf (json, "\"args\":{\"a0\":7,\"a1\":8}"), 1);
+    EXPECT_EQ (countOf (json, "\"ph\":\"C\""), 1);
+    EXPECT_EQ (countOf (json, "\"args\":{\"value\":42}"), 1);
+    EXPECT_EQ (countOf (json, "\"args\":{\"name\":\"main\""), 1);
+    EXPECT_EQ (countOf (json, "\"args\":{\"name\":\"other\""), 1);
+}
+
+TEST (TracingTest, fullBufferDropsNewEvents) {
+    exportTrace ();
+    std::thread producer ([] {
+        for (size_t i = 0; i < TraceBuffer::Capacity + 10; i++) {
+            INPLACE_TRACE_INSTANT ("test.flood", i);
+        }
+        EXPECT_EQ (TraceRegistry::instance ().local ().dropped (), 10);
+    });
+    producer.join ();
+
+    std::ostringstream os;
+    ChromeTraceWriter writer (os);
+    EXPECT_EQ (writer.flush (), TraceBuffer::Capacity);
+    EXPECT_EQ (writer.flush (), 0);
+}
+
+TEST (TracingTest, queuesAndMyFunctionAreInstrumented) {
+    exportTrace ();
+    SPSCQueue<TracedPayload, 2> q;
+    EXPECT_EQ (q.enqueue (TracedPayload{ 1 }), true);
+    EXPECT_EQ (q.enqueue (TracedPayload{ 2 }), true);
+    EXPECT_EQ (q.enqueue (TracedPayload{ 3 }), false);
+    EXPECT_EQ (q.dequeue ([](TracedPayload&) {}), true);
+    {
+        datastructure::MyFunction<int ()> function ([] { return 1; });
+        EXPECT_EQ (function (), 1);
+    }
+
+    const auto json = exportTrace ();
+    EXPECT_EQ (countOf (json, "\"name\":\"spsc.enqueue\""), 2);
+    EXPECT_EQ (countOf (json, "\"name\":\"spsc.full\""), 1);
+    EXPECT_EQ (countOf (json, "\"name\":\"spsc.dequeue\""), 1);
+    EXPECT_EQ (countOf (json, "\"name\":\"MyFunction.construct\""), 1);
+    EXPECT_EQ (countOf (json, "\"name\":\"MyFunction.destruct\""), 1);
+}
+
+TEST (TracingTest, backgroundFlusherDrains) {
+    exportTrace ();
+    std::ostringstream os;
+    {
+        ChromeTraceWriter writer (os);
+        BackgroundTraceFlusher flusher (writer, std::chrono::milliseconds (1));
+        for (int i = 0; i < 100; i++) {
+            INPLACE_TRACE_INSTANT ("test.background", i);
+        }
+    }
+    EXPECT_EQ (countOf (os.str (), "\"name\":\"test.background\""), 100);
+}
+
+TEST (TracingTest, exitedThreadsGiveUpTheirBuffers) {
+    exportTrace ();
+    INPLACE_TRACE_INSTANT ("test.main");
+    const size_t buffers = TraceRegistry::instance ().bufferCount ();
+    for (int round = 0; round < 8; round++) {
+        std::thread ([round] {
+            setTraceThreadName ("round");
+            INPLACE_TRACE_INSTANT ("test.round", round);
+        }).join ();
+    }
+    // Everything the exited threads recorded, and their names, is still exported.
+    const auto json = exportTrace ();
+    EXPECT_EQ (countOf (json, "\"name\":\"test.round\""), 8);
+    EXPECT_EQ (countOf (json, "\"args\":{\"name\":\"round\""), 8);
+    EXPECT_EQ (TraceRegistry::instance ().bufferCount (), buffers);
+}
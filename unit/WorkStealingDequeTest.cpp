@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include <WorkStealingDeque.hpp>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+using namespace inplace;
+
+TEST (WorkStealingDequeTest, ownerIsLifoThiefIsFifo) {
+    WorkStealingDeque<int64_t, 8> deque;
+    EXPECT_EQ (deque.pop (), std::nullopt);
+    EXPECT_EQ (deque.steal (), std::nullopt);
+    for (int64_t i = 0; i < 4; i++) {
+        EXPECT_EQ (deque.push (i), true);
+    }
+    EXPECT_EQ (deque.size (), 4);
+    EXPECT_EQ (deque.pop (), 3);
+    EXPECT_EQ (deque.steal (), 0);
+    EXPECT_EQ (deque.pop (), 2);
+    EXPECT_EQ (deque.steal (), 1);
+    EXPECT_EQ (deque.empty (), true);
+    EXPECT_EQ (deque.pop (), std::nullopt);
+}
+
+TEST (WorkStealingDequeTest, growsUpToMaxCapacity) {
+    WorkStealingDeque<int64_t, 4, 16> deque;
+    EXPECT_EQ (deque.capacity (), 4);
+    // Leave the indices away from zero so that the copy into the new ring wraps.
+    for (int64_t i = 0; i < 3; i++) {
+        deque.push (i);
+        deque.steal ();
+    }
+    for (int64_t i = 0; i < 16; i++) {
+        EXPECT_EQ (deque.push (i), true);
+    }
+    EXPECT_EQ (deque.capacity (), 16);
+    EXPECT_EQ (deque.push (16), false);
+    for (int64_t i = 0; i < 16; i++) {
+        EXPECT_EQ (deque.steal (), i);
+    }
+    EXPECT_EQ (deque.empty (), true);
+}
+
+TEST (WorkStealingDequeTest, everyItemIsTakenOnce) {
+    constexpr int64_t Items = 200000;
+    constexpr int Thieves = 3;
+    WorkStealingDeque<int64_t, 64> deque;
+    std::vector<std::atomic<int>> taken (Items);
+    std::atomic<int64_t> done = 0;
+
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < Thieves; t++) {
+        thieves.emplace_back ([&] {
+            while (done.load (std::memory_order_acquire) < Items) {
+                if (auto item = deque.steal ()) {
+                    taken[*item].fetch_add (1, std::memory_order_relaxed);
+                    done.fetch_add (1, std::memory_order_release);
+                }
+            }
+        });
+    }
+    for (int64_t i = 0; i < Items; i++) {
+        deque.push (i);
+        // Pop every third item so that the owner races the thieves for the last element.
+        if (i % 3 == 0) {
+            if (auto item = deque.pop ()) {
+                taken[*item].fetch_add (1, std::memory_order_relaxed);
+                done.fetch_add (1, std::memory_order_release);
+            }
+        }
+    }
+    while (auto item = deque.pop ()) {
+        taken[*item].fetch_add (1, std::memory_order_relaxed);
+        done.fetch_add (1, std::memory_order_release);
+    }
+    for (auto& thief : thieves) {
+        thief.join ();
+    }
+    for (int64_t i = 0; i < Items; i++) {
+        ASSERT_EQ (taken[i].load (), 1) << "item " << i;
+    }
+}